@@ -0,0 +1,689 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 21 Oct 2026 4:52:18pm
+    Author:  pangj
+
+    Headless benchmark of the audio engine: DJAudioPlayer decks summed by the
+    MixEngine, driven block by block without an audio device, playing the
+    bundled tracks. Prints one JSON document to stdout (progress goes to
+    stderr) so that results from different builds can be compared.
+
+    Usage:
+      audioMixBench [--block-sizes 128,256,512] [--sample-rates 44100,48000]
+                    [--decks 1,2,4,8] [--max-decks 16] [--seconds 10]
+                    [--speed 1.0] [--key-lock] [--parallel]
+                    [--tracks path/to/tracks] [--output results.json]
+                    [--rt-check]
+
+    --rt-check fails the run (exit code 2) if the audio path allocates or
+    locks once playback has settled, and prints where it did.
+
+    audioMixBench --search [--search-tracks 100000] [--output results.json]
+    measures the library's SearchIndex instead: queries typed one key at a
+    time and whole queries searched from scratch, against a library of
+    generated titles, next to the linear scan it replaced.
+
+    audioMixBench --render timeline.json [--output mix.wav] [--verify]
+    renders a mix offline with the OfflineMixRenderer (see parseTimeline for
+    the format). --verify also plays the same events through a live MixEngine,
+    block by block, and fails (exit code 1) unless the two match bit for bit.
+
+    audioMixBench --render-test [--tracks path/to/tracks] does the same for a
+    built-in timeline over the bundled tracks (loads, a centred and a moved
+    crossfader, volume, speed, a seek and a stop).
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "../Source/DJAudioPlayer.h"
+#include "../Source/MixEngine.h"
+#include "../Source/OfflineMixRenderer.h"
+#include "../Source/RealtimeGuard.h"
+#include "../Source/ReadAheadScheduler.h"
+#include "../Source/RenderWorkerPool.h"
+#include "../Source/SearchIndex.h"
+
+namespace {
+  struct Settings {
+    Array<int> blockSizes{ 128, 256, 512 };
+    Array<double> sampleRates{ 44100.0, 48000.0 };
+    Array<int> deckCounts{ 1, 2, 4, 8 };
+    int maxDecks = MixEngine::maxChannels;
+    double seconds = 10.0;
+    double speed = 1.0;
+    bool keyLock = false;
+    bool parallel = false;
+    bool rtCheck = false;
+    Array<File> tracks;
+    File outputFile;
+  };
+
+  struct Measurement {
+    std::vector<double> blockSeconds;   // sorted
+    double renderedSeconds = 0;
+    double wallSeconds = 0;
+    int underruns = 0;
+    int rtViolations = 0;
+  };
+
+  // blocks played before the real-time checks start, while tracks load and buffers fill
+  constexpr double warmUpSeconds = 0.5;
+
+  /* Split a comma-separated option into numbers, keeping the defaults if it wasn't given */
+  template <typename Number>
+  void parseList(const ArgumentList& args, const String& option, Array<Number>& values) {
+    if (!args.containsOption(option))
+      return;
+
+    values.clear();
+
+    for (auto& item : StringArray::fromTokens(args.getValueForOption(option), ",", {}))
+      if (item.trim().getDoubleValue() > 0)
+        values.add((Number) item.trim().getDoubleValue());
+  }
+
+  /* Find the bundled tracks folder above the working directory or the executable */
+  File findTracksFolder() {
+    for (auto start : { File::getCurrentWorkingDirectory(),
+                        File::getSpecialLocation(File::currentExecutableFile).getParentDirectory() }) {
+      for (auto dir = start; dir.exists() && !dir.isRoot(); dir = dir.getParentDirectory()) {
+        for (auto candidate : { dir.getChildFile("tracks"), dir.getChildFile("audioMix/tracks") })
+          if (candidate.isDirectory())
+            return candidate;
+      }
+    }
+
+    return {};
+  }
+
+  /* Get a value from a sorted list of block times, in microseconds */
+  double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty())
+      return 0;
+
+    auto index = jlimit((size_t) 0, sorted.size() - 1, (size_t) (p / 100.0 * (double) (sorted.size() - 1) + 0.5));
+    return sorted[index] * 1.0e6;
+  }
+
+  /* Wait until every deck has the next stretch of audio decoded, so the decoder's speed isn't measured */
+  void waitForReadAhead(OwnedArray<DJAudioPlayer>& decks, double seconds) {
+    for (auto* deck : decks) {
+      auto giveUpAt = Time::getMillisecondCounter() + 10000;
+
+      while (deck->getBufferedSeconds() < jmin(seconds, deck->getLengthInSeconds() - deck->getPosition())
+             && Time::getMillisecondCounter() < giveUpAt)
+        Thread::sleep(1);
+    }
+  }
+
+  /* Play a number of decks for the configured time and measure every block */
+  Measurement measure(const Settings& settings, double sampleRate, int blockSize, int numDecks,
+                      AudioFormatManager& formatManager, ReadAheadScheduler& scheduler,
+                      RenderWorkerPool& renderPool)
+  {
+    OwnedArray<DJAudioPlayer> decks;
+    MixEngine mixEngine(settings.parallel ? &renderPool : nullptr);
+
+    for (int i = 0; i < numDecks; ++i)
+      mixEngine.addChannel(decks.add(new DJAudioPlayer(formatManager, scheduler)));
+
+    mixEngine.prepareToPlay(blockSize, sampleRate);
+
+    // every deck plays a different track where there are enough of them
+    for (int i = 0; i < numDecks; ++i) {
+      auto* deck = decks[i];
+      deck->loadURL(URL(settings.tracks[i % settings.tracks.size()]));
+      deck->setSpeed(settings.speed);
+      deck->setKeyLock(settings.keyLock);
+      deck->start();
+    }
+
+    AudioBuffer<float> buffer(2, blockSize);
+    AudioSourceChannelInfo info(&buffer, 0, blockSize);
+
+    auto numBlocks = (int) std::ceil(settings.seconds * sampleRate / blockSize);
+    auto warmUpBlocks = (int) std::ceil(warmUpSeconds * sampleRate / blockSize);
+
+    RealtimeGuard::setEnabled(false);
+    RealtimeGuard::reset();
+
+    Measurement result;
+    result.blockSeconds.reserve((size_t) numBlocks);
+
+    for (int block = 0; block < numBlocks; ++block) {
+      // a track that is about to end starts again, so every deck keeps playing
+      for (auto* deck : decks)
+        if (deck->getLengthInSeconds() - deck->getPosition() < 1.0)
+          deck->setPosition(0);
+
+      waitForReadAhead(decks, 0.5);
+
+      if (block == warmUpBlocks)
+        RealtimeGuard::setEnabled(settings.rtCheck);
+
+      auto startTicks = Time::getHighResolutionTicks();
+      mixEngine.getNextAudioBlock(info);
+      auto elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+
+      result.blockSeconds.push_back(elapsed);
+      result.wallSeconds += elapsed;
+    }
+
+    RealtimeGuard::setEnabled(false);
+    result.rtViolations = RealtimeGuard::getNumViolations();
+
+    for (auto& report : RealtimeGuard::takeReports())
+      std::cerr << report << std::endl;
+
+    result.renderedSeconds = numBlocks * blockSize / sampleRate;
+    std::sort(result.blockSeconds.begin(), result.blockSeconds.end());
+
+    for (auto* deck : decks)
+      result.underruns += deck->getBufferUnderruns();
+
+    mixEngine.releaseResources();
+
+    for (auto* deck : decks)
+      mixEngine.removeChannel(deck);
+
+    return result;
+  }
+
+  /* Checks whether a run kept (almost) every block within its deadline */
+  bool meetsDeadline(const Measurement& m, double deadlineSeconds) {
+    return percentile(m.blockSeconds, 99.9) <= deadlineSeconds * 1.0e6;
+  }
+
+  /* Describe one run as JSON */
+  var describe(const Measurement& m, double sampleRate, int blockSize, int numDecks) {
+    auto deadline = blockSize / sampleRate;
+    auto missed = std::count_if(m.blockSeconds.begin(), m.blockSeconds.end(),
+                                [deadline](double t) { return t > deadline; });
+
+    auto* run = new DynamicObject();
+    run->setProperty("sampleRate", sampleRate);
+    run->setProperty("blockSize", blockSize);
+    run->setProperty("decks", numDecks);
+    run->setProperty("deadlineUs", deadline * 1.0e6);
+    run->setProperty("p50Us", percentile(m.blockSeconds, 50));
+    run->setProperty("p90Us", percentile(m.blockSeconds, 90));
+    run->setProperty("p99Us", percentile(m.blockSeconds, 99));
+    run->setProperty("p999Us", percentile(m.blockSeconds, 99.9));
+    run->setProperty("maxUs", percentile(m.blockSeconds, 100));
+    run->setProperty("realTimeFactor", m.wallSeconds > 0 ? m.renderedSeconds / m.wallSeconds : 0.0);
+    run->setProperty("missedDeadlines", (int) missed);
+    run->setProperty("underruns", m.underruns);
+
+    if (RealtimeGuard::isAvailable())
+      run->setProperty("rtViolations", m.rtViolations);
+    return var(run);
+  }
+
+  /* Describe a set of query times as JSON */
+  var describeQueries(std::vector<double>& seconds) {
+    std::sort(seconds.begin(), seconds.end());
+
+    auto* times = new DynamicObject();
+    times->setProperty("queries", (int) seconds.size());
+    times->setProperty("p50Us", percentile(seconds, 50));
+    times->setProperty("p99Us", percentile(seconds, 99));
+    times->setProperty("maxUs", percentile(seconds, 100));
+    return var(times);
+  }
+
+  /* Make up a library of track titles, from a few thousand made-up words */
+  StringArray makeTitles(int numTracks, Random& random) {
+    // UTF-8, with an "é" and a "ü" so that some titles need case folding beyond ASCII
+    static const char* syllables[] = { "la", "ve", "ni", "ght", "sun", "mo", "on", "da", "nce", "ri", "ver", "ka", "to",
+                                       "shi", "ne", "ro", "se", "be", "at", "el", "ec", "tro", "blu", "gol", "den",
+                                       "fi", "re", "sky", "mi", "x", "\xc3\xa9", "\xc3\xbc", "zu", "pa", "dis" };
+    constexpr int numSyllables = (int) (sizeof(syllables) / sizeof(syllables[0]));
+
+    StringArray words;
+
+    for (int i = 0; i < 5000; ++i) {
+      String word;
+
+      for (int n = 2 + random.nextInt(2); --n >= 0;)
+        word << String::fromUTF8(syllables[random.nextInt(numSyllables)]);
+
+      words.add(i % 3 == 0 ? word.substring(0, 1).toUpperCase() + word.substring(1) : word);
+    }
+
+    StringArray titles;
+
+    for (int i = 0; i < numTracks; ++i) {
+      // "Artist - Title", sometimes with a version
+      String title;
+      title << words[random.nextInt(words.size())] << " - ";
+
+      for (int n = 1 + random.nextInt(4); --n >= 0;)
+        title << words[random.nextInt(words.size())] << (n > 0 ? " " : "");
+
+      if (random.nextInt(5) == 0)
+        title << " (" << words[random.nextInt(words.size())] << " Remix)";
+
+      titles.add(title);
+    }
+
+    return titles;
+  }
+
+  /* Time a search, in seconds */
+  double timeSearch(SearchIndex& index, const String& keyword, size_t& numResults) {
+    auto startTicks = Time::getHighResolutionTicks();
+    numResults = index.search(keyword).size();
+    return Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+  }
+
+  /* Measure the library's search index, and the linear scan it replaced */
+  int runSearchBenchmark(const ArgumentList& args) {
+    auto numTracks = args.containsOption("--search-tracks")
+                       ? jmax(1, args.getValueForOption("--search-tracks").getIntValue()) : 100000;
+
+    Random random(42);
+    auto titles = makeTitles(numTracks, random);
+
+    SearchIndex index;
+    auto startTicks = Time::getHighResolutionTicks();
+
+    for (int i = 0; i < titles.size(); ++i)
+      index.add((SearchIndex::TrackId) (i + 1), titles[i]);
+
+    auto buildSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+
+    // queries are parts of real titles, typed from the start of a word
+    StringArray queries;
+
+    for (int i = 0; i < 200; ++i) {
+      auto title = titles[random.nextInt(titles.size())];
+      auto words = StringArray::fromTokens(title, " ", {});
+      auto start = title.indexOf(words[random.nextInt(words.size())]);
+      queries.add(title.substring(start, start + 3 + random.nextInt(10)).trimEnd());
+    }
+
+    std::vector<double> keystrokes, cold, linear;
+    size_t numResults = 0;
+
+    for (auto& query : queries) {
+      // typed one key at a time, each search narrowing the last one
+      for (int length = 1; length <= query.length(); ++length)
+        keystrokes.push_back(timeSearch(index, query.substring(0, length), numResults));
+
+      // the whole query at once, after a search it has nothing in common with
+      index.search("\t");
+      cold.push_back(timeSearch(index, query, numResults));
+    }
+
+    // the linear scan is slow, so it only gets a few of the queries (and checks the index finds the same tracks)
+    auto mismatches = 0;
+    std::vector<SearchIndex::TrackId> matches;
+
+    for (int i = 0; i < jmin(20, queries.size()); ++i) {
+      startTicks = Time::getHighResolutionTicks();
+      matches.clear();
+
+      for (int t = 0; t < titles.size(); ++t)
+        if (titles[t].containsIgnoreCase(queries[i]))
+          matches.push_back((SearchIndex::TrackId) (t + 1));
+
+      linear.push_back(Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks));
+
+      if (index.search(queries[i]) != matches)
+        ++mismatches;
+    }
+
+    auto* results = new DynamicObject();
+    results->setProperty("tracks", numTracks);
+    results->setProperty("buildMs", buildSeconds * 1000.0);
+    results->setProperty("memoryMB", (double) index.getMemoryUsed() / (1024.0 * 1024.0));
+    results->setProperty("keystroke", describeQueries(keystrokes));
+    results->setProperty("coldQuery", describeQueries(cold));
+    results->setProperty("linearScan", describeQueries(linear));
+    results->setProperty("mismatches", mismatches);
+    results->setProperty("underOneMs", percentile(keystrokes, 99) < 1000.0 && percentile(cold, 99) < 1000.0);
+
+    auto json = JSON::toString(var(results));
+
+    if (args.containsOption("--output") && !args.getFileForOption("--output").replaceWithText(json)) {
+      std::cerr << "could not write " << args.getFileForOption("--output").getFullPathName() << std::endl;
+      return 1;
+    }
+
+    std::cout << json << std::endl;
+    return mismatches == 0 ? 0 : 1;
+  }
+
+  /* Play a mix's events through a live MixEngine block by block, as the app's controls would */
+  AudioBuffer<float> renderLive(const OfflineMixRenderer::Mix& mix, AudioFormatManager& formatManager) {
+    using Event = OfflineMixRenderer::Event;
+
+    auto events = mix.events;
+    std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.time < b.time; });
+
+    // decks built as the app builds them, with the shared caches
+    ReadAheadScheduler scheduler;
+    OwnedArray<DJAudioPlayer> decks;
+    MixEngine mixEngine;
+
+    for (int i = 0; i < mix.numDecks; ++i)
+      mixEngine.addChannel(decks.add(new DJAudioPlayer(formatManager, scheduler)));
+
+    mixEngine.prepareToPlay(mix.blockSize, mix.sampleRate);
+
+    auto totalSamples = (int64) (mix.lengthInSeconds * mix.sampleRate);
+    AudioBuffer<float> output(2, (int) totalSamples);
+    AudioBuffer<float> block(2, mix.blockSize);
+    AudioSourceChannelInfo info(&block, 0, mix.blockSize);
+    size_t nextEvent = 0;
+
+    for (int64 position = 0; position < totalSamples; position += mix.blockSize) {
+      // a control moved during a block takes effect at the start of the next one
+      while (nextEvent < events.size() && (int64) (events[nextEvent].time * mix.sampleRate) < position + mix.blockSize) {
+        auto& event = events[nextEvent++];
+        auto* deck = decks[event.deck];
+
+        switch (event.type) {
+          case Event::Type::load:       deck->loadURL(URL(event.file)); break;
+          case Event::Type::play:       deck->start(); break;
+          case Event::Type::stop:       deck->stop(); break;
+          case Event::Type::seek:       deck->setPosition(event.value); break;
+          case Event::Type::speed:      deck->setSpeed(event.value); break;
+          case Event::Type::volume:     deck->setGain(event.value); break;
+
+          case Event::Type::crossfader: {
+            float leftGain, rightGain;
+            MixEngine::getCrossfaderGains(event.value, leftGain, rightGain);
+            mixEngine.setChannelGain(decks[0], leftGain);
+            mixEngine.setChannelGain(decks[1], rightGain);
+            break;
+          }
+        }
+      }
+
+      // a real device doesn't wait for the decoder, but a comparison has to
+      waitForReadAhead(decks, 0.5);
+      mixEngine.getNextAudioBlock(info);
+
+      auto num = (int) jmin((int64) mix.blockSize, totalSamples - position);
+
+      for (int chan = 0; chan < 2; ++chan)
+        output.copyFrom(chan, (int) position, block, chan, 0, num);
+    }
+
+    mixEngine.releaseResources();
+
+    for (auto* deck : decks)
+      mixEngine.removeChannel(deck);
+
+    return output;
+  }
+
+  /* Render a mix offline, and optionally check it against a live render of the same events */
+  int renderMix(OfflineMixRenderer::Mix& mix, bool verify, AudioFormatManager& formatManager) {
+    OfflineMixRenderer renderer(formatManager, 1);
+
+    // a float WAV, so that the file holds exactly what was rendered
+    if (verify)
+      mix.bitsPerSample = 32;
+
+    auto startTicks = Time::getHighResolutionTicks();
+    auto result = renderer.renderMix(mix);
+    auto wallSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+
+    if (result.failed()) {
+      std::cerr << "render failed: " << result.getErrorMessage() << std::endl;
+      return 1;
+    }
+
+    auto* results = new DynamicObject();
+    results->setProperty("output", mix.outputFile.getFullPathName());
+    results->setProperty("seconds", mix.lengthInSeconds);
+    results->setProperty("wallSeconds", wallSeconds);
+    results->setProperty("realTimeFactor", wallSeconds > 0 ? mix.lengthInSeconds / wallSeconds : 0.0);
+
+    auto mismatches = 0;
+
+    if (verify) {
+      auto live = renderLive(mix, formatManager);
+      std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(mix.outputFile));
+
+      if (reader == nullptr || reader->lengthInSamples != live.getNumSamples()) {
+        std::cerr << "the rendered file can't be read back, or has the wrong length" << std::endl;
+        return 1;
+      }
+
+      AudioBuffer<float> rendered(2, live.getNumSamples());
+      reader->read(&rendered, 0, live.getNumSamples(), 0, true, true);
+
+      float maxDifference = 0;
+      auto firstMismatch = -1;
+
+      for (int chan = 0; chan < 2; ++chan) {
+        for (int i = 0; i < live.getNumSamples(); ++i) {
+          auto difference = std::abs(rendered.getSample(chan, i) - live.getSample(chan, i));
+
+          if (difference != 0) {
+            ++mismatches;
+            maxDifference = jmax(maxDifference, difference);
+
+            if (firstMismatch < 0 || i < firstMismatch)
+              firstMismatch = i;
+          }
+        }
+      }
+
+      results->setProperty("mismatchedSamples", mismatches);
+      results->setProperty("maxDifference", maxDifference);
+      results->setProperty("firstMismatchSeconds", firstMismatch >= 0 ? firstMismatch / mix.sampleRate : -1.0);
+      results->setProperty("bitIdentical", mismatches == 0);
+    }
+
+    std::cout << JSON::toString(var(results)) << std::endl;
+    return mismatches == 0 ? 0 : 1;
+  }
+
+  /* Render a timeline file */
+  int runRender(const ArgumentList& args, AudioFormatManager& formatManager) {
+    auto timelineFile = args.getFileForOption("--render");
+    OfflineMixRenderer::Mix mix;
+
+    auto parsed = OfflineMixRenderer::parseTimeline(timelineFile.loadFileAsString(), mix);
+
+    if (parsed.failed()) {
+      std::cerr << timelineFile.getFullPathName() << ": " << parsed.getErrorMessage() << std::endl;
+      return 1;
+    }
+
+    if (args.containsOption("--output"))
+      mix.outputFile = args.getFileForOption("--output");
+
+    if (mix.outputFile == File()) {
+      std::cerr << "no output file (give one in the timeline or with --output)" << std::endl;
+      return 1;
+    }
+
+    return renderMix(mix, args.containsOption("--verify"), formatManager);
+  }
+
+  /* Render a built-in timeline over the bundled tracks and check it against a live render */
+  int runRenderTest(const ArgumentList& args, AudioFormatManager& formatManager) {
+    auto tracksFolder = args.containsOption("--tracks") ? args.getFileForOption("--tracks") : findTracksFolder();
+    auto tracks = tracksFolder.findChildFiles(File::findFiles, false, "*.mp3");
+    tracks.sort();
+
+    if (tracks.isEmpty()) {
+      std::cerr << "no tracks found (use --tracks to point at the tracks folder)" << std::endl;
+      return 1;
+    }
+
+    using Event = OfflineMixRenderer::Event;
+
+    auto event = [](double time, int deck, Event::Type type, double value = 0, File file = {}) {
+      Event e;
+      e.time = time;
+      e.deck = deck;
+      e.type = type;
+      e.value = value;
+      e.file = file;
+      return e;
+    };
+
+    // the crossfader starts (and comes back to) the centre, where both decks play at full volume
+    OfflineMixRenderer::Mix mix;
+    mix.numDecks = 2;
+    mix.lengthInSeconds = 6.0;
+    mix.outputFile = File::createTempFile(".wav");
+    mix.events = { event(0.0, 0, Event::Type::load, 0, tracks[0]),
+                   event(0.0, 1, Event::Type::load, 0, tracks[1 % tracks.size()]),
+                   event(0.0, 0, Event::Type::play),
+                   event(0.0, 1, Event::Type::play),
+                   event(0.0, 0, Event::Type::crossfader, 0.5),
+                   event(1.0, 0, Event::Type::crossfader, 0.3),
+                   event(1.7, 1, Event::Type::volume, 0.8),
+                   event(2.2, 0, Event::Type::speed, 1.1),
+                   event(3.1, 1, Event::Type::seek, 10.0),
+                   event(4.0, 0, Event::Type::crossfader, 0.5),
+                   event(5.0, 0, Event::Type::stop) };
+
+    auto exitCode = renderMix(mix, true, formatManager);
+    mix.outputFile.deleteFile();
+    return exitCode;
+  }
+}
+
+//==============================================================================
+int main(int argc, char* argv[]) {
+  // the decks use timers and asynchronous messages, so they need a message manager
+  ScopedJuceInitialiser_GUI juceInitialiser;
+
+  ArgumentList args(argc, argv);
+
+  if (args.containsOption("--search"))
+    return runSearchBenchmark(args);
+
+  if (args.containsOption("--render") || args.containsOption("--render-test")) {
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    return args.containsOption("--render") ? runRender(args, formatManager)
+                                           : runRenderTest(args, formatManager);
+  }
+
+  Settings settings;
+
+  parseList(args, "--block-sizes", settings.blockSizes);
+  parseList(args, "--sample-rates", settings.sampleRates);
+  parseList(args, "--decks", settings.deckCounts);
+
+  if (args.containsOption("--max-decks"))
+    settings.maxDecks = jlimit(1, MixEngine::maxChannels, args.getValueForOption("--max-decks").getIntValue());
+
+  if (args.containsOption("--seconds"))
+    settings.seconds = jmax(0.1, args.getValueForOption("--seconds").getDoubleValue());
+
+  if (args.containsOption("--speed"))
+    settings.speed = jlimit(0.25, 2.0, args.getValueForOption("--speed").getDoubleValue());
+
+  settings.keyLock = args.containsOption("--key-lock");
+  settings.parallel = args.containsOption("--parallel");
+  settings.rtCheck = args.containsOption("--rt-check");
+
+  if (settings.rtCheck && !RealtimeGuard::isAvailable()) {
+    std::cerr << "--rt-check needs a build with AUDIOMIX_RT_CHECK=1" << std::endl;
+    return 1;
+  }
+
+  auto tracksFolder = args.containsOption("--tracks") ? args.getFileForOption("--tracks")
+                                                      : findTracksFolder();
+
+  if (args.containsOption("--output"))
+    settings.outputFile = args.getFileForOption("--output");
+
+  settings.tracks = tracksFolder.findChildFiles(File::findFiles, false, "*.mp3");
+  settings.tracks.sort();
+
+  if (settings.tracks.isEmpty()) {
+    std::cerr << "no tracks found (use --tracks to point at the tracks folder)" << std::endl;
+    return 1;
+  }
+
+  AudioFormatManager formatManager;
+  formatManager.registerBasicFormats();
+
+  ReadAheadScheduler readAheadScheduler;
+  RenderWorkerPool renderPool(MixEngine::maxChannels);
+
+  Array<var> runs, maxDecks;
+  int rtViolations = 0;
+
+  for (auto sampleRate : settings.sampleRates) {
+    for (auto blockSize : settings.blockSizes) {
+      for (auto numDecks : settings.deckCounts) {
+        numDecks = jlimit(1, MixEngine::maxChannels, numDecks);
+        std::cerr << sampleRate << " Hz, " << blockSize << " samples, " << numDecks << " decks" << std::endl;
+
+        auto m = measure(settings, sampleRate, blockSize, numDecks, formatManager, readAheadScheduler, renderPool);
+        runs.add(describe(m, sampleRate, blockSize, numDecks));
+        rtViolations += m.rtViolations;
+      }
+
+      // add decks until the blocks no longer fit in their deadline
+      int fits = 0;
+
+      for (int numDecks = 1; numDecks <= settings.maxDecks; ++numDecks) {
+        std::cerr << sampleRate << " Hz, " << blockSize << " samples: trying " << numDecks << " decks" << std::endl;
+
+        auto m = measure(settings, sampleRate, blockSize, numDecks, formatManager, readAheadScheduler, renderPool);
+        rtViolations += m.rtViolations;
+
+        if (!meetsDeadline(m, blockSize / sampleRate))
+          break;
+
+        fits = numDecks;
+      }
+
+      auto* limit = new DynamicObject();
+      limit->setProperty("sampleRate", sampleRate);
+      limit->setProperty("blockSize", blockSize);
+      limit->setProperty("decks", fits);
+      maxDecks.add(var(limit));
+    }
+  }
+
+  auto* config = new DynamicObject();
+  config->setProperty("seconds", settings.seconds);
+  config->setProperty("speed", settings.speed);
+  config->setProperty("keyLock", settings.keyLock);
+  config->setProperty("parallel", settings.parallel);
+  config->setProperty("rtCheck", settings.rtCheck);
+  config->setProperty("renderWorkers", renderPool.getNumWorkers());
+  config->setProperty("cpus", SystemStats::getNumCpus());
+  config->setProperty("tracks", settings.tracks.size());
+  config->setProperty("deadlineRule", "p99.9 block time within the block period");
+
+  auto* results = new DynamicObject();
+  results->setProperty("config", var(config));
+  results->setProperty("runs", runs);
+  results->setProperty("maxDecksWithinDeadline", maxDecks);
+
+  auto json = JSON::toString(var(results));
+
+  if (settings.outputFile != File() && !settings.outputFile.replaceWithText(json)) {
+    std::cerr << "could not write " << settings.outputFile.getFullPathName() << std::endl;
+    return 1;
+  }
+
+  std::cout << json << std::endl;
+
+  if (settings.rtCheck && rtViolations > 0) {
+    std::cerr << rtViolations << " allocations or locks on the audio thread" << std::endl;
+    return 2;
+  }
+
+  return 0;
+}
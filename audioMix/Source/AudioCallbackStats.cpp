@@ -0,0 +1,191 @@
+/*
+  ==============================================================================
+
+    AudioCallbackStats.cpp
+    Created: 22 Oct 2026 10:21:44am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "AudioCallbackStats.h"
+
+namespace {
+  // relaxed is enough: readers only want recent values, not a consistent set
+  constexpr auto relaxed = std::memory_order_relaxed;
+}
+
+//==============================================================================
+AudioCallbackStats::AudioCallbackStats(const StringArray& _stageNames)
+                                     : stageNames(_stageNames)
+{
+  jassert(stageNames.size() <= maxStages);
+
+  for (auto& bin : histogram)
+    bin = 0;
+
+  for (int i = 0; i < maxStages; ++i) {
+    stageMicros[(size_t) i] = 0;
+    stagePeakMicros[(size_t) i] = 0;
+  }
+}
+
+AudioCallbackStats::~AudioCallbackStats() {
+}
+
+/* Set the sample rate the block budget is worked out from */
+void AudioCallbackStats::prepare(double newSampleRate) {
+  if (newSampleRate > 0)
+    sampleRate = newSampleRate;
+
+  // the gap before the first callback after a restart isn't an xrun
+  reset();
+}
+
+/* Clear every count and peak at the start of the next callback */
+void AudioCallbackStats::reset() {
+  resetRequested = true;
+}
+
+/* Mark the start of a callback */
+void AudioCallbackStats::beginCallback(int numSamples) {
+  if (resetRequested.exchange(false))
+    resetState();
+
+  auto now = Time::getHighResolutionTicks();
+  auto newBlockSeconds = numSamples / sampleRate.load(relaxed);
+
+  // a callback that comes much later than the previous block's length means the device missed one
+  if (previousStartTicks != 0
+      && Time::highResolutionTicksToSeconds(now - previousStartTicks) > 1.5 * jmax(blockSeconds, newBlockSeconds))
+    lateCallbacks.fetch_add(1, relaxed);
+
+  previousStartTicks = now;
+  callbackStartTicks = now;
+  blockSeconds = newBlockSeconds;
+  blockStageTicks.fill(0);
+}
+
+/* Add time spent in a stage during the current callback */
+void AudioCallbackStats::addStageTime(int stage, int64 ticks) {
+  if (isPositiveAndBelow(stage, maxStages))
+    blockStageTicks[(size_t) stage] += ticks;
+}
+
+/* Mark the end of a callback and publish its timing */
+void AudioCallbackStats::endCallback() {
+  auto elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - callbackStartTicks);
+  auto used = blockSeconds > 0 ? elapsed / blockSeconds : 0.0;
+
+  callbacks.fetch_add(1, relaxed);
+
+  if (used > 1.0)
+    deadlineMisses.fetch_add(1, relaxed);
+
+  budgetUsed.store(budgetUsed.load(relaxed) * 0.9 + used * 0.1, relaxed);
+
+  if (used > peakBudgetUsed.load(relaxed))
+    peakBudgetUsed.store(used, relaxed);
+
+  // rolling histogram: the callback that drops out of the history leaves its bin
+  auto bin = (uint8) jlimit(0, numHistogramBins - 1, (int) (used * (numHistogramBins - 1)));
+
+  if (historySize == historyLength)
+    histogram[history[(size_t) historyPos]].fetch_sub(1, relaxed);
+  else
+    ++historySize;
+
+  history[(size_t) historyPos] = bin;
+  historyPos = (historyPos + 1) % historyLength;
+  histogram[bin].fetch_add(1, relaxed);
+
+  for (int i = 0; i < stageNames.size(); ++i) {
+    auto micros = Time::highResolutionTicksToSeconds(blockStageTicks[(size_t) i]) * 1.0e6;
+    auto& average = stageMicros[(size_t) i];
+    auto& peak = stagePeakMicros[(size_t) i];
+
+    average.store(average.load(relaxed) * 0.9 + micros * 0.1, relaxed);
+
+    if (micros > peak.load(relaxed))
+      peak.store(micros, relaxed);
+  }
+}
+
+/* Record the xrun count reported by the audio device */
+void AudioCallbackStats::setDeviceXruns(int count) {
+  deviceXruns.store(count, relaxed);
+}
+
+/* Take a copy of the statistics */
+AudioCallbackStats::Snapshot AudioCallbackStats::getSnapshot() const {
+  Snapshot s;
+  s.stageNames = stageNames;
+  s.callbacks = callbacks.load(relaxed);
+  s.deadlineMisses = deadlineMisses.load(relaxed);
+  s.lateCallbacks = lateCallbacks.load(relaxed);
+  s.deviceXruns = deviceXruns.load(relaxed);
+  s.budgetUsedPercent = budgetUsed.load(relaxed) * 100.0;
+  s.peakBudgetUsedPercent = peakBudgetUsed.load(relaxed) * 100.0;
+
+  for (size_t i = 0; i < histogram.size(); ++i)
+    s.histogram[i] = histogram[i].load(relaxed);
+
+  for (size_t i = 0; i < (size_t) maxStages; ++i) {
+    s.stageMicros[i] = stageMicros[i].load(relaxed);
+    s.stagePeakMicros[i] = stagePeakMicros[i].load(relaxed);
+  }
+
+  return s;
+}
+
+/* Clear everything the audio thread keeps */
+void AudioCallbackStats::resetState() {
+  previousStartTicks = 0;
+  historyPos = 0;
+  historySize = 0;
+
+  callbacks.store(0, relaxed);
+  deadlineMisses.store(0, relaxed);
+  lateCallbacks.store(0, relaxed);
+  budgetUsed.store(0, relaxed);
+  peakBudgetUsed.store(0, relaxed);
+
+  for (auto& bin : histogram)
+    bin.store(0, relaxed);
+
+  for (int i = 0; i < maxStages; ++i) {
+    stageMicros[(size_t) i].store(0, relaxed);
+    stagePeakMicros[(size_t) i].store(0, relaxed);
+  }
+}
+
+//==============================================================================
+/* Describe the snapshot as a JSON object */
+var AudioCallbackStats::Snapshot::toJSON() const {
+  auto* json = new DynamicObject();
+  json->setProperty("callbacks", (int64) callbacks);
+  json->setProperty("deadlineMisses", deadlineMisses);
+  json->setProperty("lateCallbacks", lateCallbacks);
+  json->setProperty("deviceXruns", deviceXruns);
+  json->setProperty("budgetUsedPercent", budgetUsedPercent);
+  json->setProperty("peakBudgetUsedPercent", peakBudgetUsedPercent);
+
+  Array<var> bins;
+
+  for (auto count : histogram)
+    bins.add((int) count);
+
+  json->setProperty("histogram", bins);
+
+  auto* stages = new DynamicObject();
+
+  for (int i = 0; i < stageNames.size(); ++i) {
+    auto* stage = new DynamicObject();
+    stage->setProperty("us", stageMicros[(size_t) i]);
+    stage->setProperty("peakUs", stagePeakMicros[(size_t) i]);
+    stages->setProperty(stageNames[i], var(stage));
+  }
+
+  json->setProperty("stages", var(stages));
+  return var(json);
+}
@@ -0,0 +1,164 @@
+/*
+  ==============================================================================
+
+    AudioCallbackStats.h
+    Created: 22 Oct 2026 10:21:44am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Timing of an audio callback, split into named stages, for telling whether
+    a dropout came from decoding, time-stretching, resampling or mixing.
+
+    The audio thread brackets each callback with beginCallback/endCallback and
+    adds the time of each stage in between. Everything it publishes is a
+    relaxed atomic, so any other thread can take a snapshot at any time
+    without locking or waiting for the audio thread. Times are measured with
+    the high-resolution tick counter.
+
+    Per callback it keeps the share of the block's time budget used, a
+    histogram of that share over the last historyLength callbacks, counts of
+    blocks that overran their budget and of callbacks that arrived late (a
+    gap of more than 1.5 blocks since the previous one, which usually means
+    the device dropped a buffer), and the device's own xrun count, which the
+    message thread passes in.
+*/
+class AudioCallbackStats {
+public:
+  static constexpr int maxStages = 8;
+
+  // 5% of the budget per bin, with the last bin for anything over the budget
+  static constexpr int numHistogramBins = 21;
+
+  // number of recent callbacks in the histogram
+  static constexpr int historyLength = 2048;
+
+  /**
+   * \brief
+   *    A copy of the published statistics.
+   */
+  struct Snapshot {
+    StringArray stageNames;
+    uint64 callbacks = 0;
+    int deadlineMisses = 0;
+    int lateCallbacks = 0;
+    int deviceXruns = -1;                               // -1 if the device doesn't report them
+    double budgetUsedPercent = 0;                       // smoothed over the last few callbacks
+    double peakBudgetUsedPercent = 0;                   // since the last reset
+    std::array<uint32, numHistogramBins> histogram{};
+    std::array<double, maxStages> stageMicros{};        // smoothed time per callback
+    std::array<double, maxStages> stagePeakMicros{};    // since the last reset
+
+    /**
+     * \brief
+     *    Describe the snapshot as a JSON object.
+     */
+    var toJSON() const;
+  };
+
+  /**
+   * \brief
+   *    Constructor.
+   *
+   * \param _stageNames
+   *    A name for each stage timed inside the callback (at most maxStages)
+   */
+  AudioCallbackStats(const StringArray& _stageNames);
+
+  /**
+   * \brief
+   *    Destructor.
+   */
+  ~AudioCallbackStats();
+
+  /**
+   * \brief
+   *    Set the sample rate the block budget is worked out from. Call from prepareToPlay.
+   */
+  void prepare(double sampleRate);
+
+  /**
+   * \brief
+   *    Clear every count and peak at the start of the next callback. Any thread.
+   */
+  void reset();
+
+  /**
+   * \brief
+   *    Mark the start of a callback. Audio thread only.
+   *
+   * \param numSamples
+   *    Number of samples the callback has to produce
+   */
+  void beginCallback(int numSamples);
+
+  /**
+   * \brief
+   *    Add time spent in a stage during the current callback. Audio thread only.
+   *
+   * \param stage
+   *    Index of the stage in the names given to the constructor
+   * \param ticks
+   *    Time spent, in high-resolution ticks
+   */
+  void addStageTime(int stage, int64 ticks);
+
+  /**
+   * \brief
+   *    Mark the end of a callback and publish its timing. Audio thread only.
+   */
+  void endCallback();
+
+  /**
+   * \brief
+   *    Record the xrun count reported by the audio device. Any thread.
+   */
+  void setDeviceXruns(int count);
+
+  /**
+   * \brief
+   *    Take a copy of the statistics. Any thread; never waits for the audio thread.
+   */
+  Snapshot getSnapshot() const;
+
+private:
+  /**
+   * \brief
+   *    Clear everything the audio thread keeps. Audio thread only.
+   */
+  void resetState();
+
+  const StringArray stageNames;
+
+  std::atomic<double> sampleRate{ 44100.0 };
+  std::atomic<bool> resetRequested{ false };
+
+  // audio thread only
+  int64 callbackStartTicks = 0;
+  int64 previousStartTicks = 0;
+  double blockSeconds = 0;
+  std::array<int64, maxStages> blockStageTicks{};
+  std::array<uint8, historyLength> history{};
+  int historyPos = 0;
+  int historySize = 0;
+
+  // published
+  std::atomic<uint64> callbacks{ 0 };
+  std::atomic<int> deadlineMisses{ 0 };
+  std::atomic<int> lateCallbacks{ 0 };
+  std::atomic<int> deviceXruns{ -1 };
+  std::atomic<double> budgetUsed{ 0 };
+  std::atomic<double> peakBudgetUsed{ 0 };
+  std::array<std::atomic<uint32>, numHistogramBins> histogram;
+  std::array<std::atomic<double>, maxStages> stageMicros;
+  std::array<std::atomic<double>, maxStages> stagePeakMicros;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioCallbackStats)
+};
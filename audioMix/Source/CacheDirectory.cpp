@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    CacheDirectory.cpp
+    Created: 2 Nov 2026 9:41:06am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "CacheDirectory.h"
+
+//==============================================================================
+CacheDirectory::CacheDirectory(const File& _directory, const String& _extension, int64 _maxSize)
+                             : directory(_directory),
+                               extension(_extension),
+                               maxSize(jmax((int64) 0, _maxSize))
+{
+  directory.createDirectory();
+
+  // remove anything left over from a write that was interrupted. The app, the bench and other
+  // renderers may be writing into the same directory right now, so recent temporaries stay
+  auto staleBefore = Time::getCurrentTime() - RelativeTime::hours(staleTemporaryHours);
+
+  for (auto& leftover : directory.findChildFiles(File::findFiles, false, "*.tmp"))
+    if (leftover.getLastModificationTime() < staleBefore)
+      leftover.deleteFile();
+}
+
+CacheDirectory::~CacheDirectory() {
+}
+
+/* Get the entry for the current version of a source file */
+File CacheDirectory::getFileFor(const File& source) const {
+  // a changed size or modification time gives a different key, so stale entries are never found
+  String identity;
+  identity << source.getFullPathName() << '|' << source.getSize() << '|' << source.getLastModificationTime().toMilliseconds();
+
+  return directory.getChildFile(String::toHexString(identity.hashCode64()) + extension);
+}
+
+/* Write an entry through a temporary file, and move it into place once it is complete */
+bool CacheDirectory::writeEntry(const File& entry, const std::function<bool(FileOutputStream&)>& write) {
+  // a temporary file of its own, so that two writers of the same entry never write into one file
+  TemporaryFile temp(entry, directory.getChildFile(entry.getFileNameWithoutExtension() + "_"
+                                                     + String::toHexString(Random::getSystemRandom().nextInt64()) + ".tmp"));
+
+  {
+    FileOutputStream out(temp.getFile());
+
+    if (out.failedToOpen() || !write(out))
+      return false;
+
+    out.flush();
+
+    if (out.getStatus().failed())
+      return false;
+  }
+
+  // the temporary file is deleted by TemporaryFile if it isn't moved into place
+  return temp.overwriteTargetFileWithTemporary();
+}
+
+/* Mark an entry as just used */
+void CacheDirectory::markUsed(const File& entry) {
+  entry.setLastModificationTime(Time::getCurrentTime());
+}
+
+/* Delete the least recently used entries until the directory fits its size cap */
+void CacheDirectory::evictIfNeeded() {
+  auto entries = directory.findChildFiles(File::findFiles, false, "*" + extension);
+
+  int64 totalSize = 0;
+
+  for (auto& f : entries)
+    totalSize += f.getSize();
+
+  // oldest first
+  std::sort(entries.begin(), entries.end(), [](const File& a, const File& b) {
+    return a.getLastModificationTime() < b.getLastModificationTime();
+  });
+
+  for (auto& f : entries) {
+    if (totalSize <= maxSize)
+      break;
+
+    auto size = f.getSize();
+
+    // files that are still open (e.g. mapped by a deck) may refuse to be deleted on some platforms - skip them
+    if (f.deleteFile())
+      totalSize -= size;
+  }
+}
+
+/* Set the maximum total size of the entries */
+void CacheDirectory::setMaxSize(int64 bytes) {
+  maxSize = jmax((int64) 0, bytes);
+}
@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    CacheDirectory.h
+    Created: 2 Nov 2026 9:41:06am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    A directory of files derived from source audio files (transcoded PCM,
+    analysis results, waveforms), one file per source.
+
+    Entries are keyed by the source file's path, size and modification time,
+    so a source that changes gets a new entry and is never matched with a
+    stale one. Entries are written with writeEntry(), through a temporary
+    file of their own that is only moved into place once it is complete, so
+    that only complete entries are ever found. A ".tmp" file left over from
+    an interrupted write is deleted when the directory is opened, once it is
+    old enough that no other process sharing the directory can still be
+    writing it.
+
+    The modification time of an entry doubles as its last use. Once the
+    entries add up to more than the size cap, evictIfNeeded() deletes the
+    least recently used ones.
+*/
+class CacheDirectory {
+public:
+  /**
+   * \brief
+   *    Constructor.
+   *
+   * \param directory
+   *    Where the entries are kept
+   * \param extension
+   *    The file extension of the entries, e.g. ".pcm"
+   * \param maxSize
+   *    The size cap in bytes
+   */
+  CacheDirectory(const File& directory, const String& extension,
+                 int64 maxSize = std::numeric_limits<int64>::max());
+
+  /**
+   * \brief
+   *    Destructor.
+   */
+  ~CacheDirectory();
+
+  /**
+   * \brief
+   *    Get the entry for the current version of a source file (which may not exist yet).
+   */
+  File getFileFor(const File& source) const;
+
+  /**
+   * \brief
+   *    Write an entry through a temporary file, and move it into place once it is complete.
+   *
+   * \param entry
+   *    The entry to write, from getFileFor()
+   * \param write
+   *    Writes the entry's contents to the stream; returning false abandons the entry
+   *
+   * \return
+   *    true if the entry was written and moved into place
+   */
+  bool writeEntry(const File& entry, const std::function<bool(FileOutputStream&)>& write);
+
+  /**
+   * \brief
+   *    Mark an entry as just used, so that it is evicted last.
+   */
+  void markUsed(const File& entry);
+
+  /**
+   * \brief
+   *    Delete the least recently used entries until the directory fits its size cap.
+   */
+  void evictIfNeeded();
+
+  /**
+   * \brief
+   *    Set the maximum total size of the entries.
+   *
+   * \param bytes
+   *    The size cap in bytes
+   */
+  void setMaxSize(int64 bytes);
+
+  /**
+   * \brief
+   *    Get the directory the entries are kept in.
+   */
+  const File& getDirectory() const { return directory; }
+
+private:
+  // how long a temporary file goes untouched before it is taken to be left over
+  static constexpr double staleTemporaryHours = 1.0;
+
+  const File directory;
+  const String extension;
+  std::atomic<int64> maxSize;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CacheDirectory)
+};
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    CommandQueue.h
+    Created: 19 Oct 2026 9:12:40am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    A wait-free single-producer / single-consumer queue of commands, used to
+    pass discrete events (start, stop, seek, track swaps) from the message
+    thread to the audio thread. Neither side ever locks or allocates: push()
+    fails if the queue is full, and the consumer drains everything that is
+    ready at the start of each block.
+
+    Continuous parameters such as gain and speed don't go through the queue;
+    they are published as atomic snapshots and ramped on the audio thread.
+*/
+template <typename Command, int capacity>
+class CommandQueue {
+public:
+  /**
+   * \brief
+   *    Add a command to the queue. Producer thread only.
+   *
+   * \return
+   *    False if the queue was full and the command was dropped
+   */
+  bool push(const Command& command) {
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+      return false;
+
+    commands[(size_t) (size1 > 0 ? start1 : start2)] = command;
+    fifo.finishedWrite(1);
+    return true;
+  }
+
+  /**
+   * \brief
+   *    Call a function for every command in the queue, in the order they were pushed.
+   *    Consumer thread only.
+   *
+   * \param handler
+   *    Called with each command
+   */
+  template <typename Handler>
+  void drain(Handler&& handler) {
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i)
+      handler(commands[(size_t) (start1 + i)]);
+
+    for (int i = 0; i < size2; ++i)
+      handler(commands[(size_t) (start2 + i)]);
+
+    fifo.finishedRead(size1 + size2);
+  }
+
+  /**
+   * \brief
+   *    Get the number of commands waiting to be drained.
+   */
+  int getNumPending() const {
+    return fifo.getNumReady();
+  }
+
+private:
+  // AbstractFifo keeps one slot free to tell a full queue from an empty one
+  AbstractFifo fifo{ capacity + 1 };
+  std::array<Command, (size_t) capacity + 1> commands;
+
+  JUCE_DECLARE_NON_COPYABLE(CommandQueue)
+};
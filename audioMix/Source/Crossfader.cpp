@@ -12,10 +12,12 @@
 #include "Crossfader.h"
 
 //==============================================================================
-Crossfader::Crossfader(DeckGUI* _deckGUI1, 
-                       DeckGUI* _deckGUI2) 
-                     : deckGUI1(_deckGUI1), 
-                       deckGUI2(_deckGUI2)
+Crossfader::Crossfader(MixEngine* _mixEngine,
+                       AudioSource* _leftChannel,
+                       AudioSource* _rightChannel)
+                     : mixEngine(_mixEngine),
+                       leftChannel(_leftChannel),
+                       rightChannel(_rightChannel)
 {
   addAndMakeVisible(crossfadeSlider);
   crossfadeSlider.addListener(this);
@@ -50,17 +52,11 @@ void Crossfader::resized() {
 /* Determine what action to take when the value of a slider is changed */
 void Crossfader::sliderValueChanged(Slider* slider) {
   if (slider == &crossfadeSlider) {
-    // 0.5 is the neutral value between the 2 players
-    // if crossfadeSlider value is lesser than 0.5, deckGUI1 should get louder
-    if (slider->getValue() < 0.5) {
-      deckGUI1->player->setGain(1 - slider->getValue());
-      deckGUI2->player->setGain(slider->getValue());
-    }
+    // the same law as a rendered mix, so moving back to the centre always restores both decks
+    float leftGain, rightGain;
+    MixEngine::getCrossfaderGains(slider->getValue(), leftGain, rightGain);
 
-    // if crossfadeSlider value is more than 0.5, deckGUI2 should get louder
-    else if (slider->getValue() > 0.5) {
-      deckGUI2->player->setGain(slider->getValue());
-      deckGUI1->player->setGain(1 - slider->getValue());
-    }
+    mixEngine->setChannelGain(leftChannel, leftGain);
+    mixEngine->setChannelGain(rightChannel, rightGain);
   }
 }
@@ -11,7 +11,7 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include "DeckGUI.h"
+#include "MixEngine.h"
 
 //==============================================================================
 /*
@@ -23,8 +23,15 @@ public:
     /**
      * \brief 
      *     Constructor.
+     *
+     * \param _mixEngine
+     *     The mix engine whose channel gains are faded
+     * \param _leftChannel
+     *     The source on the left side of the crossfader
+     * \param _rightChannel
+     *     The source on the right side of the crossfader
      */
-    Crossfader(DeckGUI* _deckGUI1, DeckGUI* _deckGUI2);
+    Crossfader(MixEngine* _mixEngine, AudioSource* _leftChannel, AudioSource* _rightChannel);
 
     /**
      * \brief 
@@ -60,9 +67,10 @@ private:
     // corssfade slider for varying the volume between deck 1 and 2
     Slider crossfadeSlider;
 
-    // instances of DECKGUI class
-    DeckGUI* deckGUI1;
-    DeckGUI* deckGUI2;
+    // the channels being faded; their gains are separate from each deck's volume
+    MixEngine* mixEngine;
+    AudioSource* leftChannel;
+    AudioSource* rightChannel;
 
     // for using LookAndFeel_V1
     LookAndFeel_V1 v1;
@@ -10,51 +10,942 @@
 
 #include "DJAudioPlayer.h"
 
-DJAudioPlayer::DJAudioPlayer(AudioFormatManager& _formatManager)
+DJAudioPlayer::DJAudioPlayer(AudioFormatManager& _formatManager,
+                             ReadAheadScheduler& _readAheadScheduler)
                            : formatManager(_formatManager), 
+                             readAheadScheduler(_readAheadScheduler),
+                             sharedTrackCache(std::make_unique<SharedResourcePointer<DecodedTrackCache>>()),
+                             sharedPcmDiskCache(std::make_unique<SharedResourcePointer<PcmDiskCache>>()),
+                             trackCache(sharedTrackCache->get()),
+                             pcmDiskCache(sharedPcmDiskCache->get()),
+                             isOffline(false),
+                             speedRatio(1.0),
+                             isPlaying(false)
+{
+  trackCache->addListener(this);
+  pcmDiskCache->addListener(this);
+}
+
+DJAudioPlayer::DJAudioPlayer(AudioFormatManager& _formatManager,
+                             ReadAheadScheduler& _readAheadScheduler,
+                             DecodedTrackCache& _trackCache,
+                             PcmDiskCache& _pcmDiskCache)
+                           : formatManager(_formatManager),
+                             readAheadScheduler(_readAheadScheduler),
+                             trackCache(&_trackCache),
+                             pcmDiskCache(&_pcmDiskCache),
+                             isOffline(true),
+                             speedRatio(1.0),
                              isPlaying(false)
 {
 }
 
 DJAudioPlayer::~DJAudioPlayer() {
+  stopTimer();
+
+  // stop any load still running on the loader thread before the members it uses go away
+  ++loadGeneration;
+  loaderPool.removeAllJobs(true, 4000);
+
+  if (!isOffline) {
+    trackCache->removeListener(this);
+    pcmDiskCache->removeListener(this);
+  }
+
+  trackCache->unpin(loadedFile);
+
+  // the audio device has been shut down by now, so nothing is still reading from these
+  retired.clear();
 }
 
 /* Prepare the audio source for playing */
 void DJAudioPlayer::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
-  transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
-  resampleSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+  // remembered so that tracks loaded in the background can be prepared the same way
+  preparedBlockSize = samplesPerBlockExpected;
+  preparedSampleRate = sampleRate;
+
+  gainRampSize = jmax(1, samplesPerBlockExpected);
+  gainRamp.allocate((size_t) gainRampSize, true);
+  smoothedGain.reset(sampleRate, 0.02);
+  smoothedGain.setCurrentAndTargetValue(audioPlaying ? targetGain.load() : 0.0f);
+
+  callbackStats.prepare(sampleRate);
+
+  // prepares the time-stretcher and the current track too, at the file's sample rate
+  resampler.prepareToPlay(samplesPerBlockExpected, sampleRate);
 }
 
 /* Called repeatedly to fetch subsequent blocks of audio data */
 void DJAudioPlayer::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
-  resampleSource.getNextAudioBlock(bufferToFill);
+  callbackStats.beginCallback(bufferToFill.numSamples);
+
+  auto startTicks = Time::getHighResolutionTicks();
+  handleCommands();
+  publishPlayhead(bufferToFill.numSamples);
+  auto commandsDoneTicks = Time::getHighResolutionTicks();
+  callbackStats.addStageTime(commandsStage, commandsDoneTicks - startTicks);
+
+  // measure how long the deck stays silent between the end of a track and the start of the next
+  if (endedWithoutNext)
+    silenceSinceEnd += bufferToFill.numSamples;
+
+  if (audioPlaying)
+    smoothedGain.setTargetValue(targetGain.load());
+
+  // nothing to pull once a stop has faded out
+  if (!audioPlaying && !smoothedGain.isSmoothing()) {
+    bufferToFill.clearActiveBufferRegion();
+    callbackStats.endCallback();
+    return;
+  }
+
+  trackTimer.ticks = 0;
+  stretchTimer.ticks = 0;
+
+  resampler.getNextAudioBlock(bufferToFill);
+  auto resampledTicks = Time::getHighResolutionTicks();
+
+  // each stage pulls from the one before it, so take the inner stages' time out of the outer ones
+  callbackStats.addStageTime(trackStage, trackTimer.ticks);
+  callbackStats.addStageTime(stretchStage, stretchTimer.ticks - trackTimer.ticks);
+  callbackStats.addStageTime(resampleStage, resampledTicks - commandsDoneTicks - stretchTimer.ticks);
+
+  // apply the volume with a per-sample ramp, so that gain changes and play/stop never click
+  for (int done = 0; done < bufferToFill.numSamples;) {
+    auto num = jmin(gainRampSize, bufferToFill.numSamples - done);
+
+    for (int i = 0; i < num; ++i)
+      gainRamp[i] = smoothedGain.getNextValue();
+
+    for (int chan = 0; chan < bufferToFill.buffer->getNumChannels(); ++chan)
+      FloatVectorOperations::multiply(bufferToFill.buffer->getWritePointer(chan, bufferToFill.startSample + done),
+                                      gainRamp.get(), num);
+
+    done += num;
+  }
+
+  callbackStats.addStageTime(gainStage, Time::getHighResolutionTicks() - resampledTicks);
+  callbackStats.endCallback();
 }
 
 /* Release of resources that are no longer needed once playback stops */
 void DJAudioPlayer::releaseResources() {
-  transportSource.releaseResources();
-  resampleSource.releaseResources();
+  resampler.releaseResources();
+}
+
+/* Prepare the current track at the file's sample rate */
+void DJAudioPlayer::CurrentTrackSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+  // called with the audio stopped, so the newest track can be prepared from here
+  if (owner.readAheadSource != nullptr)
+    owner.readAheadSource->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+  nextTrackBuffer.setSize(2, jmax(1, samplesPerBlockExpected));
+}
+
+/* Release the current track's buffers */
+void DJAudioPlayer::CurrentTrackSource::releaseResources() {
+  if (owner.readAheadSource != nullptr)
+    owner.readAheadSource->releaseResources();
+
+  nextTrackBuffer.setSize(2, 0);
+}
+
+/* Play the current track, and stop the deck once it has run out */
+void DJAudioPlayer::CurrentTrackSource::getNextAudioBlock(const AudioSourceChannelInfo& info) {
+  auto* source = owner.currentSource;
+
+  if (source == nullptr) {
+    info.clearActiveBufferRegion();
+    return;
+  }
+
+  auto position = source->getNextReadPosition();
+  auto length = source->getTotalLength();
+
+  // plays through the loop engine, which wraps inside the loop region
+  owner.loopEngine.render(*source, info);
+
+  // a loop never reaches the end of the track
+  if (source->isLooping() || owner.loopEngine.getRegion() != nullptr)
+    return;
+
+  // the next track can only be mixed in sample-accurately if it runs at the same rate
+  auto* next = owner.nextSource;
+  auto sameRate = next != nullptr && owner.nextSampleRate == owner.currentSampleRate;
+  auto overlap = sameRate ? (int) jmin((int64) owner.transitionOverlap, length) : 0;
+
+  if (sameRate && position + info.numSamples > length - overlap)
+    mixInNextTrack(info, position, length - overlap, overlap);
+
+  if (position + info.numSamples < length)
+    return;
+
+  // the deck stops itself at the end of the track if there is nothing to follow it
+  // (the GUI then decides whether to advance the queue)
+  if (next == nullptr) {
+    owner.audioPlaying = false;
+    owner.smoothedGain.setTargetValue(0.0f);
+
+    if (!owner.endedWithoutNext) {
+      owner.endedWithoutNext = true;
+      owner.swappedSinceEnd = false;
+      owner.silenceSinceEnd = 0;
+    }
+
+    return;
+  }
+
+  // at another sample rate, the next track starts with the next block, after a sub-block gap
+  owner.lastTransitionGap = sameRate ? 0.0 : (position + info.numSamples - length) / owner.currentSampleRate;
+  owner.advanceToNextTrack();
+}
+
+/* Mix the start of the next track into the part of the block from mixStart on */
+void DJAudioPlayer::CurrentTrackSource::mixInNextTrack(const AudioSourceChannelInfo& info,
+                                                       int64 position, int64 mixStart, int overlap)
+{
+  auto* next = owner.nextSource;
+  auto capacity = nextTrackBuffer.getNumSamples();
+
+  if (capacity == 0)
+    return;
+
+  for (int done = (int) jmax((int64) 0, mixStart - position); done < info.numSamples;) {
+    auto num = jmin(capacity, info.numSamples - done);
+
+    AudioSourceChannelInfo part(&nextTrackBuffer, 0, num);
+    next->getNextAudioBlock(part);
+
+    for (int i = 0; i < num; ++i) {
+      // an equal-power crossfade over the overlap (a straight cut without one)
+      auto t = overlap > 0 ? jlimit(0.0, 1.0, (position + done + i - mixStart + 0.5) / overlap) : 1.0;
+      auto fadeOut = (float) std::cos(t * MathConstants<double>::halfPi);
+      auto fadeIn = (float) std::sin(t * MathConstants<double>::halfPi);
+
+      for (int chan = 0; chan < info.buffer->getNumChannels(); ++chan) {
+        auto& out = info.buffer->getWritePointer(chan, info.startSample + done)[i];
+        out = out * fadeOut + nextTrackBuffer.getSample(jmin(chan, nextTrackBuffer.getNumChannels() - 1), i) * fadeIn;
+      }
+    }
+
+    done += num;
+  }
+}
+
+/* Pass the prepare call on to the input */
+void DJAudioPlayer::TimedStage::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+  input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+/* Pass the release call on to the input */
+void DJAudioPlayer::TimedStage::releaseResources() {
+  input->releaseResources();
+}
+
+/* Pull a block from the input and add up the time it took */
+void DJAudioPlayer::TimedStage::getNextAudioBlock(const AudioSourceChannelInfo& info) {
+  auto startTicks = Time::getHighResolutionTicks();
+  input->getNextAudioBlock(info);
+  ticks += Time::getHighResolutionTicks() - startTicks;
 }
 
 /* Allows the DJAudioPlayer to be told to load a file */
 void DJAudioPlayer::loadURL(URL audioURL) {
-  // convert the audioURL into an audio input stream 
-  // and pass the input stream into AudioFormatManager to create a reader
-  auto* reader = formatManager.createReaderFor(audioURL.createInputStream(false));
+  // any load still in flight is now out of date
+  cancelPendingLoad();
+
+  String error;
+  auto track = prepareTrack(audioURL, error);
+
+  if (track != nullptr)
+    installTrack(std::move(track));
+  else
+    DBG("DJAudioPlayer::loadURL " << error);
+}
+
+/* Load a file on a background thread and install it once it is ready */
+void DJAudioPlayer::loadURLAsync(URL audioURL,
+                                 std::function<void()> onLoaded,
+                                 std::function<void(const String&)> onFailed)
+{
+  // a newer request replaces any older one that has not been installed yet
+  auto generation = ++loadGeneration;
+  loaderPool.removeAllJobs(false, 0);
+
+  WeakReference<DJAudioPlayer> weakThis(this);
+
+  loaderPool.addJob([this, weakThis, generation, audioURL, onLoaded, onFailed] {
+    // skip the work entirely if a newer load was requested while this one was queued
+    if (loadGeneration != generation)
+      return;
+
+    String error;
+    std::shared_ptr<PreparedTrack> track(prepareTrack(audioURL, error).release());
+
+    MessageManager::callAsync([weakThis, generation, track, error, onLoaded, onFailed] {
+      auto* player = weakThis.get();
+
+      // the player has gone, or a newer load was requested while this one was opening
+      if (player == nullptr || player->loadGeneration != generation)
+        return;
+
+      if (track == nullptr) {
+        DBG("DJAudioPlayer::loadURLAsync " << error);
+
+        if (onFailed != nullptr)
+          onFailed(error);
+
+        return;
+      }
+
+      if (!player->installTrack(std::make_unique<PreparedTrack>(std::move(*track)))) {
+        if (onFailed != nullptr)
+          onFailed("the audio thread is not taking commands");
+
+        return;
+      }
+
+      if (onLoaded != nullptr)
+        onLoaded();
+    });
+  });
+}
+
+/* Cancel any asynchronous load that has not been installed yet */
+void DJAudioPlayer::cancelPendingLoad() {
+  ++loadGeneration;
+  loaderPool.removeAllJobs(false, 0);
+}
+
+/* Opens the file and primes its read-ahead buffer (safe to call on any thread) */
+std::unique_ptr<DJAudioPlayer::PreparedTrack> DJAudioPlayer::prepareTrack(URL audioURL, String& error) {
+  auto track = std::make_unique<PreparedTrack>();
+  int numChannels = 2;
+
+  if (audioURL.isLocalFile())
+    track->file = audioURL.getLocalFile();
+
+  double mappedSampleRate = 0;
+
+  // a track that is already decoded in memory doesn't need a reader at all
+  if (auto decoded = trackCache->getTrack(track->file)) {
+    track->sampleRate = trackCache->getSampleRate(track->file);
+    track->readerSource.reset(new CachedTrackSource(decoded));
+    track->decodedAudio = std::move(decoded);
+  }
+  // and neither does one that was transcoded into the disk cache on an earlier load
+  else if (auto mapped = pcmDiskCache->openTrack(track->file, mappedSampleRate)) {
+    track->sampleRate = mappedSampleRate;
+    track->readerSource.reset(new CachedTrackSource(mapped));
+    track->decodedAudio = std::move(mapped);
+    track->isMemoryMapped = true;
+  }
+  else {
+    // convert the audioURL into an audio input stream 
+    // and pass the input stream into AudioFormatManager to create a reader
+    auto* reader = formatManager.createReaderFor(audioURL.createInputStream(false));
+
+    // check if the reader is created successfully
+    if (reader == nullptr) {
+      error = "could not open " + audioURL.toString(false);
+      return nullptr;
+    }
+
+    track->sampleRate = reader->sampleRate;
+    numChannels = (int) reader->numChannels;
 
-  // check if the reader is created successfully
-  if (reader != nullptr) { // if successful
     // Create an AudioFormatReaderSource - take numbers out of audio file and wraps up with the audio life cycle so we can use it as an audio source
-    std::unique_ptr<AudioFormatReaderSource> newSource(new AudioFormatReaderSource(reader, true));
-    // Pass the AudioFormatReaderSource into the transport source
-    transportSource.setSource(newSource.get(), 0, nullptr, reader->sampleRate);
+    track->readerSource.reset(new AudioFormatReaderSource(reader, true));
+
+    // decode the whole track in the background so that seeks and reloads become memory reads,
+    // or keep a raw PCM copy on disk if it is too long to stay in memory - never both, so a
+    // new track is only decoded once
+    if (trackCache->canHold(reader->lengthInSamples, numChannels))
+      trackCache->requestDecode(track->file);
+    else
+      pcmDiskCache->requestTranscode(track->file);
+  }
+
+  // Wrap it in a read-ahead buffer so that decoding happens on the scheduler's
+  // workers instead of inside the audio callback
+  track->buffer.reset(new ReadAheadBuffer(track->readerSource.get(), false,
+                                          readAheadScheduler,
+                                          jmax(2, numChannels),
+                                          track->sampleRate));
+
+  if (track->decodedAudio != nullptr)
+    track->buffer->setDecodedAudio(track->decodedAudio, track->isMemoryMapped);
+
+  // allocate and fill the start of the buffer now, so that the audio thread only has to exchange pointers
+  if (preparedSampleRate > 0) {
+    track->buffer->prepareToPlay(PolyphaseResampler::getMaxInputBlockSize(preparedBlockSize), track->sampleRate);
+    track->buffer->prime();
+  }
+
+  return track;
+}
+
+/* Hands the prepared track to the audio thread (message thread only) */
+bool DJAudioPlayer::installTrack(std::unique_ptr<PreparedTrack> track) {
+  catchUpWithAudioThread();
+
+  track->buffer->setPlaybackState(isPlaying, speedRatio);
+
+  // The audio thread swaps the new buffer in at the start of its next block, and changes the
+  // sample rate of the time-stretcher and resampler at the same time
+  Command swap;
+  swap.type = Command::Type::swapTrack;
+  swap.value = track->sampleRate;
+  swap.source = track->buffer.get();
+  swap.swapGeneration = swapGeneration + 1;
+
+  if (!commands.push(swap)) {
+    DBG("DJAudioPlayer::installTrack - command queue full");
+    return false;
+  }
+
+  ++swapGeneration;
+  loadedSampleRate = track->sampleRate;
+
+  DBG("DJAudioPlayer::loadURL loaded");
+
+  // a loop belongs to the track it was set on
+  ++loopGeneration;
+  pendingLoop = {};
+
+  if (loopRegion != nullptr) {
+    Retired oldLoop;
+    oldLoop.loop = std::move(loopRegion);
+    oldLoop.replacedBySwap = swapGeneration;
+    retired.push_back(std::move(oldLoop));
+  }
+
+  // keep the track on this deck in the cache, and let the previous one be evicted
+  trackCache->pin(track->file);
+  trackCache->unpin(loadedFile);
+  loadedFile = track->file;
+
+  // the previous track stays alive until the audio thread has swapped it out
+  if (readAheadSource != nullptr) {
+    readAheadSource->setPlaybackState(false, speedRatio);
+
+    Retired oldTrack;
+    oldTrack.track = std::make_unique<PreparedTrack>();
+    oldTrack.track->buffer = std::move(readAheadSource);
+    oldTrack.track->readerSource = std::move(readerSource);
+    oldTrack.replacedBySwap = swapGeneration;
+    retired.push_back(std::move(oldTrack));
+  }
+
+  releaseRetired();
+
+  // pass the pointers to the class scope variables
+  readAheadSource = std::move(track->buffer);
+  readerSource = std::move(track->readerSource);
+
+  return true;
+}
+
+/* Open and pre-roll the track to play after the current one */
+void DJAudioPlayer::prepareNextTrack(URL audioURL) {
+  catchUpWithAudioThread();
+
+  auto generation = ++nextGeneration;
+  nextTrackFile = audioURL.isLocalFile() ? audioURL.getLocalFile() : File();
+  isNextTrackOpening = true;
+
+  WeakReference<DJAudioPlayer> weakThis(this);
+
+  loaderPool.addJob([this, weakThis, generation, audioURL] {
+    if (nextGeneration != generation)
+      return;
+
+    String error;
+    std::shared_ptr<PreparedTrack> track(prepareTrack(audioURL, error).release());
+
+    MessageManager::callAsync([weakThis, generation, track, error] {
+      auto* player = weakThis.get();
+
+      // the player has gone, or the next track was replaced while this one was opening
+      if (player == nullptr || player->nextGeneration != generation)
+        return;
+
+      player->isNextTrackOpening = false;
+
+      // the deck falls back to loading it when the current track ends
+      if (track == nullptr) {
+        DBG("DJAudioPlayer::prepareNextTrack " << error);
+        return;
+      }
+
+      player->installNextTrack(std::make_unique<PreparedTrack>(std::move(*track)));
+    });
+  });
+}
+
+/* Hands the prepared next track to the audio thread (message thread only) */
+void DJAudioPlayer::installNextTrack(std::unique_ptr<PreparedTrack> track) {
+  catchUpWithAudioThread();
+
+  // filled at low priority until it starts playing
+  track->buffer->setPlaybackState(false, speedRatio);
+
+  Command next;
+  next.type = Command::Type::setNextTrack;
+  next.value = track->sampleRate;
+  next.source = track->buffer.get();
+  next.swapGeneration = swapGeneration + 1;
+
+  if (!commands.push(next)) {
+    DBG("DJAudioPlayer::installNextTrack - command queue full");
+    return;
+  }
+
+  ++swapGeneration;
+
+  if (nextTrack != nullptr) {
+    Retired oldNext;
+    oldNext.track = std::move(nextTrack);
+    oldNext.replacedBySwap = swapGeneration;
+    retired.push_back(std::move(oldNext));
+  }
+
+  nextTrack = std::move(track);
+  releaseRetired();
+
+  // watch for the audio thread moving on to it
+  watchAudioThread();
+}
+
+/* Forget the next track */
+void DJAudioPlayer::cancelNextTrack() {
+  catchUpWithAudioThread();
+
+  ++nextGeneration;
+  nextTrackFile = File();
+  isNextTrackOpening = false;
+
+  if (nextTrack == nullptr)
+    return;
+
+  Command clear;
+  clear.type = Command::Type::clearNextTrack;
+  clear.swapGeneration = swapGeneration + 1;
+
+  if (!commands.push(clear)) {
+    DBG("DJAudioPlayer::cancelNextTrack - command queue full");
+    return;
+  }
+
+  ++swapGeneration;
+
+  Retired oldNext;
+  oldNext.track = std::move(nextTrack);
+  oldNext.replacedBySwap = swapGeneration;
+  retired.push_back(std::move(oldNext));
+
+  releaseRetired();
+}
+
+/* Get the file passed to prepareNextTrack */
+File DJAudioPlayer::getNextTrackFile() {
+  catchUpWithAudioThread();
+
+  return nextTrackFile;
+}
+
+/* Checks whether the next track is ready for a gapless transition */
+bool DJAudioPlayer::isNextTrackReady() {
+  catchUpWithAudioThread();
+
+  return nextTrack != nullptr;
+}
+
+/* Checks whether the next track is still being opened */
+bool DJAudioPlayer::isNextTrackPending() {
+  catchUpWithAudioThread();
+
+  return isNextTrackOpening;
+}
+
+/* Get how much of the next track is already decoded */
+double DJAudioPlayer::getNextTrackPreRollSeconds() {
+  catchUpWithAudioThread();
+
+  return nextTrack != nullptr ? nextTrack->buffer->getBufferedSeconds() : 0;
+}
+
+/* Set how long the end of a track overlaps the start of the next one */
+void DJAudioPlayer::setTransitionCrossfade(double seconds) {
+  transitionCrossfadeSeconds = jmax(0.0, seconds);
+}
+
+/* Get the silence left by the last transition */
+double DJAudioPlayer::getLastTransitionGap() {
+  return lastTransitionGap.load();
+}
+
+/* Watches for the audio thread moving on to the next track, and frees what it has swapped out */
+void DJAudioPlayer::timerCallback() {
+  catchUpWithAudioThread();
+  releaseRetired();
+
+  // once there's no next track and the audio thread has caught up, it can't move on any more
+  if (nextTrack == nullptr && appliedSwapGeneration.load() == swapGeneration && retired.empty())
+    stopTimer();
+}
+
+/* Takes over a track advance and frees what the audio thread has swapped out, on the calling thread */
+void DJAudioPlayer::releaseSwappedOut() {
+  catchUpWithAudioThread();
+  releaseRetired();
+}
+
+/* Takes over the next track if the audio thread has moved on to it since the last call */
+void DJAudioPlayer::catchUpWithAudioThread() {
+  auto advances = trackAdvances.load();
+
+  if (advances != seenTrackAdvances) {
+    seenTrackAdvances = advances;
+    handleTrackAdvance();
+  }
+}
 
-    DBG("DJAudioPlayer::loadURL loaded");
+/* Start the timer, unless it is running already */
+void DJAudioPlayer::watchAudioThread() {
+  // an offline player is caught up by releaseSwappedOut on the thread that renders it
+  if (isOffline)
+    return;
 
-    // if anything goes wrong this will exit out of the function and clear up the memory
-    // otherwise pass the pointer to the class scope variable
-    readerSource.reset(newSource.release());
+  if (!isTimerRunning())
+    startTimerHz(20);
+}
+
+/* Takes over the track the audio thread has moved on to (message thread only) */
+void DJAudioPlayer::handleTrackAdvance() {
+  auto* playing = playingSource.load();
+  std::unique_ptr<PreparedTrack> promoted;
+
+  // usually the next track, but it may have been replaced just as the audio thread got to it
+  if (nextTrack != nullptr && nextTrack->buffer.get() == playing) {
+    promoted = std::move(nextTrack);
+  }
+  else {
+    for (auto& r : retired)
+      if (r.track != nullptr && r.track->buffer.get() == playing)
+        promoted = std::move(r.track);
+  }
+
+  if (promoted == nullptr)
+    return;
+
+  // the audio thread has already let go of the previous track and its loop
+  if (readAheadSource != nullptr) {
+    Retired oldTrack;
+    oldTrack.track = std::make_unique<PreparedTrack>();
+    oldTrack.track->buffer = std::move(readAheadSource);
+    oldTrack.track->readerSource = std::move(readerSource);
+    oldTrack.replacedBySwap = 0;
+    retired.push_back(std::move(oldTrack));
+  }
+
+  ++loopGeneration;
+  pendingLoop = {};
+
+  if (loopRegion != nullptr) {
+    Retired oldLoop;
+    oldLoop.loop = std::move(loopRegion);
+    oldLoop.replacedBySwap = 0;
+    retired.push_back(std::move(oldLoop));
+  }
+
+  trackCache->pin(promoted->file);
+  trackCache->unpin(loadedFile);
+  loadedFile = promoted->file;
+  loadedSampleRate = promoted->sampleRate;
+
+  readAheadSource = std::move(promoted->buffer);
+  readerSource = std::move(promoted->readerSource);
+  readAheadSource->setPlaybackState(isPlaying, speedRatio);
+
+  nextTrackFile = File();
+  releaseRetired();
+
+  DBG("DJAudioPlayer::handleTrackAdvance " << loadedFile.getFullPathName());
+
+  if (onNextTrackStarted != nullptr)
+    onNextTrackStarted(loadedFile);
+}
+
+/* Switch to the next track (audio thread only) */
+void DJAudioPlayer::advanceToNextTrack() {
+  currentSource = nextSource;
+  currentSampleRate = nextSampleRate;
+  nextSource = nullptr;
+
+  // the stretcher and resampler carry straight on, only their rate changes if it has to
+  timeStretcher.setSourceSampleRate(currentSampleRate);
+  resampler.setSourceSampleRate(currentSampleRate);
+  loopEngine.reset();
+
+  playingSource = currentSource;
+  ++trackAdvances;
+}
+
+/* Builds the region for a loop (message thread only) */
+void DJAudioPlayer::requestLoop(int64 start, int64 end, bool isRoll) {
+  catchUpWithAudioThread();
+
+  auto generation = ++loopGeneration;
+  pendingLoop = {};
+
+  if (readAheadSource == nullptr || loadedSampleRate <= 0 || end <= start)
+    return;
+
+  auto crossfade = roundToInt(loopCrossfadeSeconds * loadedSampleRate);
+
+  // a track that is already decoded (or memory-mapped) is looped in place, without a copy
+  double mappedSampleRate = 0;
+  auto decoded = trackCache->getTrack(loadedFile);
+
+  if (decoded == nullptr)
+    decoded = pcmDiskCache->openTrack(loadedFile, mappedSampleRate);
+
+  if (decoded != nullptr) {
+    installLoop(LoopEngine::createRegion(decoded, start, end, crossfade), isRoll);
+    return;
+  }
+
+  // a long loop waits for the whole track, which is already being decoded (or transcoded).
+  // Until then it wraps on the read-ahead stream, so it loops straight away
+  int64 maxLength = -1;
+
+  if ((end - start) / loadedSampleRate > maxDecodedLoopSeconds) {
+    installLoop(LoopEngine::createStreamedRegion(start, end, readAheadSource->getTotalLength()), isRoll);
+
+    pendingLoop = { start, end };
+    pendingLoopIsRoll = isRoll;
+
+    // with its start decoded, the wrap plays from memory while the read-ahead catches up
+    maxLength = (int64) std::llround(streamedLoopHeadSeconds * loadedSampleRate);
   }
+
+  // a short one (or a long one's start) is decoded on its own in the background
+  WeakReference<DJAudioPlayer> weakThis(this);
+  auto file = loadedFile;
+
+  loaderPool.addJob([this, weakThis, generation, file, start, end, crossfade, maxLength, isRoll] {
+    if (loopGeneration != generation)
+      return;
+
+    std::shared_ptr<LoopEngine::Region> region;
+    std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+    if (reader != nullptr)
+      region = LoopEngine::decodeRegion(*reader, start, end, crossfade, maxLength);
+
+    MessageManager::callAsync([weakThis, generation, region, isRoll] {
+      auto* player = weakThis.get();
+
+      if (player == nullptr)
+        return;
+
+      // a track advance since the request takes the loop with it
+      player->catchUpWithAudioThread();
+
+      // the loop was replaced or cleared while it was decoding
+      if (player->loopGeneration != generation || region == nullptr)
+        return;
+
+      player->installLoop(std::make_unique<LoopEngine::Region>(std::move(*region)), isRoll);
+    });
+  });
+}
+
+/* Hands a loop region to the audio thread (message thread only) */
+void DJAudioPlayer::installLoop(std::unique_ptr<LoopEngine::Region> region, bool isRoll) {
+  catchUpWithAudioThread();
+
+  if (region == nullptr)
+    return;
+
+  Command loop;
+  loop.type = Command::Type::setLoop;
+  loop.loop = region.get();
+  loop.isRoll = isRoll;
+  loop.swapGeneration = swapGeneration + 1;
+
+  if (!commands.push(loop)) {
+    DBG("DJAudioPlayer::installLoop - command queue full");
+    return;
+  }
+
+  ++swapGeneration;
+
+  if (loopRegion != nullptr) {
+    Retired oldLoop;
+    oldLoop.loop = std::move(loopRegion);
+    oldLoop.replacedBySwap = swapGeneration;
+    retired.push_back(std::move(oldLoop));
+  }
+
+  loopRegion = std::move(region);
+  releaseRetired();
+}
+
+/* Frees the tracks and loops the audio thread has swapped out (message thread, or the rendering thread offline) */
+void DJAudioPlayer::releaseRetired() {
+  auto applied = appliedSwapGeneration.load();
+
+  retired.erase(std::remove_if(retired.begin(), retired.end(),
+                               [this, applied](const Retired& r) {
+                                 // a replaced next track may still have become the one playing
+                                 return r.replacedBySwap <= applied
+                                     && (r.track == nullptr || r.track->buffer.get() != playingSource.load());
+                               }),
+                retired.end());
+
+  // check again on the timer if the audio thread hasn't got to the swap yet
+  if (!retired.empty())
+    watchAudioThread();
+}
+
+/* Queue a command for the audio thread */
+void DJAudioPlayer::pushCommand(const Command& command) {
+  if (!commands.push(command))
+    DBG("DJAudioPlayer::pushCommand - command queue full, command dropped");
+}
+
+/* Apply the queued commands (audio thread, start of each block) */
+void DJAudioPlayer::handleCommands() {
+  commands.drain([this](const Command& command) {
+    switch (command.type) {
+      case Command::Type::start:
+        if (currentSource != nullptr) {
+          audioPlaying = true;
+
+          // a new track started after the last one ran out: that's the gap of the transition
+          if (endedWithoutNext && swappedSinceEnd && preparedSampleRate > 0)
+            lastTransitionGap = silenceSinceEnd / preparedSampleRate.load();
+
+          endedWithoutNext = false;
+        }
+        break;
+
+      case Command::Type::stop:
+        audioPlaying = false;
+        endedWithoutNext = false;
+        smoothedGain.setTargetValue(0.0f);
+        break;
+
+      case Command::Type::setPosition:
+        if (currentSource != nullptr && currentSampleRate > 0) {
+          currentSource->setNextReadPosition((int64) (command.value * currentSampleRate));
+
+          // the next track may have started fading in already
+          if (nextSource != nullptr)
+            nextSource->setNextReadPosition(0);
+
+          // don't let the audio from before the jump bleed into the new position
+          timeStretcher.reset();
+          resampler.reset();
+        }
+        break;
+
+      case Command::Type::swapTrack:
+        currentSource = command.source;
+        currentSampleRate = command.value;
+
+        timeStretcher.setSourceSampleRate(currentSampleRate);
+        resampler.setSourceSampleRate(currentSampleRate);
+        timeStretcher.reset();
+        resampler.reset();
+
+        // the previous track's loop goes with it
+        loopEngine.reset();
+        playingSource = currentSource;
+        swappedSinceEnd = true;
+
+        // from here on the previous track can be freed
+        appliedSwapGeneration = command.swapGeneration;
+        break;
+
+      case Command::Type::setLoop:
+        if (currentSource != nullptr)
+          loopEngine.setRegion(command.loop, *currentSource, command.isRoll);
+
+        appliedSwapGeneration = command.swapGeneration;
+        break;
+
+      case Command::Type::clearLoop:
+        if (currentSource != nullptr)
+          loopEngine.clear(*currentSource);
+        else
+          loopEngine.reset();
+
+        appliedSwapGeneration = command.swapGeneration;
+        break;
+
+      case Command::Type::setNextTrack:
+        nextSource = command.source;
+        nextSampleRate = command.value;
+        transitionOverlap = roundToInt(transitionCrossfadeSeconds.load() * nextSampleRate);
+        appliedSwapGeneration = command.swapGeneration;
+
+        // it arrived too late for a gapless start, but still starts as soon as it can
+        if (endedWithoutNext && currentSource != nullptr) {
+          if (preparedSampleRate > 0)
+            lastTransitionGap = silenceSinceEnd / preparedSampleRate.load();
+
+          endedWithoutNext = false;
+          audioPlaying = true;
+          advanceToNextTrack();
+        }
+        break;
+
+      case Command::Type::clearNextTrack:
+        nextSource = nullptr;
+        appliedSwapGeneration = command.swapGeneration;
+        break;
+
+      case Command::Type::setSpeed:
+        // with key-lock on, the stretcher changes the tempo and the resampler only converts the rate
+        timeStretcher.setEnabled(command.keyLock);
+        timeStretcher.setTempo(command.value);
+        resampler.setSpeed(command.keyLock ? 1.0 : command.value);
+        break;
+    }
+  });
+}
+
+/* Switch the loaded track over to its decoded copy once it is in the cache */
+void DJAudioPlayer::trackDecoded(const File& file) {
+  catchUpWithAudioThread();
+
+  if (file == loadedFile && readAheadSource != nullptr) {
+    readAheadSource->setDecodedAudio(trackCache->getTrack(file));
+
+    // a long loop was waiting for this
+    if (!pendingLoop.isEmpty())
+      requestLoop(pendingLoop.getStart(), pendingLoop.getEnd(), pendingLoopIsRoll);
+  }
+}
+
+/* Switch the loaded track over to its memory-mapped copy once it is in the disk cache */
+void DJAudioPlayer::trackTranscoded(const File& file) {
+  catchUpWithAudioThread();
+
+  if (file != loadedFile || readAheadSource == nullptr)
+    return;
+
+  double mappedSampleRate = 0;
+
+  if (auto mapped = pcmDiskCache->openTrack(file, mappedSampleRate))
+    readAheadSource->setDecodedAudio(std::move(mapped), true);
+
+  // a long loop on a track too big for the memory cache was waiting for this
+  if (!pendingLoop.isEmpty())
+    requestLoop(pendingLoop.getStart(), pendingLoop.getEnd(), pendingLoopIsRoll);
 }
 
 /* Set the volume control */
@@ -63,23 +954,118 @@ void DJAudioPlayer::setGain(double gain) {
     DBG("DJAudioPlayer::setGain - gain should be between 0 and 1");
   }
   else {
-    transportSource.setGain(gain);
+    targetGain = (float) gain;
   }
 }
 
 /* Set the speed control */
 void DJAudioPlayer::setSpeed(double ratio) {
+  catchUpWithAudioThread();
+
   if (ratio < 0 || ratio > 2.0) {
     DBG("DJAudioPlayer::setSpeed - ratio should be between 0 and 2");
   }
   else {
-    resampleSource.setResamplingRatio(ratio);
+    speedRatio = ratio;
+    playbackSpeed = ratio;
+
+    Command speed;
+    speed.type = Command::Type::setSpeed;
+    speed.value = ratio;
+    speed.keyLock = keyLocked;
+    pushCommand(speed);
+
+    if (readAheadSource != nullptr)
+      readAheadSource->setPlaybackState(isPlaying, speedRatio);
   }
 }
 
 /* Set the position control */
 void DJAudioPlayer::setPosition(double posInSecs) {
-  transportSource.setPosition(posInSecs);
+  Command seek;
+  seek.type = Command::Type::setPosition;
+  seek.value = jmax(0.0, posInSecs);
+  pushCommand(seek);
+}
+
+/* Loop a section of the track */
+void DJAudioPlayer::setLoop(double startInSecs, double endInSecs) {
+  requestLoop((int64) std::llround(startInSecs * loadedSampleRate),
+              (int64) std::llround(endInSecs * loadedSampleRate),
+              false);
+}
+
+/* Start a loop roll of a number of beats from the playhead */
+void DJAudioPlayer::startLoopRoll(double numBeats, double bpm) {
+  if (numBeats <= 0 || bpm <= 0) {
+    DBG("DJAudioPlayer::startLoopRoll - beats and bpm should be positive");
+    return;
+  }
+
+  auto start = (int64) std::llround(getPosition() * loadedSampleRate);
+  auto length = (int64) std::llround(numBeats * 60.0 / bpm * loadedSampleRate);
+
+  requestLoop(start, start + length, true);
+}
+
+/* Stop looping (and end a loop roll) */
+void DJAudioPlayer::clearLoop() {
+  catchUpWithAudioThread();
+
+  // also cancels a loop that is still decoding
+  ++loopGeneration;
+  pendingLoop = {};
+
+  if (loopRegion == nullptr)
+    return;
+
+  Command clear;
+  clear.type = Command::Type::clearLoop;
+  clear.swapGeneration = swapGeneration + 1;
+
+  if (!commands.push(clear)) {
+    DBG("DJAudioPlayer::clearLoop - command queue full");
+    return;
+  }
+
+  ++swapGeneration;
+
+  Retired oldLoop;
+  oldLoop.loop = std::move(loopRegion);
+  oldLoop.replacedBySwap = swapGeneration;
+  retired.push_back(std::move(oldLoop));
+
+  releaseRetired();
+}
+
+/* Checks whether a loop is set */
+bool DJAudioPlayer::hasLoop() {
+  catchUpWithAudioThread();
+
+  return loopRegion != nullptr || !pendingLoop.isEmpty();
+}
+
+/* Set the length of the crossfade at the loop wrap */
+void DJAudioPlayer::setLoopCrossfade(double seconds) {
+  loopCrossfadeSeconds = jmax(0.0, seconds);
+}
+
+/* Turn key-lock on or off */
+void DJAudioPlayer::setKeyLock(bool shouldLock) {
+  keyLocked = shouldLock;
+  setSpeed(speedRatio);
+}
+
+/* Checks whether key-lock is on */
+bool DJAudioPlayer::isKeyLocked() {
+  return keyLocked;
+}
+
+/* Get the delay added by the time-stretcher while key-lock is on */
+double DJAudioPlayer::getKeyLockLatency() {
+  catchUpWithAudioThread();
+
+  return loadedSampleRate > 0 ? timeStretcher.getLatencyInSamples() / loadedSampleRate : 0;
 }
 
 /* Set the position such that it matches the length of the audio file */
@@ -89,37 +1075,171 @@ void DJAudioPlayer::setPositionRelative(double pos) {
   }
 
   else {
-    double posInSecs = transportSource.getLengthInSeconds() * pos;
+    double posInSecs = getLengthInSeconds() * pos;
     setPosition(posInSecs);
   }
 }
 
 /* Start playing the track */
 void DJAudioPlayer::start() {
-  transportSource.start();
+  catchUpWithAudioThread();
+
+  Command play;
+  play.type = Command::Type::start;
+  pushCommand(play);
+
   isPlaying = true; // set true if the track starts playing
+
+  if (readAheadSource != nullptr)
+    readAheadSource->setPlaybackState(isPlaying, speedRatio);
 }
 
 /* Stop playing the track */
 void DJAudioPlayer::stop() {
-  transportSource.stop();
+  catchUpWithAudioThread();
+
+  Command pause;
+  pause.type = Command::Type::stop;
+  pushCommand(pause);
+
   isPlaying = false; // set to false if the track stops playing
+
+  if (readAheadSource != nullptr)
+    readAheadSource->setPlaybackState(isPlaying, speedRatio);
 }
 
 /* Get the relative position of the playhead */
 double DJAudioPlayer::getPositionRelative() {
-  if (transportSource.getLengthInSeconds() == 0)
+  if (getLengthInSeconds() == 0)
     return 0;
 
-  return transportSource.getCurrentPosition() / transportSource.getLengthInSeconds();
+  return getPosition() / getLengthInSeconds();
 }
 
 /* Get the current position of the playhead */
 double DJAudioPlayer::getPosition() {
-  return transportSource.getCurrentPosition();
+  catchUpWithAudioThread();
+
+  if (readAheadSource == nullptr || loadedSampleRate <= 0)
+    return 0;
+
+  // the read position is atomic, so it can be read while the audio thread moves it
+  return readAheadSource->getNextReadPosition() / loadedSampleRate;
 }
 
 /* Get the length of file in seconds */
 double DJAudioPlayer::getLengthInSeconds() {
-  return transportSource.getLengthInSeconds();
+  catchUpWithAudioThread();
+
+  if (readAheadSource == nullptr || loadedSampleRate <= 0)
+    return 0;
+
+  return readAheadSource->getTotalLength() / loadedSampleRate;
+}
+
+/* Get the amount of audio decoded ahead of the playhead */
+double DJAudioPlayer::getBufferedSeconds() {
+  catchUpWithAudioThread();
+
+  return readAheadSource != nullptr ? readAheadSource->getBufferedSeconds() : 0;
+}
+
+/* Get the read-ahead fill level relative to the size of the buffer */
+double DJAudioPlayer::getBufferFillLevel() {
+  catchUpWithAudioThread();
+
+  return readAheadSource != nullptr ? readAheadSource->getFillLevel() : 0;
+}
+
+/* Get the number of blocks played before they had been decoded */
+int DJAudioPlayer::getBufferUnderruns() {
+  catchUpWithAudioThread();
+
+  return readAheadSource != nullptr ? readAheadSource->getUnderrunCount() : 0;
+}
+
+/* Set the quality of the deck's resampler */
+void DJAudioPlayer::setResamplerQuality(PolyphaseResampler::Quality quality) {
+  resampler.setQuality(quality);
+}
+
+/* Get the share of the audio callback's time budget used by the resampler */
+double DJAudioPlayer::getResamplerCpuLoad() {
+  return resampler.getCpuLoad();
+}
+
+/* Get the timing of the deck's audio callbacks */
+AudioCallbackStats& DJAudioPlayer::getCallbackStats() {
+  return callbackStats;
+}
+
+/* Get the latest playhead published by the audio thread */
+DJAudioPlayer::PlayheadSnapshot DJAudioPlayer::getPlayhead() const {
+  PlayheadSnapshot snapshot;
+
+  // retry if the audio thread published a new snapshot while this one was being read
+  for (;;) {
+    auto sequence = playheadSequence.load(std::memory_order_acquire);
+
+    if ((sequence & 1) != 0)
+      continue;
+
+    snapshot.seconds = playheadSeconds.load(std::memory_order_relaxed);
+    snapshot.lengthInSeconds = playheadLength.load(std::memory_order_relaxed);
+    snapshot.speed = playheadSpeed.load(std::memory_order_relaxed);
+    snapshot.timestamp = playheadTimestamp.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (playheadSequence.load(std::memory_order_relaxed) == sequence)
+      return snapshot;
+  }
+}
+
+/* Publish the playhead at the start of a block */
+void DJAudioPlayer::publishPlayhead(int numSamples) {
+  // a stall (or the first block) puts the clock back on the callback's own time
+  constexpr double maxClockDriftMs = 20.0;
+
+  auto now = Time::getMillisecondCounterHiRes();
+  auto deviceRate = preparedSampleRate.load();
+  auto blockTime = clockAnchorMs + (deviceRate > 0 ? clockSamples * 1000.0 / deviceRate : 0.0);
+
+  // blocks are timed by the samples played rather than by when the callback ran, which
+  // jitters with the device's buffering
+  if (deviceRate <= 0 || std::abs(now - blockTime) > maxClockDriftMs) {
+    clockAnchorMs = now;
+    clockSamples = 0;
+    blockTime = now;
+  }
+
+  clockSamples += numSamples;
+
+  auto hasTrack = currentSource != nullptr && currentSampleRate > 0;
+  auto sequence = playheadSequence.load(std::memory_order_relaxed);
+
+  playheadSequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  playheadSeconds.store(hasTrack ? currentSource->getNextReadPosition() / currentSampleRate : 0.0, std::memory_order_relaxed);
+  playheadLength.store(hasTrack ? currentSource->getTotalLength() / currentSampleRate : 0.0, std::memory_order_relaxed);
+  playheadSpeed.store(hasTrack && audioPlaying ? playbackSpeed.load() : 0.0, std::memory_order_relaxed);
+  playheadTimestamp.store(blockTime, std::memory_order_relaxed);
+
+  playheadSequence.store(sequence + 2, std::memory_order_release);
+}
+
+/* Get the position in the track at a time, interpolated from the snapshot */
+double DJAudioPlayer::PlayheadSnapshot::getSecondsAt(double now) const {
+  // never run on for long past the last block, in case the audio has stopped coming
+  constexpr double maxInterpolationMs = 250.0;
+
+  auto elapsed = jlimit(0.0, maxInterpolationMs, now - timestamp);
+
+  return jlimit(0.0, lengthInSeconds, seconds + speed * elapsed / 1000.0);
+}
+
+/* Get the position at a time relative to the length of the track */
+double DJAudioPlayer::PlayheadSnapshot::getRelativeAt(double now) const {
+  return lengthInSeconds > 0 ? getSecondsAt(now) / lengthInSeconds : 0.0;
 }
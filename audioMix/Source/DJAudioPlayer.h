@@ -9,16 +9,78 @@
 */
 
 #pragma once
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
+#include "ReadAheadBuffer.h"
+#include "DecodedTrackCache.h"
+#include "PcmDiskCache.h"
+#include "PolyphaseResampler.h"
+#include "TimeStretcher.h"
+#include "CommandQueue.h"
+#include "LoopEngine.h"
+#include "AudioCallbackStats.h"
 
-class DJAudioPlayer : public AudioSource {
+class DJAudioPlayer : public AudioSource,
+                      public DecodedTrackCache::Listener,
+                      public PcmDiskCache::Listener,
+                      private Timer {
 public:
+  /**
+   * \brief
+   *    Where the audio thread was in the track at the start of its last block, and how fast
+   *    it was moving, so that the GUI can work out the playhead for any moment in between.
+   */
+  struct PlayheadSnapshot {
+    double seconds = 0;           // position in the track at timestamp
+    double lengthInSeconds = 0;
+    double speed = 0;             // track seconds per second, 0 while stopped
+    double timestamp = 0;         // Time::getMillisecondCounterHiRes() of the block, on the device's sample clock
+
+    /**
+     * \brief
+     *    Get the position in the track at a time, interpolated from the snapshot.
+     *
+     * \param now
+     *    The time, from Time::getMillisecondCounterHiRes()
+     */
+    double getSecondsAt(double now) const;
+
+    /**
+     * \brief
+     *    Get the position at a time relative to the length of the track.
+     */
+    double getRelativeAt(double now) const;
+  };
 
   /**
    * \brief
    *    Constructor.
+   *
+   * \param _formatManager
+   *    Used to create a reader for each loaded file
+   * \param _readAheadScheduler
+   *    The shared pool of threads that decodes ahead of the playhead
+   */
+  DJAudioPlayer(AudioFormatManager& _formatManager, ReadAheadScheduler& _readAheadScheduler);
+
+  /**
+   * \brief
+   *    Constructor for a player with caches of its own rather than the shared ones (e.g. to
+   *    render a mix offline). The player doesn't listen to them and never starts its timer, so
+   *    it never needs the message thread and can be controlled and rendered from any one thread,
+   *    which calls releaseSwappedOut between blocks. A track it loads is played from its
+   *    read-ahead stream, and only later loads of it play from the decoded copy.
+   *
+   * \param _formatManager
+   *    Used to create a reader for each loaded file
+   * \param _readAheadScheduler
+   *    The pool of threads that decodes ahead of the playhead
+   * \param _trackCache
+   *    Where tracks are decoded to (must outlive the player)
+   * \param _pcmDiskCache
+   *    Where tracks too long for the trackCache are transcoded to (must outlive the player)
    */
-  DJAudioPlayer(AudioFormatManager& _formatManager);
+  DJAudioPlayer(AudioFormatManager& _formatManager, ReadAheadScheduler& _readAheadScheduler,
+                DecodedTrackCache& _trackCache, PcmDiskCache& _pcmDiskCache);
 
   /**
    * \brief
@@ -63,7 +125,112 @@ public:
 
   /**
    * \brief
-   *    Set the volume control.
+   *    Load a file without blocking the caller.
+   *    The file is opened and its first block decoded on a background thread, then installed
+   *    on the message thread between two audio blocks. A newer call cancels any older load
+   *    that has not been installed yet (its callbacks are never called).
+   *
+   * \param audioURL
+   *    The URL to be loaded
+   * \param onLoaded
+   *    Called on the message thread once the track is playing from this player
+   * \param onFailed
+   *    Called on the message thread with a description of the error if the file can't be opened
+   */
+  void loadURLAsync(URL audioURL,
+                    std::function<void()> onLoaded = nullptr,
+                    std::function<void(const String&)> onFailed = nullptr);
+
+  /**
+   * \brief
+   *    Cancel any asynchronous load that has not been installed yet.
+   */
+  void cancelPendingLoad();
+
+  /**
+   * \brief
+   *    Open and pre-roll the track to play after the current one. The audio thread switches
+   *    to it at the exact sample where the current track ends (or crossfades into it, see
+   *    setTransitionCrossfade), then onNextTrackStarted is called. Replaces any earlier next track.
+   *
+   * \param audioURL
+   *    The URL of the next track
+   */
+  void prepareNextTrack(URL audioURL);
+
+  /**
+   * \brief
+   *    Forget the next track.
+   */
+  void cancelNextTrack();
+
+  /**
+   * \brief
+   *    Get the file passed to prepareNextTrack (whether it is ready or not).
+   *
+   * \return
+   *    The next track, or File() if there is none
+   */
+  File getNextTrackFile();
+
+  /**
+   * \brief
+   *    Checks whether the next track is open and handed to the audio thread, so that the
+   *    transition will be gapless.
+   */
+  bool isNextTrackReady();
+
+  /**
+   * \brief
+   *    Checks whether the next track is still being opened.
+   */
+  bool isNextTrackPending();
+
+  /**
+   * \brief
+   *    Get how much of the next track is already decoded.
+   *
+   * \return
+   *    The next track's read-ahead fill level in seconds (0 if it isn't ready)
+   */
+  double getNextTrackPreRollSeconds();
+
+  /**
+   * \brief
+   *    Set how long the end of a track overlaps the start of the next one.
+   *    Only used when both tracks have the same sample rate.
+   *
+   * \param seconds
+   *    The crossfade length (0 to switch at the exact last sample)
+   */
+  void setTransitionCrossfade(double seconds);
+
+  /**
+   * \brief
+   *    Get the silence between the end of the last track and the start of the one after it.
+   *
+   * \return
+   *    The gap in seconds (0 for a gapless transition)
+   */
+  double getLastTransitionGap();
+
+  /**
+   * \brief
+   *    Called on the message thread when the audio thread has moved on to the next track.
+   */
+  std::function<void(const File&)> onNextTrackStarted;
+
+  /**
+   * \brief
+   *    Takes over a track the audio thread has moved on to, and frees the tracks and loops it
+   *    has swapped out, right away on the calling thread. For a player with caches of its own,
+   *    which has no timer to do this: call it between blocks from the thread that renders it.
+   */
+  void releaseSwappedOut();
+
+  /**
+   * \brief
+   *    Set the volume control. The audio thread ramps to it sample by sample.
    *
    * \param gain
    *    The new gain amount
@@ -72,7 +239,8 @@ public:
 
   /**
    * \brief
-   *    Set the speed control.
+   *    Set the speed control. The audio thread applies it, together with the key-lock,
+   *    at the start of its next block and ramps to it.
    *
    * \param ratio
    *    The new resampling ratio (speed)
@@ -81,7 +249,32 @@ public:
 
   /**
    * \brief
-   *    Set the position control (of the audio file).
+   *    Turn key-lock on or off. While it is on, the speed control changes the tempo
+   *    without changing the pitch.
+   *
+   * \param shouldLock
+   *    True to keep the pitch fixed
+   */
+  void setKeyLock(bool shouldLock);
+
+  /**
+   * \brief
+   *    Checks whether key-lock is on.
+   */
+  bool isKeyLocked();
+
+  /**
+   * \brief
+   *    Get the delay added by the time-stretcher while key-lock is on.
+   *
+   * \return
+   *    The latency in seconds (0 while key-lock is off)
+   */
+  double getKeyLockLatency();
+
+  /**
+   * \brief
+   *    Set the position control (of the audio file). Applied at the start of the next audio block.
    *
    * \param posInSecs
    *    The new playback position (in seconds)
@@ -99,13 +292,59 @@ public:
 
   /**
    * \brief
-   *    Start playing the track.
+   *    Loop a section of the track. The wrap happens sample-accurately in the audio callback,
+   *    with a short crossfade. The loop starts once its audio is decoded (straight away if the
+   *    track is already cached), and replaces any previous loop.
+   *
+   * \param startInSecs
+   *    Loop in (in seconds)
+   * \param endInSecs
+   *    Loop out (in seconds)
+   */
+  void setLoop(double startInSecs, double endInSecs);
+
+  /**
+   * \brief
+   *    Start a loop roll: loop a number of beats from the playhead, and when the roll is
+   *    stopped with clearLoop(), carry on from where the track would have been without it.
+   *
+   * \param numBeats
+   *    The length of the loop in beats (e.g. 0.25 to 4)
+   * \param bpm
+   *    The tempo of the track
+   */
+  void startLoopRoll(double numBeats, double bpm);
+
+  /**
+   * \brief
+   *    Stop looping (and end a loop roll).
+   */
+  void clearLoop();
+
+  /**
+   * \brief
+   *    Checks whether a loop is set (or waiting for its audio to be decoded).
+   */
+  bool hasLoop();
+
+  /**
+   * \brief
+   *    Set the length of the crossfade at the loop wrap. Applies to loops set after the call.
+   *
+   * \param seconds
+   *    The crossfade length (0 for a hard wrap)
+   */
+  void setLoopCrossfade(double seconds);
+
+  /**
+   * \brief
+   *    Start playing the track (fading in at the start of the next audio block).
    */
   void start();
 
   /**
    * \brief
-   *    Stop playing the track.
+   *    Stop playing the track (fading out at the start of the next audio block).
    */
   void stop();
 
@@ -136,16 +375,406 @@ public:
    */
   double getLengthInSeconds();
 
+  /**
+   * \brief
+   *    Get the amount of audio decoded ahead of the playhead.
+   *
+   * \return
+   *    The read-ahead fill level in seconds (0 if no track is loaded)
+   */
+  double getBufferedSeconds();
+
+  /**
+   * \brief
+   *    Get the read-ahead fill level relative to the size of the buffer.
+   *
+   * \return
+   *    The fill level between 0 and 1 (0 if no track is loaded)
+   */
+  double getBufferFillLevel();
+
+  /**
+   * \brief
+   *    Get the number of audio blocks that were played before they had been decoded.
+   *
+   * \return
+   *    The underrun count for the current track
+   */
+  int getBufferUnderruns();
+
+  /**
+   * \brief
+   *    Set the quality of the deck's resampler.
+   *
+   * \param quality
+   *    The new quality tier
+   */
+  void setResamplerQuality(PolyphaseResampler::Quality quality);
+
+  /**
+   * \brief
+   *    Get the share of the audio callback's time budget used by the deck's resampler.
+   *    1 / load is roughly how many decks can run at the current quality on one core.
+   *
+   * \return
+   *    The CPU load between 0 and 1
+   */
+  double getResamplerCpuLoad();
+
+  /**
+   * \brief
+   *    Get the timing of the deck's audio callbacks, split into the commands, track
+   *    (read-ahead, loop and transition), stretch, resample and gain stages.
+   *    Snapshots can be taken from any thread.
+   */
+  AudioCallbackStats& getCallbackStats();
+
+  /**
+   * \brief
+   *    Get the latest playhead published by the audio thread. Any thread; never locks or
+   *    calls into the engine.
+   */
+  PlayheadSnapshot getPlayhead() const;
+
+  /**
+   * \brief
+   *    Switches the loaded track over to its decoded copy once it is in the cache.
+   *
+   * \param file
+   *    The file that has just been decoded
+   */
+  void trackDecoded(const File& file) override;
+
+  /**
+   * \brief
+   *    Switches the loaded track over to its memory-mapped copy once it is in the disk cache.
+   *
+   * \param file
+   *    The file that has just been transcoded
+   */
+  void trackTranscoded(const File& file) override;
+
   /**
    * \brief
    *  variable for determining if the track is currently playing
    *  value is set to "true" if track is playing, false otherwise
+   *  (atomic, so that it can be read from any thread)
    */
-  bool isPlaying;
+  std::atomic<bool> isPlaying;
 
 private:
+  /**
+   * \brief
+   *    An event passed from the message thread to the audio thread.
+   */
+  struct Command {
+    enum class Type { start, stop, setPosition, swapTrack, setLoop, clearLoop, setNextTrack, clearNextTrack, setSpeed };
+
+    Type type = Type::stop;
+    double value = 0; // the position in seconds, the new track's sample rate, or the speed ratio
+    PositionableAudioSource* source = nullptr; // the new track, for swapTrack and setNextTrack
+    const LoopEngine::Region* loop = nullptr; // the new loop, for setLoop
+    bool isRoll = false; // for setLoop
+    bool keyLock = false; // for setSpeed
+    uint32 swapGeneration = 0; // for every command that hands over or takes back an object
+  };
+
+  /**
+   * \brief
+   *    The input of the deck's processing chain: plays whichever track the audio thread
+   *    has swapped in last, and stops the deck at the end of it.
+   */
+  class CurrentTrackSource : public AudioSource {
+  public:
+    CurrentTrackSource(DJAudioPlayer& _owner) : owner(_owner) {}
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+  private:
+    /**
+     * \brief
+     *    Mix the start of the next track into the part of the block from mixStart on.
+     */
+    void mixInNextTrack(const AudioSourceChannelInfo& info, int64 position, int64 mixStart, int overlap);
+
+    DJAudioPlayer& owner;
+    AudioBuffer<float> nextTrackBuffer;
+  };
+
+  /**
+   * \brief
+   *    Passes audio straight through from another source, adding up the time it takes,
+   *    so that the time of each stage of the chain can be told apart.
+   */
+  class TimedStage : public AudioSource {
+  public:
+    TimedStage(AudioSource* _input) : input(_input) {}
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+    // audio thread only, cleared by the deck at the start of each block
+    int64 ticks = 0;
+
+  private:
+    AudioSource* input;
+  };
+
+  // the stages timed in getCallbackStats()
+  enum Stage { commandsStage, trackStage, stretchStage, resampleStage, gainStage };
+
+  /**
+   * \brief
+   *    A track that has been opened and buffered but not yet handed to the audio thread.
+   */
+  struct PreparedTrack {
+    File file;
+    std::shared_ptr<const AudioBuffer<float>> decodedAudio; // set if the track was already cached
+    bool isMemoryMapped = false; // true if decodedAudio comes from the PcmDiskCache
+    std::unique_ptr<PositionableAudioSource> readerSource;
+    std::unique_ptr<ReadAheadBuffer> buffer; // reads from readerSource, so declared after it
+    double sampleRate = 0;
+  };
+
+  /**
+   * \brief
+   *    Opens the file and primes its read-ahead buffer. Safe to call on any thread.
+   *
+   * \param audioURL
+   *    The URL to be loaded
+   * \param error
+   *    Set to a description of the problem if the file can't be opened
+   *
+   * \return
+   *    The prepared track, or nullptr on failure
+   */
+  std::unique_ptr<PreparedTrack> prepareTrack(URL audioURL, String& error);
+
+  /**
+   * \brief
+   *    Hands a prepared track to the audio thread, which swaps it in at the start of its
+   *    next block. Message thread only.
+   *
+   * \return
+   *    False if the command queue was full and the track was not installed
+   */
+  bool installTrack(std::unique_ptr<PreparedTrack> track);
+
+  /**
+   * \brief
+   *    Hands a loop region to the audio thread. Message thread only.
+   */
+  void installLoop(std::unique_ptr<LoopEngine::Region> region, bool isRoll);
+
+  /**
+   * \brief
+   *    Builds the region for a loop, decoding it in the background if the track isn't
+   *    decoded yet. A long loop wraps on the read-ahead stream until a decoded copy of
+   *    the whole track is ready. Message thread only.
+   */
+  void requestLoop(int64 start, int64 end, bool isRoll);
+
+  /**
+   * \brief
+   *    Hands the prepared next track to the audio thread. Message thread only.
+   */
+  void installNextTrack(std::unique_ptr<PreparedTrack> track);
+
+  /**
+   * \brief
+   *    Takes over the track the audio thread has moved on to. Message thread only.
+   */
+  void handleTrackAdvance();
+
+  /**
+   * \brief
+   *    Takes over the next track if the audio thread has moved on to it since the last call.
+   *    Called at the top of every message-thread entry point that reads or replaces the
+   *    loaded, next or looped track, so none of them act on state the audio thread has left
+   *    behind while the timer has not run yet. Message thread only.
+   */
+  void catchUpWithAudioThread();
+
+  /**
+   * \brief
+   *    Switch to the next track. Audio thread only.
+   */
+  void advanceToNextTrack();
+
+  /**
+   * \brief
+   *    Watches for the audio thread moving on to the next track, and frees what it has swapped out.
+   */
+  void timerCallback() override;
+
+  /**
+   * \brief
+   *    Start the timer, unless it is running already. Message thread only.
+   */
+  void watchAudioThread();
+
+  /**
+   * \brief
+   *    Frees the tracks and loops the audio thread has swapped out. Message thread only.
+   *    Keeps the timer running until every replaced object has been freed.
+   */
+  void releaseRetired();
+
+  /**
+   * \brief
+   *    Queue a command for the audio thread.
+   */
+  void pushCommand(const Command& command);
+
+  /**
+   * \brief
+   *    Apply the queued commands. Audio thread only, at the start of each block.
+   */
+  void handleCommands();
+
+  /**
+   * \brief
+   *    Publish the playhead at the start of a block. Audio thread only, after handleCommands().
+   */
+  void publishPlayhead(int numSamples);
+
   AudioFormatManager& formatManager;
-  std::unique_ptr<AudioFormatReaderSource> readerSource;
-  AudioTransportSource transportSource;
-  ResamplingAudioSource resampleSource{ &transportSource, false, 2 };
+  ReadAheadScheduler& readAheadScheduler;
+  // the file reader, or a CachedTrackSource if the track was already decoded
+  std::unique_ptr<PositionableAudioSource> readerSource;
+
+  // decoded audio ahead of the playhead, filled by the readAheadScheduler's workers
+  std::unique_ptr<ReadAheadBuffer> readAheadSource;
+
+  // the shared caches, unless the player was given its own
+  std::unique_ptr<SharedResourcePointer<DecodedTrackCache>> sharedTrackCache;
+  std::unique_ptr<SharedResourcePointer<PcmDiskCache>> sharedPcmDiskCache;
+
+  // decoded tracks shared with the other deck and the waveform displays
+  DecodedTrackCache* trackCache;
+
+  // raw PCM copies of tracks played before, memory-mapped on later loads
+  PcmDiskCache* pcmDiskCache;
+
+  // true for a player with caches of its own, controlled and rendered from one thread: it doesn't
+  // switch to a track's decoded copy as soon as it is ready, and frees what it swapped out only
+  // when releaseSwappedOut is called
+  bool isOffline;
+
+  // the file currently loaded (pinned in the trackCache)
+  File loadedFile;
+
+  // the speed last passed to setSpeed (used for the read-ahead deadline)
+  double speedRatio;
+
+  // the key-lock last passed to setKeyLock (the audio thread applies it with the speed)
+  bool keyLocked = false;
+
+  // tracks and loops replaced on the message thread, kept alive until the audio thread has let go of them
+  struct Retired {
+    std::unique_ptr<PreparedTrack> track;
+    std::unique_ptr<LoopEngine::Region> loop;
+    uint32 replacedBySwap;
+  };
+
+  std::vector<Retired> retired;
+  uint32 swapGeneration = 0;
+
+  // the loop handed to the audio thread, and a long one waiting for the track to be decoded
+  // (which streams in the meantime)
+  std::unique_ptr<LoopEngine::Region> loopRegion;
+  Range<int64> pendingLoop;
+  bool pendingLoopIsRoll = false;
+  double loopCrossfadeSeconds = 0.005;
+
+  // bumped by every loop request, so that a loop still decoding can tell it is stale
+  std::atomic<uint32> loopGeneration{ 0 };
+
+  // loops longer than this are only played from the decoded track, never copied
+  static constexpr double maxDecodedLoopSeconds = 60.0;
+
+  // how much of the start of a long loop is decoded while it streams, so the read-ahead can refill after a wrap
+  static constexpr double streamedLoopHeadSeconds = 2.0;
+
+  // the track to play after this one (handed to the audio thread), and the file requested
+  std::unique_ptr<PreparedTrack> nextTrack;
+  File nextTrackFile;
+  bool isNextTrackOpening = false;
+  std::atomic<uint32> nextGeneration{ 0 };
+  std::atomic<double> transitionCrossfadeSeconds{ 0 };
+  uint32 seenTrackAdvances = 0;
+
+  // published by the audio thread: the track it is playing, how often it has moved on to the
+  // next one, and the silence left by the last transition
+  std::atomic<PositionableAudioSource*> playingSource{ nullptr };
+  std::atomic<uint32> trackAdvances{ 0 };
+  std::atomic<double> lastTransitionGap{ 0 };
+
+  // events for the audio thread, and the last track swap it has applied
+  CommandQueue<Command, 256> commands;
+  std::atomic<uint32> appliedSwapGeneration{ 0 };
+
+  // the volume last passed to setGain (ramped to on the audio thread)
+  std::atomic<float> targetGain{ 1.0f };
+
+  // audio thread only: the track being played, its rate, and the play state and gain ramp
+  PositionableAudioSource* currentSource = nullptr;
+  double currentSampleRate = 0;
+  bool audioPlaying = false;
+  LoopEngine loopEngine;
+  PositionableAudioSource* nextSource = nullptr;
+  double nextSampleRate = 0;
+  int transitionOverlap = 0;
+  bool endedWithoutNext = false;
+  bool swappedSinceEnd = false;
+  int64 silenceSinceEnd = 0;
+  SmoothedValue<float> smoothedGain{ 0.0f };
+  HeapBlock<float> gainRamp;
+  int gainRampSize = 0;
+
+  CurrentTrackSource currentTrackSource{ *this };
+  TimedStage trackTimer{ &currentTrackSource };
+
+  // applies the speed as a change of tempo while key-lock is on, at the file's sample rate
+  TimeStretcher timeStretcher{ &trackTimer, 2 };
+  TimedStage stretchTimer{ &timeStretcher };
+
+  // converts from the file's sample rate to the device's and applies the speed (while key-lock
+  // is off), in one pass
+  PolyphaseResampler resampler{ &stretchTimer, 2 };
+
+  // per-stage timing of getNextAudioBlock
+  AudioCallbackStats callbackStats{ { "commands", "track", "stretch", "resample", "gain" } };
+
+  // the speed last passed to setSpeed, for the playhead snapshot
+  std::atomic<double> playbackSpeed{ 1.0 };
+
+  // published by the audio thread under a sequence count: odd while a snapshot is being written
+  std::atomic<uint32> playheadSequence{ 0 };
+  std::atomic<double> playheadSeconds{ 0 };
+  std::atomic<double> playheadLength{ 0 };
+  std::atomic<double> playheadSpeed{ 0 };
+  std::atomic<double> playheadTimestamp{ 0 };
+
+  // audio thread only: block times follow the device's sample clock from this anchor
+  double clockAnchorMs = 0;
+  int64 clockSamples = 0;
+
+  // the sample rate of the loaded file (message thread)
+  double loadedSampleRate = 0;
+
+  // settings from the last prepareToPlay, used to prepare tracks in the background
+  std::atomic<int> preparedBlockSize{ 0 };
+  std::atomic<double> preparedSampleRate{ 0 };
+
+  // bumped by every load request so that older requests in flight can tell they are stale
+  std::atomic<uint32> loadGeneration{ 0 };
+
+  // opens files for loadURLAsync (declared last so that it is destroyed first)
+  ThreadPool loaderPool{ 1 };
+
+  JUCE_DECLARE_WEAK_REFERENCEABLE(DJAudioPlayer)
 };
\ No newline at end of file
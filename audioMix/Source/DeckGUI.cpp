@@ -14,13 +14,12 @@
 //==============================================================================
 DeckGUI::DeckGUI(DJAudioPlayer* _player,
                  AudioFormatManager& formatManagerToUse,
-                 AudioThumbnailCache& cacheToUse, 
                  QueueComponent* _queueComponent, 
                  bool _isDeck1)
                : player(_player),
-                 waveformdisplay(formatManagerToUse, cacheToUse), 
+                 waveformdisplay(formatManagerToUse), 
                  queueComponent(_queueComponent),
-                 isLoaded(false), isLooping(false), 
+                 isLoaded(false), isLoadPending(false), isLooping(false), 
                  isDeck1(_isDeck1)
 {
   // make buttons. sliders, and labels visible
@@ -32,6 +31,7 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player,
   addAndMakeVisible(skipFrontButton);
   addAndMakeVisible(skipBackButton);
   addAndMakeVisible(loopButton);
+  addAndMakeVisible(keyLockButton);
   addAndMakeVisible(volSlider);
   addAndMakeVisible(speedSlider);
   addAndMakeVisible(posSlider);
@@ -51,6 +51,7 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player,
   skipFrontButton.addListener(this);
   skipBackButton.addListener(this);
   loopButton.addListener(this);
+  keyLockButton.addListener(this);
   volSlider.addListener(this);
   speedSlider.addListener(this);
   posSlider.addListener(this);
@@ -86,13 +87,28 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player,
   muteButton.setClickingTogglesState(true);
   twoTimesButton.setClickingTogglesState(true);
   loopButton.setClickingTogglesState(true);
+  keyLockButton.setClickingTogglesState(true);
 
-  // set interval to every 500 millisecond 
-  startTimer(500);
+  // when the player moves on to the pre-rolled queue track, show it and take it off the queue
+  player->onNextTrackStarted = [this](const File& file) {
+    waveformdisplay.loadURL(URL{ file });
+    setNameAndLength(file);
+
+    auto& queued = queueComponent->queuedTracks;
+
+    if (!queued.empty() && queueComponent->getQueuedFile(0) == file) {
+      queued.erase(queued.begin());
+      queueComponent->queueTable.updateContent();
+    }
+  };
+
+  // redraw the playhead at the display rate
+  startTimerHz(playheadHz);
 }
 
 DeckGUI::~DeckGUI() {
   stopTimer();
+  player->onNextTrackStarted = nullptr;
 }
 
 /* Drawing of the component */
@@ -132,6 +148,7 @@ void DeckGUI::paint(Graphics& g) {
   
   twoTimesButton.setLookAndFeel(&LookAndFeel_V1);
   muteButton.setLookAndFeel(&LookAndFeel_V1);
+  keyLockButton.setLookAndFeel(&LookAndFeel_V1);
 
   name.setColour(Label::textColourId, Colour(0xFF000000));
   name.setColour(Label::backgroundColourId, Colour(0xFFFFFFFF));
@@ -198,6 +215,12 @@ void DeckGUI::resized() {
 
   muteButton.setBounds(volSlider.getX() - 5, volSlider.getBottom() + 3, getWidth() / 10, rowH / 2);
   twoTimesButton.setBounds(speedSlider.getX() - 5, speedSlider.getBottom() - 5, getWidth() / 10, rowH / 2);
+
+  // KEY sits on the inner side of the 2x button
+  if (isDeck1)
+    keyLockButton.setBounds(twoTimesButton.getRight() + 3, twoTimesButton.getY(), getWidth() / 10, rowH / 2);
+  else
+    keyLockButton.setBounds(twoTimesButton.getX() - (getWidth() / 10) - 3, twoTimesButton.getY(), getWidth() / 10, rowH / 2);
 }
 
 /* Determine what action to take when a button is clicked */
@@ -244,9 +267,7 @@ void DeckGUI::buttonClicked(Button* button) {
     FileChooser chooser{ "Select a file to play..." };
 
     if (chooser.browseForFileToOpen()) {
-      player->loadURL(URL{ chooser.getResult() });
-      waveformdisplay.loadURL(URL{ chooser.getResult() });
-      setNameAndLength(File{ chooser.getResult() });
+      loadTrack(URL{ chooser.getResult() });
     }
   }
 
@@ -282,18 +303,28 @@ void DeckGUI::buttonClicked(Button* button) {
     }
   }
 
+  // if the key-lock button is clicked
+  if (button == &keyLockButton) {
+    DBG("key-lock button pressed");
+
+    // if key-lock is 'On', the speed controls change the tempo but not the pitch
+    player->setKeyLock(keyLockButton.getToggleState());
+  }
+
   // if the loop button is clicked
   if (button == &loopButton) {
     DBG("loopButton pressed");
 
-    // if loop button is 'On'
+    // if loop button is 'On', loop the whole track (the player wraps at the exact end)
     if (loopButton.getToggleState()) {
       isLooping = true;
+      player->setLoop(0, player->getLengthInSeconds());
       loopButton.setButtonText("STOP LOOP");
     }
 
     else {
       isLooping = false;
+      player->clearLoop();
       loopButton.setButtonText("LOOP");
     }
   }
@@ -346,42 +377,44 @@ bool DeckGUI::isInterestedInFileDrag(const StringArray& /*files*/) {
 void DeckGUI::filesDropped(const StringArray& files, int /*x*/, int /*y*/) {
   // only drop 1 file at a time
   if (files.size() == 1) {
-    player->loadURL(URL{ File{files[0]} });
-    waveformdisplay.loadURL(URL{ File{files[0]} });
-    
-    setNameAndLength(files[0]);
+    loadTrack(URL{ File{files[0]} });
   }
 }
 
 /* Callback routine that gets called according to the interval set */
 void DeckGUI::timerCallback() {
-  // update waveformdisplay, posSlider, and movingTrackLength
-  waveformdisplay.setPositionRelative(player->getPositionRelative());
-  posSlider.setValue(player->getPositionRelative());
-  movingTrackLength = lengthInString(player->getPosition());
-
-  // replay the track if the loop button is 'on' when the track reaches the end
-  if (isLooping) {
-    if (player->getPosition() >= player->getLengthInSeconds()) {
-      player->setPosition(0);
-      player->start();
-    }
+  updatePlayhead();
+
+  if (++timerTicks < queueCheckInterval)
+    return;
+
+  timerTicks = 0;
+
+  // keep the head of the queue pre-rolled while the deck plays, so that it follows the current
+  // track without a gap (the player switches to it itself)
+  auto queueActive = !isLooping && queueComponent->playQueueButton.getToggleState()
+                     && queueComponent->queuedTracks.size() > 0;
+
+  if (queueActive && player->isPlaying) {
+    if (player->getNextTrackFile() != queueComponent->getQueuedFile(0))
+      player->prepareNextTrack(URL{ queueComponent->getQueuedFile(0) });
+  }
+  else if (player->getNextTrackFile() != File()) {
+    player->cancelNextTrack();
   }
 
-  else {
-    // play songs from the queue when the player reaches end of track
-    if (player->getPosition() >= player->getLengthInSeconds()) {
+  // looping is done by the player itself, so only advance the queue when not looping
+  if (!isLooping) {
+    // play songs from the queue when the player reaches end of track without having pre-rolled
+    // the next one (skipped while the next track is still being opened)
+    if (!isLoadPending && !player->isNextTrackReady() && !player->isNextTrackPending()
+        && player->getPosition() >= player->getLengthInSeconds()) {
       if (queueComponent->playQueueButton.getToggleState() && queueComponent->queuedTracks.size() > 0) {
+        player->cancelNextTrack();
 
-        // the first item in queuedTracks vector
-        File file = queueComponent->queuedTracks[0].file;
-        player->loadURL(URL{ file });
-        waveformdisplay.loadURL(URL{ file });
-        setNameAndLength(file);
-
-        player->setPosition(0);
-        player->start();
-        playpauseButton.setButtonText("PAUSE");
+        // the first item in queuedTracks vector, played as soon as it is loaded
+        File file = queueComponent->getQueuedFile(0);
+        loadTrack(URL{ file }, true);
 
         // erase the first item in the vector (queuedTracks[0])
         queueComponent->queuedTracks.erase(queueComponent->queuedTracks.begin());
@@ -400,10 +433,7 @@ bool DeckGUI::isInterestedInDragSource(const SourceDetails& /*dragSourceDetails*
 void DeckGUI::itemDropped(const SourceDetails& dragSourceDetails) {
   URL trackURL = URL{ dragSourceDetails.description.toString() };
 
-  player->loadURL(trackURL);
-  waveformdisplay.loadURL(trackURL);
-
-  setNameAndLength(File{ trackURL.getLocalFile() });
+  loadTrack(trackURL);
 }
 
 /* Gets the name and length of the file passed in to display in the deck */
@@ -414,6 +444,46 @@ void DeckGUI::setNameAndLength(File file) {
   repaint();
 }
 
+/* Load a track into the deck without blocking the GUI */
+void DeckGUI::loadTrack(URL trackURL, bool startWhenLoaded) {
+  isLoadPending = true;
+
+  SafePointer<DeckGUI> safeThis(this);
+
+  player->loadURLAsync(trackURL,
+    // once the player has swapped the track in, update the deck's display
+    [safeThis, trackURL, startWhenLoaded] {
+      if (safeThis == nullptr)
+        return;
+
+      safeThis->isLoadPending = false;
+      safeThis->waveformdisplay.loadURL(trackURL);
+      safeThis->waveformdisplay.setPositionRelative(safeThis->player->getPositionRelative());
+      safeThis->setNameAndLength(trackURL.getLocalFile());
+
+      // keep looping the new track if the loop button is still on
+      if (safeThis->isLooping)
+        safeThis->player->setLoop(0, safeThis->player->getLengthInSeconds());
+
+      if (startWhenLoaded) {
+        safeThis->player->setPosition(0);
+        safeThis->player->start();
+        safeThis->playpauseButton.setButtonText("PAUSE");
+      }
+    },
+    // keep the current track and tell the user what went wrong
+    [safeThis, trackURL](const String& error) {
+      if (safeThis == nullptr)
+        return;
+
+      safeThis->isLoadPending = false;
+      AlertWindow::showMessageBoxAsync(AlertWindow::AlertIconType::WarningIcon,
+                                       "Warning:",
+                                       "The track '" + trackURL.getLocalFile().getFileNameWithoutExtension() + "' could not be loaded.");
+      DBG("DeckGUI::loadTrack " << error);
+    });
+}
+
 /* Formats the time passed in into minutes:seconds format
    used in DeckGUI::setNameAndLength() to display track length */
 String DeckGUI::lengthInString(double time) {
@@ -432,3 +502,33 @@ String DeckGUI::lengthInString(double time) {
 
   return mins + ':' + secs;;
 }
+
+/* Move the playhead displays to the interpolated playhead */
+void DeckGUI::updatePlayhead() {
+  auto playhead = player->getPlayhead();
+  auto now = Time::getMillisecondCounterHiRes();
+  auto relative = playhead.getRelativeAt(now);
+
+  // update waveformdisplay, posSlider, and movingTrackLength, each only repainting what moved
+  waveformdisplay.setPositionRelative(relative);
+
+  // don't fight the user while they drag the slider, and don't seek by setting it
+  if (!posSlider.isMouseButtonDown()
+        && std::abs(relative - posSlider.getValue()) * posSlider.getWidth() >= 0.5)
+    posSlider.setValue(relative, dontSendNotification);
+
+  auto seconds = (int) playhead.getSecondsAt(now);
+
+  if (seconds != shownSeconds) {
+    shownSeconds = seconds;
+    movingTrackLength = lengthInString(seconds);
+
+    if (isLoaded)
+      length.setText(movingTrackLength + " | " + TrackLength, dontSendNotification);
+  }
+}
+
+/* Get the deck's waveform */
+const WaveformDisplay& DeckGUI::getWaveformDisplay() const {
+  return waveformdisplay;
+}
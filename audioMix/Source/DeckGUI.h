@@ -33,7 +33,7 @@ public:
    */
   DeckGUI(DJAudioPlayer* player,
           AudioFormatManager& formatManagerToUse,
-          AudioThumbnailCache& cacheToUse, QueueComponent* _queueComponent, bool differentiate);
+          QueueComponent* _queueComponent, bool differentiate);
 
   /**
    * \brief 
@@ -131,6 +131,18 @@ public:
    */
   void setNameAndLength(File file);
 
+  /**
+   * \brief
+   *    Load a track into the deck without blocking the GUI.
+   *    The waveform, name and length are updated once the player has installed the track.
+   *
+   * \param trackURL
+   *    The URL of the track to be loaded
+   * \param startWhenLoaded
+   *    true to start playing as soon as the track is loaded
+   */
+  void loadTrack(URL trackURL, bool startWhenLoaded = false);
+
   /**
    * \brief
    *    Formats the time into minutes:seconds format.
@@ -140,7 +152,24 @@ public:
    */
   String lengthInString(double time);
 
+  /**
+   * \brief
+   *    Get the deck's waveform, e.g. for its paint times.
+   */
+  const WaveformDisplay& getWaveformDisplay() const;
+
 private:
+  /**
+   * \brief
+   *    Move the waveform playhead, position slider and play time to the playhead
+   *    interpolated from the player's last snapshot.
+   */
+  void updatePlayhead();
+
+  // the playhead moves at the display rate; the queue only needs checking twice a second
+  static constexpr int playheadHz = 60;
+  static constexpr int queueCheckInterval = playheadHz / 2;
+
   // Buttons
   TextButton playpauseButton{ "PLAY" };
   TextButton resetButton{ "RESET" };
@@ -150,6 +179,7 @@ private:
   TextButton skipFrontButton{ ">>" };
   TextButton skipBackButton{ "<<" };
   TextButton loopButton{ "LOOP" };
+  TextButton keyLockButton{ "KEY" };
 
   // Sliders
   Slider volSlider;
@@ -171,6 +201,12 @@ private:
   String movingTrackLength;
   Label movingLength;
 
+  // the whole second last shown in movingTrackLength
+  int shownSeconds = -1;
+
+  // counts timer callbacks between checks of the queue
+  int timerTicks = 0;
+
   FileChooser fChooser{ "Select a file" };
 
   DJAudioPlayer* player;
@@ -180,6 +216,9 @@ private:
   // determines whether a track is loaded into the Deck
   bool isLoaded;
 
+  // determines whether a track is still being opened in the background
+  bool isLoadPending;
+
   // determines whether the loop button is 'on' or 'off'
   bool isLooping;
 
@@ -0,0 +1,232 @@
+/*
+  ==============================================================================
+
+    DecodedTrackCache.cpp
+    Created: 17 Oct 2026 11:02:18am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "DecodedTrackCache.h"
+
+//==============================================================================
+DecodedTrackCache::DecodedTrackCache()
+                                   : memoryBudget((int64) 1024 * 1024 * 1024), // 1 GB
+                                     memoryUsed(0),
+                                     useCounter(0)
+{
+  formatManager.registerBasicFormats();
+
+  weakThis = this;
+}
+
+DecodedTrackCache::~DecodedTrackCache() {
+  decoderPool.removeAllJobs(true, 10000);
+}
+
+/* Get the decoded audio of a track, marking it as most recently used */
+std::shared_ptr<const AudioBuffer<float>> DecodedTrackCache::getTrack(const File& file) {
+  const ScopedLock sl(lock);
+
+  auto it = entries.find(keyFor(file));
+
+  if (it == entries.end())
+    return nullptr;
+
+  it->second.lastUsed = ++useCounter;
+  return it->second.audio;
+}
+
+/* Get the sample rate of a cached track */
+double DecodedTrackCache::getSampleRate(const File& file) {
+  const ScopedLock sl(lock);
+
+  auto it = entries.find(keyFor(file));
+  return it != entries.end() ? it->second.sampleRate : 0;
+}
+
+/* Decode a track into the cache on the background thread */
+void DecodedTrackCache::requestDecode(const File& file) {
+  if (!file.existsAsFile())
+    return;
+
+  {
+    const ScopedLock sl(lock);
+    auto key = keyFor(file);
+
+    if (entries.find(key) != entries.end() || pendingDecodes.contains(key))
+      return;
+
+    pendingDecodes.add(key);
+  }
+
+  decoderPool.addJob([this, file] { decode(file); });
+}
+
+/* Checks whether a track of a given size could be decoded into the cache at all */
+bool DecodedTrackCache::canHold(int64 numSamples, int numChannels) {
+  const ScopedLock sl(lock);
+
+  // AudioBuffer is indexed with ints, and a track bigger than the whole budget would only evict everything else
+  return numSamples <= std::numeric_limits<int>::max()
+           && numSamples * (int64) numChannels * (int64) sizeof(float) <= memoryBudget;
+}
+
+/* Stop a track from being evicted */
+void DecodedTrackCache::pin(const File& file) {
+  const ScopedLock sl(lock);
+  ++pinCounts[keyFor(file)];
+}
+
+/* Allow a pinned track to be evicted again */
+void DecodedTrackCache::unpin(const File& file) {
+  const ScopedLock sl(lock);
+
+  auto it = pinCounts.find(keyFor(file));
+
+  if (it != pinCounts.end() && --it->second <= 0)
+    pinCounts.erase(it);
+
+  evictIfNeeded();
+}
+
+/* Set the maximum amount of memory used by the cache */
+void DecodedTrackCache::setMemoryBudget(int64 bytes) {
+  const ScopedLock sl(lock);
+  memoryBudget = jmax((int64) 0, bytes);
+  evictIfNeeded();
+}
+
+/* Get the amount of memory currently used by decoded audio */
+int64 DecodedTrackCache::getMemoryUsed() {
+  const ScopedLock sl(lock);
+  return memoryUsed;
+}
+
+void DecodedTrackCache::addListener(Listener* listener) {
+  listeners.add(listener);
+}
+
+void DecodedTrackCache::removeListener(Listener* listener) {
+  listeners.remove(listener);
+}
+
+/* Decode a track and add it to the cache (decoder thread) */
+void DecodedTrackCache::decode(const File& file) {
+  auto key = keyFor(file);
+  std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+  if (reader == nullptr || !canHold(reader->lengthInSamples, (int) reader->numChannels)) {
+    const ScopedLock sl(lock);
+    pendingDecodes.removeString(key);
+    return;
+  }
+
+  auto sizeInBytes = reader->lengthInSamples * (int64) reader->numChannels * (int64) sizeof(float);
+  auto numSamples = (int) reader->lengthInSamples;
+  auto audio = std::make_shared<AudioBuffer<float>>((int) reader->numChannels, numSamples);
+  reader->read(audio.get(), 0, numSamples, 0, true, true);
+
+  {
+    const ScopedLock sl(lock);
+    pendingDecodes.removeString(key);
+
+    Entry entry;
+    entry.audio = std::move(audio);
+    entry.sampleRate = reader->sampleRate;
+    entry.sizeInBytes = sizeInBytes;
+    entry.lastUsed = ++useCounter;
+
+    entries[key] = std::move(entry);
+    memoryUsed += sizeInBytes;
+
+    evictIfNeeded();
+  }
+
+  DBG("DecodedTrackCache::decode " << key << " cached");
+
+  // tell the listeners on the message thread (if the cache still exists by then)
+  MessageManager::callAsync([weakThis = weakThis, file] {
+    if (auto* cache = weakThis.get())
+      cache->listeners.call([&file](Listener& l) { l.trackDecoded(file); });
+  });
+}
+
+/* Remove least recently used, unpinned tracks until the cache fits its budget */
+void DecodedTrackCache::evictIfNeeded() {
+  while (memoryUsed > memoryBudget) {
+    auto leastRecentlyUsed = entries.end();
+
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      if (pinCounts.find(it->first) != pinCounts.end())
+        continue;
+
+      if (leastRecentlyUsed == entries.end() || it->second.lastUsed < leastRecentlyUsed->second.lastUsed)
+        leastRecentlyUsed = it;
+    }
+
+    // everything left is pinned
+    if (leastRecentlyUsed == entries.end())
+      return;
+
+    DBG("DecodedTrackCache::evictIfNeeded evicting " << leastRecentlyUsed->first);
+
+    // anyone still holding the shared_ptr keeps the audio alive until they let go of it
+    memoryUsed -= leastRecentlyUsed->second.sizeInBytes;
+    entries.erase(leastRecentlyUsed);
+  }
+}
+
+//==============================================================================
+CachedTrackSource::CachedTrackSource(std::shared_ptr<const AudioBuffer<float>> _audio)
+                                   : audio(std::move(_audio))
+{
+  jassert(audio != nullptr);
+}
+
+void CachedTrackSource::prepareToPlay(int /*samplesPerBlockExpected*/, double /*sampleRate*/) {
+}
+
+void CachedTrackSource::releaseResources() {
+}
+
+/* Copy the next block straight out of the decoded audio */
+void CachedTrackSource::getNextAudioBlock(const AudioSourceChannelInfo& info) {
+  auto pos = position.load();
+  auto total = (int64) audio->getNumSamples();
+
+  auto numAvailable = (int) jlimit((int64) 0, (int64) info.numSamples, total - pos);
+
+  if (numAvailable <= 0 || pos < 0) {
+    info.clearActiveBufferRegion();
+  }
+  else {
+    // mono tracks are copied into every output channel
+    for (int chan = 0; chan < info.buffer->getNumChannels(); ++chan)
+      info.buffer->copyFrom(chan, info.startSample,
+                            *audio, jmin(chan, audio->getNumChannels() - 1), (int) pos,
+                            numAvailable);
+
+    if (numAvailable < info.numSamples)
+      info.buffer->clear(info.startSample + numAvailable, info.numSamples - numAvailable);
+  }
+
+  position = pos + info.numSamples;
+}
+
+void CachedTrackSource::setNextReadPosition(int64 newPosition) {
+  position = newPosition;
+}
+
+int64 CachedTrackSource::getNextReadPosition() const {
+  return position.load();
+}
+
+int64 CachedTrackSource::getTotalLength() const {
+  return audio->getNumSamples();
+}
+
+bool CachedTrackSource::isLooping() const {
+  return false;
+}
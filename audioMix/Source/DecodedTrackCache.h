@@ -0,0 +1,212 @@
+/*
+  ==============================================================================
+
+    DecodedTrackCache.h
+    Created: 17 Oct 2026 11:02:18am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+
+//==============================================================================
+/*
+    A process-wide cache of fully decoded tracks, shared by both decks, the
+    waveform displays and the queue. Tracks are decoded in the background and
+    the least recently used ones are evicted once the cache grows past its
+    memory budget. Tracks loaded on a deck are pinned and never evicted.
+
+    Use it through a SharedResourcePointer<DecodedTrackCache>.
+*/
+class DecodedTrackCache {
+public:
+  /**
+   * \brief
+   *    Receives a callback (on the message thread) whenever a track has finished decoding.
+   */
+  class Listener {
+  public:
+    virtual ~Listener() = default;
+
+    /**
+     * \brief
+     *    Called on the message thread when a track has been decoded into the cache.
+     *
+     * \param file
+     *    The file that is now available through getTrack()
+     */
+    virtual void trackDecoded(const File& file) = 0;
+  };
+
+  /**
+   * \brief
+   *    Constructor.
+   */
+  DecodedTrackCache();
+
+  /**
+   * \brief
+   *    Destructor. Waits for any decode in progress.
+   */
+  ~DecodedTrackCache();
+
+  /**
+   * \brief
+   *    Get the decoded audio of a track, marking it as most recently used.
+   *
+   * \param file
+   *    The track to look up
+   *
+   * \return
+   *    The decoded audio, or nullptr if the track isn't cached
+   */
+  std::shared_ptr<const AudioBuffer<float>> getTrack(const File& file);
+
+  /**
+   * \brief
+   *    Get the sample rate of a cached track.
+   *
+   * \return
+   *    The sample rate, or 0 if the track isn't cached
+   */
+  double getSampleRate(const File& file);
+
+  /**
+   * \brief
+   *    Decode a track into the cache on the background thread, if it isn't cached already.
+   *    Tracks that would not fit in the memory budget on their own are skipped.
+   *
+   * \param file
+   *    The track to decode
+   */
+  void requestDecode(const File& file);
+
+  /**
+   * \brief
+   *    Checks whether a track of a given size could be decoded into the cache at all.
+   *
+   * \param numSamples
+   *    The length of the track in samples
+   * \param numChannels
+   *    The number of channels in the track
+   *
+   * \return
+   *    false if requestDecode() would skip the track as too large
+   */
+  bool canHold(int64 numSamples, int numChannels);
+
+  /**
+   * \brief
+   *    Stop a track from being evicted (e.g. while it is loaded on a deck).
+   *    Pins are counted, so every call must be matched by a call to unpin().
+   */
+  void pin(const File& file);
+
+  /**
+   * \brief
+   *    Allow a pinned track to be evicted again.
+   */
+  void unpin(const File& file);
+
+  /**
+   * \brief
+   *    Set the maximum amount of memory used by the cache (pinned tracks can exceed it).
+   *
+   * \param bytes
+   *    The new memory budget in bytes
+   */
+  void setMemoryBudget(int64 bytes);
+
+  /**
+   * \brief
+   *    Get the amount of memory currently used by decoded audio.
+   *
+   * \return
+   *    Memory used in bytes
+   */
+  int64 getMemoryUsed();
+
+  void addListener(Listener* listener);
+  void removeListener(Listener* listener);
+
+private:
+  struct Entry {
+    std::shared_ptr<const AudioBuffer<float>> audio;
+    double sampleRate = 0;
+    int64 sizeInBytes = 0;
+    uint64 lastUsed = 0;
+  };
+
+  /**
+   * \brief
+   *    Decode a track and add it to the cache. Runs on the decoder thread.
+   */
+  void decode(const File& file);
+
+  /**
+   * \brief
+   *    Remove least recently used, unpinned tracks until the cache fits its budget.
+   *    Must be called with the lock held.
+   */
+  void evictIfNeeded();
+
+  static String keyFor(const File& file) { return file.getFullPathName(); }
+
+  AudioFormatManager formatManager;
+
+  CriticalSection lock;
+  std::map<String, Entry> entries;
+  std::map<String, int> pinCounts;
+  StringArray pendingDecodes;
+
+  int64 memoryBudget;
+  int64 memoryUsed;
+  uint64 useCounter;
+
+  ListenerList<Listener> listeners;
+
+  // copied by the decoder thread to call back on the message thread. Made once in the constructor,
+  // because the first WeakReference to an object creates its shared pointer without a lock
+  WeakReference<DecodedTrackCache> weakThis;
+
+  // decodes one track at a time (declared last so that it is destroyed first)
+  ThreadPool decoderPool{ 1 };
+
+  JUCE_DECLARE_WEAK_REFERENCEABLE(DecodedTrackCache)
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecodedTrackCache)
+};
+
+//==============================================================================
+/*
+    Plays a track straight out of the DecodedTrackCache.
+*/
+class CachedTrackSource : public PositionableAudioSource {
+public:
+  /**
+   * \brief
+   *    Constructor.
+   *
+   * \param _audio
+   *    The decoded audio to play (kept alive for as long as this source exists)
+   */
+  CachedTrackSource(std::shared_ptr<const AudioBuffer<float>> _audio);
+
+  void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+  void releaseResources() override;
+  void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+  void setNextReadPosition(int64 newPosition) override;
+  int64 getNextReadPosition() const override;
+  int64 getTotalLength() const override;
+  bool isLooping() const override;
+
+private:
+  std::shared_ptr<const AudioBuffer<float>> audio;
+  std::atomic<int64> position{ 0 };
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CachedTrackSource)
+};
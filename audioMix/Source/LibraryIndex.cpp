@@ -0,0 +1,149 @@
+/*
+  ==============================================================================
+
+    LibraryIndex.cpp
+    Created: 28 Oct 2026 9:41:26am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "LibraryIndex.h"
+
+namespace {
+  // the fewest bytes an entry can take: an empty path and no beat grid
+  constexpr int64 minEntrySize = 1 + 1 + 8 + 8 + 8 + 1;
+}
+
+//==============================================================================
+LibraryIndex::LibraryIndex()
+                         : indexFile(File::getSpecialLocation(File::userApplicationDataDirectory)
+                                       .getChildFile("audioMix").getChildFile("library.index"))
+{
+}
+
+LibraryIndex::~LibraryIndex() {
+}
+
+/* Read the saved library */
+bool LibraryIndex::load(std::vector<Entry>& entries) {
+  entries.clear();
+
+  // one read for the whole index, then parse it from memory
+  MemoryBlock data;
+
+  if (!indexFile.existsAsFile() || !indexFile.loadFileAsData(data))
+    return false;
+
+  MemoryInputStream in(data, false);
+  char magic[4] = {};
+
+  if (in.read(magic, 4) != 4 || std::memcmp(magic, "AMLI", 4) != 0 || in.readInt() != formatVersion)
+    return false;
+
+  // beat grids from an older analysis are dropped, so that the tracks are analysed again
+  auto gridsAreCurrent = in.readInt() == TrackAnalyser::analysisVersion;
+  auto numEntries = in.readInt();
+
+  // a count that the rest of the file can't hold is a corrupt index, not a reason to run out of memory
+  if (numEntries < 0 || numEntries > in.getNumBytesRemaining() / minEntrySize)
+    return false;
+
+  entries.reserve((size_t) numEntries);
+  String previousPath;
+
+  for (int i = 0; i < numEntries; ++i) {
+    // a truncated index is treated as missing, rather than restoring part of the library
+    if (in.isExhausted()) {
+      entries.clear();
+      return false;
+    }
+
+    Entry entry;
+
+    auto shared = in.readCompressedInt();
+    auto path = previousPath.substring(0, shared) + in.readString();
+
+    entry.file = File(path);
+    entry.fileSize = in.readInt64();
+    entry.modificationTime = in.readInt64();
+    entry.lengthInSeconds = in.readDouble();
+    entry.hasBeatGrid = in.readBool();
+
+    if (entry.hasBeatGrid) {
+      entry.beatGrid.bpm = in.readDouble();
+      entry.beatGrid.firstBeatSeconds = in.readDouble();
+      entry.beatGrid.lengthInSeconds = in.readDouble();
+      entry.hasBeatGrid = gridsAreCurrent;
+    }
+
+    entries.push_back(entry);
+    previousPath = path;
+  }
+
+  // the last entry is only whole if the end marker follows it
+  char endMarker[4] = {};
+
+  if (in.read(endMarker, 4) != 4 || std::memcmp(endMarker, "AMLE", 4) != 0) {
+    entries.clear();
+    return false;
+  }
+
+  return true;
+}
+
+/* Replace the saved library */
+bool LibraryIndex::save(const std::vector<Entry>& entries) {
+  indexFile.getParentDirectory().createDirectory();
+
+  // written next to the index and only moved into place once it is complete
+  TemporaryFile temp(indexFile);
+
+  {
+    FileOutputStream out(temp.getFile());
+
+    if (out.failedToOpen())
+      return false;
+
+    out.write("AMLI", 4);
+    out.writeInt(formatVersion);
+    out.writeInt(TrackAnalyser::analysisVersion);
+    out.writeInt((int) entries.size());
+
+    String previousPath;
+
+    for (auto& entry : entries) {
+      auto path = entry.file.getFullPathName();
+
+      // number of characters shared with the previous path
+      int shared = 0;
+
+      for (auto a = path.getCharPointer(), b = previousPath.getCharPointer(); !a.isEmpty() && *a == *b; ++a, ++b)
+        ++shared;
+
+      out.writeCompressedInt(shared);
+      out.writeString(path.substring(shared));
+      out.writeInt64(entry.fileSize);
+      out.writeInt64(entry.modificationTime);
+      out.writeDouble(entry.lengthInSeconds);
+      out.writeBool(entry.hasBeatGrid);
+
+      if (entry.hasBeatGrid) {
+        out.writeDouble(entry.beatGrid.bpm);
+        out.writeDouble(entry.beatGrid.firstBeatSeconds);
+        out.writeDouble(entry.beatGrid.lengthInSeconds);
+      }
+
+      previousPath = path;
+    }
+
+    out.write("AMLE", 4);
+    out.flush();
+
+    if (out.getStatus().failed())
+      return false;
+  }
+
+  // only a complete index ever appears under the real name; TemporaryFile deletes it otherwise
+  return temp.overwriteTargetFileWithTemporary();
+}
@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    LibraryIndex.h
+    Created: 28 Oct 2026 9:41:26am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TrackAnalyser.h"
+
+//==============================================================================
+/*
+    The saved library: one binary file holding every track's path, size,
+    modification time, length and beat grid, so that restoring the library
+    is a single sequential read rather than opening every track again.
+
+    The size and modification time are kept so that LibraryScanner can tell
+    which tracks have changed since, and re-read only those. Paths are stored
+    as the number of characters shared with the previous path followed by the
+    rest, so a library kept in a few folders stays small. An end marker
+    follows the last entry, so a file that was cut short is never mistaken
+    for a smaller library.
+*/
+class LibraryIndex {
+public:
+  /**
+   * \brief
+   *    What is saved about one track.
+   */
+  struct Entry {
+    File file;
+    int64 fileSize = -1;                  // negative if the track hadn't been read when it was saved
+    int64 modificationTime = 0;           // milliseconds
+    double lengthInSeconds = -1;          // negative if unknown, 0 if the file couldn't be read
+    bool hasBeatGrid = false;
+    TrackAnalyser::BeatGrid beatGrid;
+  };
+
+  /**
+   * \brief
+   *    Constructor. Uses "library.index" in the application data directory.
+   */
+  LibraryIndex();
+
+  /**
+   * \brief
+   *    Destructor.
+   */
+  ~LibraryIndex();
+
+  /**
+   * \brief
+   *    Read the saved library.
+   *
+   * \param entries
+   *    Filled with the saved tracks, in library order
+   *
+   * \return
+   *    false if there is no index, or it can't be read (e.g. it was written by another version)
+   */
+  bool load(std::vector<Entry>& entries);
+
+  /**
+   * \brief
+   *    Replace the saved library.
+   *
+   * \param entries
+   *    The tracks in the library, in order
+   *
+   * \return
+   *    true if the index was written
+   */
+  bool save(const std::vector<Entry>& entries);
+
+  /**
+   * \brief
+   *    Get the index file.
+   */
+  const File& getFile() const { return indexFile; }
+
+private:
+  // bump when the layout changes, so that an old index is ignored rather than misread
+  static constexpr int formatVersion = 2;
+
+  const File indexFile;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LibraryIndex)
+};
@@ -0,0 +1,221 @@
+/*
+  ==============================================================================
+
+    LibraryScanner.cpp
+    Created: 27 Oct 2026 11:08:44am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "LibraryScanner.h"
+
+//==============================================================================
+class LibraryScanner::ScanJob : public ThreadPoolJob {
+public:
+  ScanJob(LibraryScanner& _owner)
+        : ThreadPoolJob("Library scan"),
+          owner(_owner)
+  {
+  }
+
+  /* Probe batches of files until none are left */
+  JobStatus runJob() override {
+    std::vector<Result> files;
+
+    while (!shouldExit()) {
+      ScanSummary summary;
+      auto hasMore = owner.takeNextFiles(files, summary);
+      std::vector<Result> results;
+      int numChecked = 0;
+
+      for (auto& known : files) {
+        if (shouldExit())
+          break;
+
+        Result result;
+
+        if (owner.probe(known, result))
+          results.push_back(result);
+
+        ++numChecked;
+      }
+
+      owner.deliver(std::move(results), numChecked, summary);
+
+      if (!hasMore)
+        break;
+    }
+
+    return jobHasFinished;
+  }
+
+private:
+  LibraryScanner& owner;
+};
+
+//==============================================================================
+LibraryScanner::LibraryScanner()
+                             : numThreads(jlimit(2, 8, SystemStats::getNumCpus())),
+                               scanPool(numThreads)
+{
+  formatManager.registerBasicFormats();
+
+  weakThis = this;
+}
+
+LibraryScanner::~LibraryScanner() {
+  {
+    const ScopedLock sl(lock);
+    pending.clear();
+  }
+
+  scanPool.removeAllJobs(true, 10000);
+}
+
+/* Probe files in the background, after any that are waiting already */
+void LibraryScanner::scan(const Array<File>& files) {
+  std::vector<Result> unknownFiles;
+  unknownFiles.reserve((size_t) files.size());
+
+  for (auto& file : files) {
+    Result unknown;
+    unknown.file = file;
+    unknownFiles.push_back(unknown);
+  }
+
+  scan(unknownFiles);
+}
+
+/* Check files whose details are known already, and probe only those that have changed */
+void LibraryScanner::scan(const std::vector<Result>& files) {
+  if (files.empty())
+    return;
+
+  int numToStart = 0;
+
+  {
+    const ScopedLock sl(lock);
+
+    // a scan that starts from idle times (and counts) from here
+    if (pending.empty() && numJobs == 0) {
+      scanStartMs = Time::getMillisecondCounterHiRes();
+      numDone = 0;
+      numTotal = 0;
+    }
+
+    pending.insert(pending.end(), files.begin(), files.end());
+    numTotal += (int) files.size();
+
+    // enough jobs for the files waiting, but never more than the pool has threads
+    auto wanted = jmin(numThreads, (int) (pending.size() + batchSize - 1) / batchSize);
+    numToStart = jmax(0, wanted - numJobs);
+    numJobs += numToStart;
+  }
+
+  for (int i = 0; i < numToStart; ++i)
+    scanPool.addJob(new ScanJob(*this), true);
+}
+
+/* Checks whether any files are still waiting or being probed */
+bool LibraryScanner::isScanning() {
+  const ScopedLock sl(lock);
+  return !pending.empty() || numJobs > 0;
+}
+
+/* Get the number of files probed and asked for since the scan started */
+void LibraryScanner::getProgress(int& done, int& total) {
+  const ScopedLock sl(lock);
+  done = numDone;
+  total = numTotal;
+}
+
+void LibraryScanner::addListener(Listener* listener) {
+  listeners.add(listener);
+}
+
+void LibraryScanner::removeListener(Listener* listener) {
+  listeners.remove(listener);
+}
+
+/* Take the next files off the list */
+bool LibraryScanner::takeNextFiles(std::vector<Result>& files, ScanSummary& summary) {
+  const ScopedLock sl(lock);
+
+  files.clear();
+
+  while (!pending.empty() && (int) files.size() < batchSize) {
+    files.push_back(pending.front());
+    pending.pop_front();
+  }
+
+  // the job that takes the last files is not the last to finish, so only stop once nothing is left
+  if (files.empty()) {
+    // the last job out reports the whole scan. Every other job has delivered its results by
+    // now, and a new scan can only start (and reset the counts) after this lock is released
+    if (--numJobs == 0) {
+      summary.isFinished = true;
+      summary.filesScanned = numDone;
+      summary.seconds = (Time::getMillisecondCounterHiRes() - scanStartMs) / 1000.0;
+    }
+
+    return false;
+  }
+
+  return true;
+}
+
+/* Read the length of a file, unless it is known and unchanged */
+bool LibraryScanner::probe(const Result& known, Result& result) {
+  result = {};
+  result.file = known.file;
+  result.fileSize = known.file.getSize();
+  result.modificationTime = known.file.getLastModificationTime().toMilliseconds();
+
+  // a stat is enough to tell that a known file is still the same
+  if (known.fileSize >= 0 && known.fileSize == result.fileSize && known.modificationTime == result.modificationTime)
+    return false;
+
+  // only reads the header: the length comes from the reader, nothing is decoded
+  std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(known.file));
+
+  if (reader != nullptr && reader->sampleRate > 0) {
+    result.lengthInSeconds = reader->lengthInSamples / reader->sampleRate;
+    result.isReadable = true;
+  }
+
+  return true;
+}
+
+/* Hand a batch of results to the listeners, and report the end of the scan after the last one */
+void LibraryScanner::deliver(std::vector<Result>&& results, int numChecked, const ScanSummary& summary) {
+  auto isFinished = summary.isFinished;
+  auto filesScanned = summary.filesScanned;
+  auto seconds = summary.seconds;
+
+  if (numChecked > 0) {
+    const ScopedLock sl(lock);
+    numDone += numChecked;
+  }
+
+  if (results.empty() && !isFinished)
+    return;
+
+  // tell the listeners on the message thread (if the scanner still exists by then)
+  auto batch = std::make_shared<std::vector<Result>>(std::move(results));
+
+  MessageManager::callAsync([weakThis = weakThis, batch, isFinished, filesScanned, seconds] {
+    auto* scanner = weakThis.get();
+
+    if (scanner == nullptr)
+      return;
+
+    if (!batch->empty())
+      scanner->listeners.call([&batch](Listener& l) { l.tracksScanned(*batch); });
+
+    if (isFinished) {
+      DBG("LibraryScanner: " << filesScanned << " files scanned in " << String(seconds, 2) << " s");
+      scanner->listeners.call([=](Listener& l) { l.scanFinished(filesScanned, seconds); });
+    }
+  });
+}
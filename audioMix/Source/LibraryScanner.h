@@ -0,0 +1,199 @@
+/*
+  ==============================================================================
+
+    LibraryScanner.h
+    Created: 27 Oct 2026 11:08:44am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <deque>
+
+//==============================================================================
+/*
+    Reads the length of library tracks in the background, so that adding or
+    restoring a large library never holds up the GUI.
+
+    Files are probed on a small pool of threads, in the order they were
+    added, through one AudioFormatManager shared by every thread (its formats
+    are registered once, before any thread uses it, so it is only ever read).
+    Results reach the listeners on the message thread in batches, so that a
+    library of thousands of tracks fills in progressively without flooding
+    the message queue. When the last file has been probed the listeners are
+    told how long the scan took.
+
+    Files whose details are known already (from the LibraryIndex) are only
+    opened again if their size or modification time has changed.
+*/
+class LibraryScanner {
+public:
+  /**
+   * \brief
+   *    What was found out about one file.
+   */
+  struct Result {
+    File file;
+    int64 fileSize = -1;            // negative if not known yet
+    int64 modificationTime = 0;     // milliseconds
+    double lengthInSeconds = 0;
+    bool isReadable = false;        // false if no registered format could open the file
+  };
+
+  /**
+   * \brief
+   *    Receives the results (on the message thread).
+   */
+  class Listener {
+  public:
+    virtual ~Listener() = default;
+
+    /**
+     * \brief
+     *    Called on the message thread with each batch of probed files. Known files that
+     *    haven't changed are left out.
+     */
+    virtual void tracksScanned(const std::vector<Result>& results) = 0;
+
+    /**
+     * \brief
+     *    Called on the message thread once every file asked for has been probed.
+     *
+     * \param numFiles
+     *    Number of files probed since the scan started
+     * \param seconds
+     *    Time from the first file being asked for to the last result
+     */
+    virtual void scanFinished(int numFiles, double seconds) = 0;
+  };
+
+  /**
+   * \brief
+   *    Constructor.
+   */
+  LibraryScanner();
+
+  /**
+   * \brief
+   *    Destructor. Stops any scan in progress.
+   */
+  ~LibraryScanner();
+
+  /**
+   * \brief
+   *    Probe files in the background, after any that are waiting already.
+   */
+  void scan(const Array<File>& files);
+
+  /**
+   * \brief
+   *    Check files whose details are known already, in the background, and probe only
+   *    those whose size or modification time has changed since.
+   *
+   * \param knownFiles
+   *    The files, with the details they had when they were last probed
+   */
+  void scan(const std::vector<Result>& knownFiles);
+
+  /**
+   * \brief
+   *    Checks whether any files are still waiting or being probed.
+   */
+  bool isScanning();
+
+  /**
+   * \brief
+   *    Get the number of files probed and asked for since the scan started.
+   */
+  void getProgress(int& numDone, int& numTotal);
+
+  void addListener(Listener* listener);
+  void removeListener(Listener* listener);
+
+private:
+  class ScanJob;
+
+  // files checked by a job before it hands the changed ones over to the message thread
+  static constexpr int batchSize = 64;
+
+  /**
+   * \brief
+   *    The end of a scan, as seen by the one job that finishes it.
+   */
+  struct ScanSummary {
+    bool isFinished = false;
+    int filesScanned = 0;
+    double seconds = 0;
+  };
+
+  /**
+   * \brief
+   *    Take the next files off the list. Called by the scan jobs.
+   *
+   * \param files
+   *    Set to the next batch of files
+   * \param summary
+   *    Filled in for the last job to find nothing left, in the same locked section that
+   *    stops it, so that exactly one job reports the end of the scan
+   *
+   * \return
+   *    false if there is nothing left to probe
+   */
+  bool takeNextFiles(std::vector<Result>& files, ScanSummary& summary);
+
+  /**
+   * \brief
+   *    Read the length of a file, unless it is known and unchanged. Safe on any number of
+   *    threads at once.
+   *
+   * \param known
+   *    The file, with its details if they are known
+   * \param result
+   *    Set to the file's new details if it has changed
+   *
+   * \return
+   *    true if the file was probed
+   */
+  bool probe(const Result& known, Result& result);
+
+  /**
+   * \brief
+   *    Hand a batch of results to the listeners, and report the end of the scan after the
+   *    last one. Scan thread.
+   *
+   * \param results
+   *    The files that were probed
+   * \param numChecked
+   *    The number of files checked, including unchanged ones
+   * \param summary
+   *    From takeNextFiles: reports the end of the scan if it is finished
+   */
+  void deliver(std::vector<Result>&& results, int numChecked, const ScanSummary& summary);
+
+  const int numThreads;
+
+  // registered once in the constructor, then only read
+  AudioFormatManager formatManager;
+
+  CriticalSection lock;
+  std::deque<Result> pending;
+  int numJobs = 0;
+  int numDone = 0;
+  int numTotal = 0;
+  double scanStartMs = 0;
+
+  ListenerList<Listener> listeners;
+
+  // copied by the scan jobs to call back on the message thread. Made once in the constructor,
+  // because the first WeakReference to an object creates its shared pointer without a lock
+  WeakReference<LibraryScanner> weakThis;
+
+  // declared last so that it is destroyed first
+  ThreadPool scanPool;
+
+  JUCE_DECLARE_WEAK_REFERENCEABLE(LibraryScanner)
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LibraryScanner)
+};
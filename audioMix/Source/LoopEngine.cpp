@@ -0,0 +1,229 @@
+/*
+  ==============================================================================
+
+    LoopEngine.cpp
+    Created: 19 Oct 2026 2:26:05pm
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "LoopEngine.h"
+
+namespace {
+  /* Fill in the crossfade gains of a region (a quarter sine, so the fade keeps equal power) */
+  void buildCrossfade(LoopEngine::Region& region, int crossfade) {
+    // the crossfade can't be longer than half of the loop
+    region.crossfade = (int) jlimit((int64) 0, (region.end - region.start) / 2, (int64) crossfade);
+    region.fadeIn.allocate((size_t) jmax(1, region.crossfade), true);
+
+    for (int i = 0; i < region.crossfade; ++i)
+      region.fadeIn[i] = (float) std::sin((i + 0.5) / region.crossfade * MathConstants<double>::halfPi);
+  }
+}
+
+//==============================================================================
+/* Build a region that plays from a decoded copy of the whole track */
+std::unique_ptr<LoopEngine::Region> LoopEngine::createRegion(std::shared_ptr<const AudioBuffer<float>> track,
+                                                             int64 start, int64 end, int crossfade)
+{
+  if (track == nullptr)
+    return nullptr;
+
+  start = jlimit((int64) 0, (int64) track->getNumSamples(), start);
+  end = jlimit((int64) 0, (int64) track->getNumSamples(), end);
+
+  if (end <= start)
+    return nullptr;
+
+  auto region = std::make_unique<Region>();
+  region->audio = std::move(track);
+  region->audioStart = 0;
+  region->start = start;
+  region->end = end;
+  buildCrossfade(*region, crossfade);
+
+  return region;
+}
+
+/* Build a region by decoding its audio from a reader */
+std::unique_ptr<LoopEngine::Region> LoopEngine::decodeRegion(AudioFormatReader& reader,
+                                                             int64 start, int64 end, int crossfade,
+                                                             int64 maxLength)
+{
+  start = jlimit((int64) 0, reader.lengthInSamples, start);
+  end = jlimit((int64) 0, reader.lengthInSamples, end);
+
+  if (end <= start || reader.numChannels == 0)
+    return nullptr;
+
+  auto region = std::make_unique<Region>();
+  region->start = start;
+  region->end = end;
+  buildCrossfade(*region, crossfade);
+
+  // the crossfade also needs the audio just before the loop start
+  region->audioStart = jmax((int64) 0, start - region->crossfade);
+
+  auto decodedEnd = maxLength >= 0 ? jmin(end, start + maxLength) : end;
+  auto numSamples = (int) (decodedEnd - region->audioStart);
+  auto audio = std::make_shared<AudioBuffer<float>>((int) reader.numChannels, numSamples);
+
+  if (!reader.read(audio.get(), 0, numSamples, region->audioStart, true, true))
+    return nullptr;
+
+  region->audio = std::move(audio);
+  return region;
+}
+
+/* Build a region with no decoded audio, which plays from the track and wraps by seeking it */
+std::unique_ptr<LoopEngine::Region> LoopEngine::createStreamedRegion(int64 start, int64 end, int64 trackLength) {
+  start = jlimit((int64) 0, trackLength, start);
+  end = jlimit((int64) 0, trackLength, end);
+
+  if (end <= start)
+    return nullptr;
+
+  auto region = std::make_unique<Region>();
+  region->start = start;
+  region->end = end;
+
+  // there is nothing decoded to crossfade with
+  buildCrossfade(*region, 0);
+
+  return region;
+}
+
+/* Start looping a region */
+void LoopEngine::setRegion(const Region* newRegion, PositionableAudioSource& source, bool isRoll) {
+  region = newRegion;
+
+  if (region == nullptr)
+    return;
+
+  auto position = source.getNextReadPosition();
+
+  // a roll remembers where playback would have carried on from
+  if (isRoll && !rolling) {
+    rolling = true;
+    rollOrigin = position;
+    rollElapsed = 0;
+  }
+
+  // a loop set behind the playhead starts straight away
+  if (position >= region->end)
+    source.setNextReadPosition(region->start);
+}
+
+/* Stop looping */
+void LoopEngine::clear(PositionableAudioSource& source) {
+  if (rolling)
+    source.setNextReadPosition(rollOrigin + rollElapsed);
+
+  reset();
+}
+
+/* Forget the region without moving the track */
+void LoopEngine::reset() {
+  region = nullptr;
+  rolling = false;
+  rollOrigin = 0;
+  rollElapsed = 0;
+}
+
+/* Get the region being looped */
+const LoopEngine::Region* LoopEngine::getRegion() const {
+  return region;
+}
+
+/* Fill a block from the track, wrapping at the loop out */
+void LoopEngine::render(PositionableAudioSource& source, const AudioSourceChannelInfo& info) {
+  if (rolling)
+    rollElapsed += info.numSamples;
+
+  auto position = source.getNextReadPosition();
+
+  // outside the loop (or past it, after a seek) the track plays as usual
+  if (region == nullptr || position >= region->end) {
+    source.getNextAudioBlock(info);
+    return;
+  }
+
+  int done = 0;
+
+  // play up to the loop in from the track
+  if (position < region->start) {
+    done = (int) jmin((int64) info.numSamples, region->start - position);
+
+    AudioSourceChannelInfo beforeLoop(info.buffer, info.startSample, done);
+    source.getNextAudioBlock(beforeLoop);
+    position += done;
+  }
+
+  // then from the loop's own audio, wrapping as often as needed
+  while (done < info.numSamples) {
+    auto num = (int) jmin((int64) (info.numSamples - done), region->end - position);
+    auto decodedEnd = region->getDecodedEnd();
+
+    if (position < decodedEnd) {
+      num = (int) jmin((int64) num, decodedEnd - position);
+      copyFromRegion(position, *info.buffer, info.startSample + done, num);
+    }
+    else {
+      // past the decoded audio the track plays on, from wherever the wrap left it
+      if (source.getNextReadPosition() != position)
+        source.setNextReadPosition(position);
+
+      AudioSourceChannelInfo fromTrack(info.buffer, info.startSample + done, num);
+      source.getNextAudioBlock(fromTrack);
+    }
+
+    applyCrossfade(position, *info.buffer, info.startSample + done, num);
+
+    done += num;
+    position += num;
+
+    if (position >= region->end)
+      position = region->start;
+  }
+
+  // keep the track's position (and so its read-ahead and the GUI) in step with the loop
+  source.setNextReadPosition(position);
+}
+
+/* Copy part of the region's decoded audio into a buffer */
+void LoopEngine::copyFromRegion(int64 position, AudioBuffer<float>& dest, int destStart, int numSamples) {
+  auto& audio = *region->audio;
+
+  for (int chan = 0; chan < dest.getNumChannels(); ++chan) {
+    // a mono track plays on every channel
+    auto* src = audio.getReadPointer(jmin(chan, audio.getNumChannels() - 1));
+    FloatVectorOperations::copy(dest.getWritePointer(chan, destStart), src + (position - region->audioStart), numSamples);
+  }
+}
+
+/* Crossfade the part of a block that reaches into the end of the loop with the audio before the loop start */
+void LoopEngine::applyCrossfade(int64 position, AudioBuffer<float>& dest, int destStart, int numSamples) {
+  auto fadeStart = region->end - region->crossfade;
+  auto firstFaded = (int) jlimit((int64) 0, (int64) numSamples, fadeStart - position);
+
+  if (region->crossfade == 0 || firstFaded >= numSamples)
+    return;
+
+  auto& audio = *region->audio;
+  auto loopLength = region->end - region->start;
+
+  for (int chan = 0; chan < dest.getNumChannels(); ++chan) {
+    auto* src = audio.getReadPointer(jmin(chan, audio.getNumChannels() - 1));
+    auto* out = dest.getWritePointer(chan, destStart);
+
+    for (int i = firstFaded; i < numSamples; ++i) {
+      auto fadePos = (int) (position + i - fadeStart);
+      auto headPos = position + i - loopLength - region->audioStart;
+
+      // the audio before the loop start fades in as the loop end fades out
+      auto head = headPos >= 0 ? src[headPos] : 0.0f;
+      out[i] = out[i] * region->fadeIn[region->crossfade - 1 - fadePos] + head * region->fadeIn[fadePos];
+    }
+  }
+}
@@ -0,0 +1,167 @@
+/*
+  ==============================================================================
+
+    LoopEngine.h
+    Created: 19 Oct 2026 2:26:05pm
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Sample-accurate looping inside a deck's render path.
+
+    A loop is a Region of the track whose audio is already decoded, either
+    referenced straight from the decoded (or memory-mapped) track or copied out
+    of the file when the region is created. While the playhead is inside the
+    region the engine plays from that audio, so wrapping never waits for the
+    decoder. The last few milliseconds before the loop end are crossfaded
+    (equal power) with the audio just before the loop start, so the wrap is
+    seamless.
+
+    A loop too long to copy, on a track that isn't decoded yet, can have only
+    its start decoded (or nothing at all). Past the decoded part the track
+    plays on from its read-ahead stream, and the wrap seeks that stream back
+    to the loop start, so it refills while the decoded start plays.
+
+    Regions are built on the message thread or a background thread; everything
+    else runs on the audio thread and never allocates.
+*/
+class LoopEngine {
+public:
+  /**
+   * \brief
+   *    A loop region and the decoded audio it plays from. Immutable once built.
+   */
+  struct Region {
+    std::shared_ptr<const AudioBuffer<float>> audio; // may stop before the loop end, or be nullptr
+    int64 audioStart = 0;   // track position of audio's first sample
+    int64 start = 0;        // loop in (inclusive), in track samples
+    int64 end = 0;          // loop out (exclusive), in track samples
+    int crossfade = 0;      // samples before the loop end that are crossfaded
+    HeapBlock<float> fadeIn; // crossfade gains; read backwards they fade out
+
+    /**
+     * \brief
+     *    Get the track position just after the last sample in audio.
+     */
+    int64 getDecodedEnd() const { return audio != nullptr ? audioStart + audio->getNumSamples() : 0; }
+  };
+
+  /**
+   * \brief
+   *    Build a region that plays from a decoded copy of the whole track (nothing is copied).
+   *
+   * \param track
+   *    The decoded or memory-mapped track
+   * \param start
+   *    Loop in, in samples
+   * \param end
+   *    Loop out, in samples
+   * \param crossfade
+   *    Length of the crossfade at the wrap, in samples
+   *
+   * \return
+   *    The region, or nullptr if it is empty
+   */
+  static std::unique_ptr<Region> createRegion(std::shared_ptr<const AudioBuffer<float>> track,
+                                               int64 start, int64 end, int crossfade);
+
+  /**
+   * \brief
+   *    Build a region by decoding its audio (and the crossfade before it) from a reader.
+   *    Use it on a background thread.
+   *
+   * \param maxLength
+   *    Decode at most this many samples of the loop, and play the rest from the track
+   *    (-1 decodes all of it)
+   *
+   * \return
+   *    The region, or nullptr if it is empty or can't be read
+   */
+  static std::unique_ptr<Region> decodeRegion(AudioFormatReader& reader,
+                                              int64 start, int64 end, int crossfade,
+                                              int64 maxLength = -1);
+
+  /**
+   * \brief
+   *    Build a region with no decoded audio, which plays from the track and wraps by seeking
+   *    it (with no crossfade). A stopgap until the loop's audio is decoded.
+   *
+   * \param trackLength
+   *    The length of the track, in samples
+   *
+   * \return
+   *    The region, or nullptr if it is empty
+   */
+  static std::unique_ptr<Region> createStreamedRegion(int64 start, int64 end, int64 trackLength);
+
+  /**
+   * \brief
+   *    Start looping a region. Audio thread only.
+   *
+   * \param newRegion
+   *    The region, owned by the caller until it has been replaced or cleared
+   * \param source
+   *    The track being played, moved to the loop start if it is already past the loop end
+   * \param isRoll
+   *    True for a loop roll: when it is cleared, playback continues from where it would
+   *    have been had the loop never happened
+   */
+  void setRegion(const Region* newRegion, PositionableAudioSource& source, bool isRoll);
+
+  /**
+   * \brief
+   *    Stop looping. Audio thread only. Ends a loop roll by moving the track to where it
+   *    would have been without the roll.
+   */
+  void clear(PositionableAudioSource& source);
+
+  /**
+   * \brief
+   *    Forget the region without moving the track (e.g. when a new track is swapped in).
+   */
+  void reset();
+
+  /**
+   * \brief
+   *    Get the region being looped, or nullptr. Audio thread only.
+   */
+  const Region* getRegion() const;
+
+  /**
+   * \brief
+   *    Fill a block from the track, wrapping at the loop out. Audio thread only.
+   *
+   * \param source
+   *    The track being played
+   * \param bufferToFill
+   *    The destination buffer to fill with audio data
+   */
+  void render(PositionableAudioSource& source, const AudioSourceChannelInfo& bufferToFill);
+
+private:
+  /**
+   * \brief
+   *    Copy part of the region's decoded audio into a buffer.
+   */
+  void copyFromRegion(int64 position, AudioBuffer<float>& dest, int destStart, int numSamples);
+
+  /**
+   * \brief
+   *    Crossfade the part of a block that reaches into the end of the loop with the audio before the loop start.
+   */
+  void applyCrossfade(int64 position, AudioBuffer<float>& dest, int destStart, int numSamples);
+
+  const Region* region = nullptr;
+
+  // loop roll: where the roll started and how far the track would have played since
+  bool rolling = false;
+  int64 rollOrigin = 0;
+  int64 rollElapsed = 0;
+};
@@ -1,4 +1,5 @@
 #include "MainComponent.h"
+#include "RealtimeGuard.h"
 
 //==============================================================================
 MainComponent::MainComponent() {
@@ -26,11 +27,29 @@ MainComponent::MainComponent() {
   addAndMakeVisible(crossfader);
 
   formatManager.registerBasicFormats();
+
+  // more decks or sample players are added to the mix engine the same way
+  mixEngine.addChannel(&player1);
+  mixEngine.addChannel(&player2);
+
+  performanceLogger.addSource("master", callbackStats);
+  performanceLogger.addSource("deck1", player1.getCallbackStats());
+  performanceLogger.addSource("deck2", player2.getCallbackStats());
+
+  // for the performance view shortcut
+  setWantsKeyboardFocus(true);
+
+  startTimerHz(4);
 }
 
 MainComponent::~MainComponent() {
+  stopTimer();
+
   // This shuts down the audio device and clears the audio source.
   shutdownAudio();
+
+  mixEngine.removeChannel(&player1);
+  mixEngine.removeChannel(&player2);
 }
 
 //==============================================================================
@@ -39,29 +58,29 @@ void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate
   // This function will be called when the audio device is started, or when
   // its settings (i.e. sample rate, block size, etc) are changed.
 
-  // add player1 and player2 as an input source to mixer
-  mixerSource.addInputSource(&player1, false);
-  mixerSource.addInputSource(&player2, false);
+  // prepares every deck added to the mix engine
+  mixEngine.prepareToPlay(samplesPerBlockExpected, sampleRate);
 
-  // call prepareToPlay() on each input source
-  player1.prepareToPlay(samplesPerBlockExpected, sampleRate);
-  player2.prepareToPlay(samplesPerBlockExpected, sampleRate);
+  callbackStats.prepare(sampleRate);
 }
 
 /* Called repeatedly to fetch subsequent blocks of audio data. */
 void MainComponent::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) {
-  mixerSource.getNextAudioBlock(bufferToFill);
+  callbackStats.beginCallback(bufferToFill.numSamples);
+
+  auto start = Time::getHighResolutionTicks();
+  mixEngine.getNextAudioBlock(bufferToFill);
+  callbackStats.addStageTime(0, Time::getHighResolutionTicks() - start);
+
+  callbackStats.endCallback();
 }
 
 /* Release of resources that are no longer needed once playback stops. */
 void MainComponent::releaseResources() {
   // This will be called when the audio device stops, or when it is being restarted due to a setting change.
 
-  // free up the resources
-  player1.releaseResources();
-  player2.releaseResources();
-  mixerSource.removeAllInputs();
-  mixerSource.releaseResources();
+  // free up the resources of every deck
+  mixEngine.releaseResources();
 }
 
 //==============================================================================
@@ -85,3 +104,29 @@ void MainComponent::resized() {
   playlistComponent.setBounds(0, getHeight() / 2, (getWidth() / 4) * 3 , getHeight() / 2);
   queueComponent.setBounds(playlistComponent.getRight(), getHeight() / 2, getWidth() / 4, getHeight() / 2);
 }
+
+/* Opens the performance view on Ctrl/Cmd+P. */
+bool MainComponent::keyPressed(const KeyPress& key) {
+  if (key == KeyPress('p', ModifierKeys::commandModifier, 0)) {
+    CallOutBox::launchAsynchronously(std::make_unique<PerformanceComponent>(callbackStats, &player1, &player2,
+                                                                             deckGUI1.getWaveformDisplay(),
+                                                                             deckGUI2.getWaveformDisplay(),
+                                                                             performanceLogger),
+                                     crossfader.getScreenBounds(), nullptr);
+    return true;
+  }
+
+  return false;
+}
+
+/* Passes on the xrun count, logs real-time violations and tells the analyser about playback. */
+void MainComponent::timerCallback() {
+  trackAnalyser->setPlaybackActive(player1.isPlaying || player2.isPlaying);
+
+  if (auto* device = deviceManager.getCurrentAudioDevice())
+    callbackStats.setDeviceXruns(device->getXRunCount());
+
+  // anything the audio thread allocated or locked (Debug builds only)
+  for (auto& report : RealtimeGuard::takeReports())
+    DBG(report);
+}
@@ -2,10 +2,17 @@
 
 #include <JuceHeader.h>
 #include "DJAudioPlayer.h"
+#include "MixEngine.h"
+#include "RenderWorkerPool.h"
+#include "ReadAheadScheduler.h"
 #include "DeckGUI.h"
 #include "PlaylistComponent.h"
 #include "QueueComponent.h"
 #include "Crossfader.h"
+#include "AudioCallbackStats.h"
+#include "PerformanceLogger.h"
+#include "PerformanceComponent.h"
+#include "TrackAnalyser.h"
 
 
 //==============================================================================
@@ -13,7 +20,8 @@
     This component lives inside our window, and this is where you should put all
     your controls and content.
 */
-class MainComponent : public AudioAppComponent {
+class MainComponent : public AudioAppComponent,
+                      private Timer {
 public:
   //==============================================================================
   /**
@@ -71,8 +79,25 @@ public:
    */
   void resized() override;
 
+  /**
+   * \brief
+   *    Opens the performance view on Ctrl/Cmd+P.
+   *
+   * \param key
+   *    The key that was pressed
+   */
+  bool keyPressed(const KeyPress& key) override;
+
 
 private:
+  /**
+   * \brief
+   *    Passes the audio device's xrun count to the callback statistics, logs any
+   *    allocation or lock caught on the audio thread, and tells the track analyser
+   *    whether a deck is playing.
+   */
+  void timerCallback() override;
+
   //==============================================================================
   // Your private member variables go here...
 
@@ -80,22 +105,37 @@ private:
 
   AudioFormatManager formatManager;
 
-  // store up to 30 files in the cache at any one time
-  AudioThumbnailCache thumbCache{ 30 };
+  // one pool of decoding threads shared by every deck
+  ReadAheadScheduler readAheadScheduler;
+
+  // real-time threads that render the decks in parallel when that pays off (one job per deck)
+  RenderWorkerPool renderWorkerPool{ 2 };
+
+  // sums every deck (and any sample players) into the output
+  MixEngine mixEngine{ &renderWorkerPool };
 
   // addding a DJAudioPlayer object as a data member
-  DJAudioPlayer player1{ formatManager };
-  DJAudioPlayer player2{ formatManager };
+  DJAudioPlayer player1{ formatManager, readAheadScheduler };
+  DJAudioPlayer player2{ formatManager, readAheadScheduler };
 
-  DeckGUI deckGUI1{ &player1, formatManager, thumbCache, &queueComponent, true };
-  DeckGUI deckGUI2{ &player2, formatManager, thumbCache, &queueComponent, false };
+  DeckGUI deckGUI1{ &player1, formatManager, &queueComponent, true };
+  DeckGUI deckGUI2{ &player2, formatManager, &queueComponent, false };
 
-  MixerAudioSource mixerSource;
   QueueComponent queueComponent;
 
   PlaylistComponent playlistComponent{ &deckGUI1, &deckGUI2, &queueComponent };
 
-  Crossfader crossfader{ &deckGUI1, &deckGUI2 };
+  Crossfader crossfader{ &mixEngine, &player1, &player2 };
+
+  // steps back from analysing the library while a deck is playing
+  SharedResourcePointer<TrackAnalyser> trackAnalyser;
+
+  // timing of the whole output callback
+  AudioCallbackStats callbackStats{ { "mix" } };
+
+  // writes the master and deck statistics to a log once a second while enabled
+  PerformanceLogger performanceLogger{ File::getSpecialLocation(File::userApplicationDataDirectory)
+                                         .getChildFile("audioMix").getChildFile("performance.log") };
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
@@ -0,0 +1,292 @@
+/*
+  ==============================================================================
+
+    MixEngine.cpp
+    Created: 20 Oct 2026 10:04:51am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "MixEngine.h"
+#include "RealtimeGuard.h"
+
+//==============================================================================
+MixEngine::MixEngine(RenderWorkerPool* _renderPool, int _numChannels)
+                   : renderPool(_renderPool),
+                     numChannels(_numChannels),
+                     numJobs(0),
+                     chunkSamples(0),
+                     rampLength(0),
+                     preparedBlockSize(0),
+                     preparedSampleRate(0)
+{
+}
+
+MixEngine::~MixEngine() {
+}
+
+/* Allocate the scratch buffers and prepare the sources added so far */
+void MixEngine::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+  const ScopedLock sl(prepareLock);
+
+  preparedBlockSize = jmax(1, samplesPerBlockExpected);
+  preparedSampleRate = sampleRate;
+
+  rampUp.allocate((size_t) preparedBlockSize, true);
+  rampedChannel.allocate((size_t) preparedBlockSize, true);
+  rampLength = 0;
+
+  // every slot gets its buffer now, so a channel added later doesn't allocate
+  for (auto& channel : channels) {
+    channel.buffer.setSize(numChannels, preparedBlockSize);
+    channel.currentGain = channel.targetGain.load();
+
+    if (auto* source = channel.source.load())
+      source->prepareToPlay(samplesPerBlockExpected, sampleRate);
+  }
+}
+
+/* Release the resources of every source and free the scratch buffers */
+void MixEngine::releaseResources() {
+  const ScopedLock sl(prepareLock);
+
+  for (auto& channel : channels) {
+    if (auto* source = channel.source.load())
+      source->releaseResources();
+
+    channel.buffer.setSize(numChannels, 0);
+  }
+
+  preparedBlockSize = 0;
+}
+
+/* Render every channel and sum them into the destination buffer */
+void MixEngine::getNextAudioBlock(const AudioSourceChannelInfo& info) {
+  const RealtimeGuard::ScopedRealtimeThread realtime;
+
+  isRendering = true;
+
+  info.clearActiveBufferRegion();
+
+  // the device may ask for more than it said it would, so mix in pieces the scratch buffers can hold
+  if (preparedBlockSize > 0) {
+    for (int done = 0; done < info.numSamples;) {
+      auto num = jmin(info.numSamples - done, preparedBlockSize);
+      renderChunk(*info.buffer, info.startSample + done, num);
+      done += num;
+    }
+  }
+
+  isRendering = false;
+}
+
+/* Add a deck or sample player to the mix */
+bool MixEngine::addChannel(AudioSource* source, float gain) {
+  jassert(source != nullptr);
+
+  if (source == nullptr || findChannel(source) >= 0)
+    return false;
+
+  const ScopedLock sl(prepareLock);
+
+  for (auto& channel : channels) {
+    if (channel.source.load() != nullptr)
+      continue;
+
+    // the audio thread picks the gain up as soon as it sees the source, so set it first
+    channel.targetGain = gain;
+    channel.cpuLoad = 0;
+
+    if (preparedBlockSize > 0)
+      source->prepareToPlay(preparedBlockSize, preparedSampleRate);
+
+    channel.source = source;
+    return true;
+  }
+
+  return false;
+}
+
+/* Remove a source from the mix */
+void MixEngine::removeChannel(AudioSource* source) {
+  auto index = findChannel(source);
+
+  if (index < 0)
+    return;
+
+  channels[(size_t) index].source = nullptr;
+
+  // a block that started before the slot was cleared may still be rendering the source
+  while (isRendering.load())
+    Thread::yield();
+
+  const ScopedLock sl(prepareLock);
+
+  if (preparedBlockSize > 0)
+    source->releaseResources();
+}
+
+/* Set the gain of a channel */
+void MixEngine::setChannelGain(AudioSource* source, float gain) {
+  auto index = findChannel(source);
+
+  if (index >= 0)
+    channels[(size_t) index].targetGain = gain;
+}
+
+/* Get the gains of the two channels either side of a crossfader */
+void MixEngine::getCrossfaderGains(double position, float& leftGain, float& rightGain) {
+  // both players are at full volume in the middle, and each side fades out linearly towards
+  // the other end, so the gains move continuously across the whole travel
+  position = jlimit(0.0, 1.0, position);
+
+  leftGain = (float) jmin(1.0, 2.0 * (1.0 - position));
+  rightGain = (float) jmin(1.0, 2.0 * position);
+}
+
+/* Get the number of channels in the mix */
+int MixEngine::getNumChannels() const {
+  int num = 0;
+
+  for (auto& channel : channels)
+    if (channel.source.load() != nullptr)
+      ++num;
+
+  return num;
+}
+
+/* Get the time a channel takes to render, as a share of each block's time budget */
+double MixEngine::getChannelCpuLoad(AudioSource* source) const {
+  auto index = findChannel(source);
+  return index >= 0 ? channels[(size_t) index].cpuLoad.load() : 0.0;
+}
+
+/* Get the time spent summing the channels, as a share of each block's time budget */
+double MixEngine::getMixCpuLoad() const {
+  return mixCpuLoad.load();
+}
+
+/* Allow or forbid rendering the channels in parallel */
+void MixEngine::setParallelRenderingEnabled(bool shouldBeEnabled) {
+  parallelEnabled = shouldBeEnabled;
+}
+
+/* Checks whether the last block was rendered in parallel */
+bool MixEngine::isRenderingInParallel() const {
+  return renderingInParallel.load();
+}
+
+/* Find the slot holding a source */
+int MixEngine::findChannel(AudioSource* source) const {
+  for (size_t i = 0; i < channels.size(); ++i)
+    if (channels[i].source.load() == source)
+      return (int) i;
+
+  return -1;
+}
+
+/* Render and sum one stretch of the output */
+void MixEngine::renderChunk(AudioBuffer<float>& output, int startSample, int numSamples) {
+  numJobs = 0;
+  chunkSamples = numSamples;
+
+  // take each source once, so a channel removed half way through the block is still rendered to the end
+  for (int i = 0; i < maxChannels; ++i) {
+    if (auto* source = channels[(size_t) i].source.load()) {
+      jobChannels[(size_t) numJobs] = i;
+      jobSources[(size_t) numJobs] = source;
+      ++numJobs;
+    }
+  }
+
+  auto parallel = shouldRenderInParallel();
+  renderingInParallel = parallel;
+
+  if (parallel) {
+    renderPool->run(*this, numJobs);
+  }
+  else {
+    for (int i = 0; i < numJobs; ++i)
+      runJob(i);
+  }
+
+  // join: sum every channel into the output on the audio thread
+  auto startTicks = Time::getHighResolutionTicks();
+
+  for (int i = 0; i < numJobs; ++i) {
+    auto& channel = channels[(size_t) jobChannels[(size_t) i]];
+
+    auto startGain = channel.currentGain;
+    auto endGain = channel.targetGain.load();
+    addWithGainRamp(output, channel.buffer, startSample, numSamples, startGain, endGain);
+    channel.currentGain = endGain;
+  }
+
+  // share of the block's time budget, smoothed over the last few blocks
+  auto mixSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+  mixCpuLoad = mixCpuLoad.load() * 0.9 + (mixSeconds / (numSamples / preparedSampleRate)) * 0.1;
+}
+
+/* Decide whether rendering this block's channels in parallel is worth the handoff */
+bool MixEngine::shouldRenderInParallel() const {
+  if (renderPool == nullptr || renderPool->getNumWorkers() == 0 || numJobs < 2 || !parallelEnabled.load())
+    return false;
+
+  // at best the block takes as long as its slowest deck, so compare that with rendering them all in turn
+  auto budget = chunkSamples / preparedSampleRate;
+  double totalSeconds = 0, longestSeconds = 0;
+
+  for (int i = 0; i < numJobs; ++i) {
+    auto seconds = channels[(size_t) jobChannels[(size_t) i]].cpuLoad.load() * budget;
+    totalSeconds += seconds;
+    longestSeconds = jmax(longestSeconds, seconds);
+  }
+
+  return totalSeconds - longestSeconds > minParallelGainSeconds;
+}
+
+/* Render one of the channels of the current chunk */
+void MixEngine::runJob(int index) {
+  const RealtimeGuard::ScopedRealtimeThread realtime;
+
+  auto& channel = channels[(size_t) jobChannels[(size_t) index]];
+  auto startTicks = Time::getHighResolutionTicks();
+
+  AudioSourceChannelInfo part(&channel.buffer, 0, chunkSamples);
+  jobSources[(size_t) index]->getNextAudioBlock(part);
+
+  // share of the block's time budget, smoothed over the last few blocks
+  auto elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+  channel.cpuLoad = channel.cpuLoad.load() * 0.9 + (elapsed / (chunkSamples / preparedSampleRate)) * 0.1;
+}
+
+/* Add a channel's scratch buffer to the output with its gain ramped linearly */
+void MixEngine::addWithGainRamp(AudioBuffer<float>& output, const AudioBuffer<float>& channelBuffer,
+                                int startSample, int numSamples, float startGain, float endGain)
+{
+  if (startGain == endGain && startGain == 0.0f)
+    return;
+
+  // the ramp only has to be rebuilt when the block size changes
+  if (startGain != endGain && rampLength != numSamples) {
+    for (int i = 0; i < numSamples; ++i)
+      rampUp[i] = (float) (i + 1) / (float) numSamples;
+
+    rampLength = numSamples;
+  }
+
+  for (int chan = 0; chan < output.getNumChannels(); ++chan) {
+    // any output channels beyond the engine's repeat its last one
+    auto* src = channelBuffer.getReadPointer(jmin(chan, numChannels - 1));
+    auto* out = output.getWritePointer(chan, startSample);
+
+    FloatVectorOperations::addWithMultiply(out, src, startGain, numSamples);
+
+    // out += (startGain + (endGain - startGain) * ramp) * src, as two vector passes
+    if (startGain != endGain) {
+      FloatVectorOperations::multiply(rampedChannel.get(), src, rampUp.get(), numSamples);
+      FloatVectorOperations::addWithMultiply(out, rampedChannel.get(), endGain - startGain, numSamples);
+    }
+  }
+}
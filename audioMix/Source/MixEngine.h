@@ -0,0 +1,234 @@
+/*
+  ==============================================================================
+
+    MixEngine.h
+    Created: 20 Oct 2026 10:04:51am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RenderWorkerPool.h"
+
+//==============================================================================
+/*
+    Sums any number of decks and sample players into the output.
+
+    Each channel renders into its own scratch buffer, which is then added to
+    the output with the channel's gain ramped linearly across the block,
+    using vector operations only. When the decks are expensive enough for it
+    to pay off, they are rendered in parallel on a RenderWorkerPool and the
+    results joined for the sum; otherwise they render one after another on
+    the audio thread. Every channel slot and scratch buffer is allocated
+    up front in prepareToPlay, so adding or removing a channel only publishes
+    or clears a pointer and never allocates on the audio thread. The cost of
+    the mix is one render and two vector passes per channel, and the render
+    time of each channel is measured so the cost per deck can be shown.
+*/
+class MixEngine : public AudioSource,
+                  private RenderWorkerPool::Task
+{
+public:
+  /**
+   * \brief
+   *    Constructor.
+   *
+   * \param _renderPool
+   *    Threads to render the channels on in parallel (not owned), or nullptr to always render serially
+   * \param _numChannels
+   *    Number of audio channels in each source's output
+   */
+  MixEngine(RenderWorkerPool* _renderPool = nullptr, int _numChannels = 2);
+
+  /**
+   * \brief
+   *    Destructor.
+   */
+  ~MixEngine() override;
+
+  /**
+   * \brief
+   *    Allocate the scratch buffers and prepare the sources added so far.
+   *
+   * \param samplesPerBlockExpected
+   *    Number of samples to be supplied by the source
+   * \param sampleRate
+   *    The sample rate at which the output will be used
+   */
+  void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+
+  /**
+   * \brief
+   *    Release the resources of every source and free the scratch buffers.
+   */
+  void releaseResources() override;
+
+  /**
+   * \brief
+   *    Render every channel and sum them into the destination buffer.
+   *
+   * \param bufferToFill
+   *    The destination buffer to fill with audio data
+   */
+  void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+  /**
+   * \brief
+   *    Add a deck or sample player to the mix. Message thread only. If the engine is
+   *    already playing, the source is prepared here before the audio thread sees it.
+   *
+   * \param source
+   *    The source to add (not owned); it must stay alive until it is removed
+   * \param gain
+   *    The channel's initial gain
+   *
+   * \return
+   *    False if every channel slot is in use or the source was already added
+   */
+  bool addChannel(AudioSource* source, float gain = 1.0f);
+
+  /**
+   * \brief
+   *    Remove a source from the mix. Message thread only. Waits for the block being
+   *    rendered to finish, so the source can be deleted as soon as this returns.
+   */
+  void removeChannel(AudioSource* source);
+
+  /**
+   * \brief
+   *    Set the gain of a channel (e.g. from a crossfader). The change is ramped over the next block.
+   */
+  void setChannelGain(AudioSource* source, float gain);
+
+  /**
+   * \brief
+   *    Get the gains of the two channels either side of a crossfader. Both are at unity in the
+   *    middle, and each one fades out linearly over the far half of the travel. The Crossfader
+   *    component and the OfflineMixRenderer both use this, so a rendered mix fades exactly as a live one.
+   *
+   * \param position
+   *    The crossfader position, from 0 (left only) to 1 (right only)
+   * \param leftGain
+   *    Set to the gain of the left channel
+   * \param rightGain
+   *    Set to the gain of the right channel
+   */
+  static void getCrossfaderGains(double position, float& leftGain, float& rightGain);
+
+  /**
+   * \brief
+   *    Get the number of channels in the mix.
+   */
+  int getNumChannels() const;
+
+  /**
+   * \brief
+   *    Get the time a channel takes to render, as a share of each block's time budget.
+   *
+   * \return
+   *    The smoothed load, or 0 if the source isn't in the mix
+   */
+  double getChannelCpuLoad(AudioSource* source) const;
+
+  /**
+   * \brief
+   *    Get the time spent summing the channels (excluding their rendering), as a share
+   *    of each block's time budget. Divide by getNumChannels() for the cost per channel.
+   */
+  double getMixCpuLoad() const;
+
+  /**
+   * \brief
+   *    Allow or forbid rendering the channels in parallel.
+   */
+  void setParallelRenderingEnabled(bool shouldBeEnabled);
+
+  /**
+   * \brief
+   *    Checks whether the last block was rendered in parallel.
+   */
+  bool isRenderingInParallel() const;
+
+  // the most decks and sample players that can be mixed at once
+  static constexpr int maxChannels = 16;
+
+private:
+  struct Channel {
+    std::atomic<AudioSource*> source{ nullptr };
+    std::atomic<float> targetGain{ 1.0f };
+    std::atomic<double> cpuLoad{ 0 };
+
+    // written by whichever thread renders the channel, read by the audio thread
+    AudioBuffer<float> buffer;
+
+    // audio thread only
+    float currentGain = 1.0f;
+  };
+
+  /**
+   * \brief
+   *    Find the slot holding a source, or -1. Message thread only.
+   */
+  int findChannel(AudioSource* source) const;
+
+  /**
+   * \brief
+   *    Render and sum one stretch of the output, no longer than the scratch buffers.
+   */
+  void renderChunk(AudioBuffer<float>& output, int startSample, int numSamples);
+
+  /**
+   * \brief
+   *    Decide whether rendering this block's channels in parallel is worth the handoff.
+   */
+  bool shouldRenderInParallel() const;
+
+  /**
+   * \brief
+   *    Render one of the channels of the current chunk (on the audio thread or a worker).
+   */
+  void runJob(int index) override;
+
+  /**
+   * \brief
+   *    Add a channel's scratch buffer to the output with its gain ramped linearly.
+   */
+  void addWithGainRamp(AudioBuffer<float>& output, const AudioBuffer<float>& channelBuffer,
+                       int startSample, int numSamples, float startGain, float endGain);
+
+  // below this much time saved per block, handing decks to other threads costs more than it gains
+  static constexpr double minParallelGainSeconds = 0.0001;
+
+  RenderWorkerPool* renderPool;
+  const int numChannels;
+
+  std::array<Channel, maxChannels> channels;
+
+  // the channels rendered in the current chunk, and its length; set before the jobs run
+  std::array<int, maxChannels> jobChannels;
+  std::array<AudioSource*, maxChannels> jobSources;
+  int numJobs;
+  int chunkSamples;
+
+  // a linear ramp from 0 to 1 over rampLength samples, and room to apply it to one channel
+  HeapBlock<float> rampUp;
+  HeapBlock<float> rampedChannel;
+  int rampLength;
+
+  // stops a source being added half way through the engine being prepared or released
+  CriticalSection prepareLock;
+  int preparedBlockSize;
+  double preparedSampleRate;
+
+  // set while the audio thread is inside getNextAudioBlock, so sources can be removed safely
+  std::atomic<bool> isRendering{ false };
+  std::atomic<double> mixCpuLoad{ 0 };
+
+  std::atomic<bool> parallelEnabled{ true };
+  std::atomic<bool> renderingInParallel{ false };
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MixEngine)
+};
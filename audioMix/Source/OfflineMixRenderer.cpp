@@ -0,0 +1,311 @@
+/*
+  ==============================================================================
+
+    OfflineMixRenderer.cpp
+    Created: 21 Oct 2026 11:37:02am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "OfflineMixRenderer.h"
+
+//==============================================================================
+/* Renders one mix on the renderer's pool */
+class OfflineMixRenderer::RenderJob : public ThreadPoolJob {
+public:
+  RenderJob(OfflineMixRenderer& _owner, const Mix& _mix, std::function<void(const Result&)> _onFinished)
+          : ThreadPoolJob("Render " + _mix.outputFile.getFileName()),
+            owner(_owner),
+            mix(_mix),
+            onFinished(std::move(_onFinished))
+  {
+  }
+
+  JobStatus runJob() override {
+    auto result = owner.renderMix(mix, this);
+
+    if (onFinished != nullptr) {
+      MessageManager::callAsync([callback = onFinished, result] {
+        callback(result);
+      });
+    }
+
+    return jobHasFinished;
+  }
+
+private:
+  OfflineMixRenderer& owner;
+  const Mix mix;
+  std::function<void(const Result&)> onFinished;
+};
+
+//==============================================================================
+OfflineMixRenderer::OfflineMixRenderer(AudioFormatManager& _formatManager, int numThreads)
+                                     : formatManager(_formatManager),
+                                       cacheDirectory(File::getSpecialLocation(File::tempDirectory).getNonexistentChildFile("audioMix Render Cache", {}, false)),
+                                       pcmDiskCache(std::make_unique<PcmDiskCache>(cacheDirectory)),
+                                       renderPool(numThreads > 0 ? numThreads : SystemStats::getNumCpus())
+{
+}
+
+OfflineMixRenderer::~OfflineMixRenderer() {
+  cancelAll();
+
+  // wait for any transcode still writing into the cache directory, then remove it
+  pcmDiskCache.reset();
+  cacheDirectory.deleteRecursively();
+}
+
+/* Read a mix from JSON */
+Result OfflineMixRenderer::parseTimeline(const String& json, Mix& mix) {
+  auto timeline = JSON::parse(json);
+
+  if (!timeline.isObject())
+    return Result::fail("the timeline is not a JSON object");
+
+  mix.numDecks = jlimit(1, MixEngine::maxChannels, (int) timeline.getProperty("decks", 2));
+  mix.lengthInSeconds = timeline.getProperty("length", 0.0);
+  mix.sampleRate = timeline.getProperty("sampleRate", 44100.0);
+  mix.blockSize = timeline.getProperty("blockSize", 512);
+  mix.bitsPerSample = timeline.getProperty("bitsPerSample", 0);
+
+  auto output = timeline.getProperty("output", String()).toString();
+
+  if (output.isNotEmpty())
+    mix.outputFile = File::getCurrentWorkingDirectory().getChildFile(output);
+
+  if (mix.lengthInSeconds <= 0 || mix.sampleRate <= 0 || mix.blockSize <= 0)
+    return Result::fail("the timeline needs a length, sample rate and block size above zero");
+
+  static const std::pair<const char*, Event::Type> typeNames[] = {
+    { "load", Event::Type::load },             { "play", Event::Type::play },
+    { "stop", Event::Type::stop },             { "seek", Event::Type::seek },
+    { "speed", Event::Type::speed },           { "volume", Event::Type::volume },
+    { "crossfader", Event::Type::crossfader }
+  };
+
+  mix.events.clear();
+
+  if (auto* events = timeline.getProperty("events", var()).getArray()) {
+    for (auto& e : *events) {
+      Event event;
+      event.time = e.getProperty("time", 0.0);
+      event.deck = e.getProperty("deck", 0);
+      event.value = e.getProperty("value", 0.0);
+
+      auto type = e.getProperty("type", String()).toString();
+      auto found = std::find_if(std::begin(typeNames), std::end(typeNames),
+                                [&type](const auto& name) { return type == name.first; });
+
+      if (found == std::end(typeNames))
+        return Result::fail("unknown event type \"" + type + "\"");
+
+      event.type = found->second;
+
+      if (event.type == Event::Type::load) {
+        event.file = File::getCurrentWorkingDirectory().getChildFile(e.getProperty("file", String()).toString());
+
+        if (!event.file.existsAsFile())
+          return Result::fail("can't find " + event.file.getFullPathName());
+      }
+
+      if (event.type != Event::Type::crossfader && !isPositiveAndBelow(event.deck, mix.numDecks))
+        return Result::fail("event for deck " + String(event.deck) + ", but the mix has "
+                            + String(mix.numDecks) + " decks");
+
+      mix.events.push_back(event);
+    }
+  }
+
+  return Result::ok();
+}
+
+/* Render a mix on one of the renderer's threads */
+void OfflineMixRenderer::addMix(const Mix& mix, std::function<void(const Result&)> onFinished) {
+  renderPool.addJob(new RenderJob(*this, mix, std::move(onFinished)), true);
+}
+
+/* Get the number of mixes waiting or rendering */
+int OfflineMixRenderer::getNumPendingMixes() const {
+  return renderPool.getNumJobs();
+}
+
+/* Cancel every mix that hasn't finished */
+void OfflineMixRenderer::cancelAll() {
+  renderPool.removeAllJobs(true, 10000);
+}
+
+/* Render a mix on the calling thread */
+Result OfflineMixRenderer::renderMix(const Mix& mix, ThreadPoolJob* job) {
+  String error;
+  auto writer = createWriter(mix, error);
+
+  if (writer == nullptr)
+    return Result::fail(error);
+
+  // events in time order; those at the same time keep the order they were given in
+  auto events = mix.events;
+  std::stable_sort(events.begin(), events.end(),
+                   [](const Event& a, const Event& b) { return a.time < b.time; });
+
+  OwnedArray<DJAudioPlayer> decks;
+  MixEngine mixEngine;
+
+  // decks with the renderer's caches don't listen for anything on the message thread and never
+  // start their timers, so this thread is the only one that ever touches them
+  for (int i = 0; i < mix.numDecks; ++i)
+    mixEngine.addChannel(decks.add(new DJAudioPlayer(formatManager, readAheadScheduler, trackCache, *pcmDiskCache)));
+
+  mixEngine.prepareToPlay(mix.blockSize, mix.sampleRate);
+
+  AudioBuffer<float> block(2, mix.blockSize);
+  AudioSourceChannelInfo info(&block, 0, mix.blockSize);
+
+  auto totalSamples = (int64) (mix.lengthInSeconds * mix.sampleRate);
+  auto blockSeconds = mix.blockSize / mix.sampleRate;
+  size_t nextEvent = 0;
+  auto result = Result::ok();
+
+  for (int64 position = 0; position < totalSamples; position += mix.blockSize) {
+    // every event due before the end of this block takes effect at its start
+    while (nextEvent < events.size() && (int64) (events[nextEvent].time * mix.sampleRate) < position + mix.blockSize)
+      applyEvent(events[nextEvent++], decks, mixEngine);
+
+    if (!waitForReadAhead(decks, jmax(readAheadSeconds, blockSeconds * 4), job)) {
+      result = Result::fail(job != nullptr && job->shouldExit() ? "cancelled" : "a deck could not be decoded in time");
+      break;
+    }
+
+    // the whole block is always rendered, as it would be live; only the end of the last one is cut off
+    mixEngine.getNextAudioBlock(info);
+
+    // free the tracks the block has swapped out, which the message thread would do live
+    for (auto* deck : decks)
+      deck->releaseSwappedOut();
+
+    auto num = (int) jmin((int64) mix.blockSize, totalSamples - position);
+
+    if (!writer->writeFromAudioSampleBuffer(block, 0, num)) {
+      result = Result::fail("could not write to " + mix.outputFile.getFullPathName());
+      break;
+    }
+  }
+
+  writer.reset();
+
+  mixEngine.releaseResources();
+
+  for (auto* deck : decks)
+    mixEngine.removeChannel(deck);
+
+  decks.clear();
+
+  if (result.failed())
+    mix.outputFile.deleteFile();
+
+  return result;
+}
+
+/* Apply an event to the decks */
+void OfflineMixRenderer::applyEvent(const Event& event, OwnedArray<DJAudioPlayer>& decks, MixEngine& mixEngine) {
+  auto* deck = decks[event.deck];
+
+  switch (event.type) {
+    case Event::Type::load:
+      if (deck != nullptr)
+        deck->loadURL(URL(event.file));
+      break;
+
+    case Event::Type::play:
+      if (deck != nullptr)
+        deck->start();
+      break;
+
+    case Event::Type::stop:
+      if (deck != nullptr)
+        deck->stop();
+      break;
+
+    case Event::Type::seek:
+      if (deck != nullptr)
+        deck->setPosition(event.value);
+      break;
+
+    case Event::Type::speed:
+      if (deck != nullptr)
+        deck->setSpeed(event.value);
+      break;
+
+    case Event::Type::volume:
+      if (deck != nullptr)
+        deck->setGain(event.value);
+      break;
+
+    case Event::Type::crossfader:
+      // the same law as the Crossfader component
+      if (decks.size() >= 2) {
+        float leftGain, rightGain;
+        MixEngine::getCrossfaderGains(event.value, leftGain, rightGain);
+
+        mixEngine.setChannelGain(decks[0], leftGain);
+        mixEngine.setChannelGain(decks[1], rightGain);
+      }
+      break;
+  }
+}
+
+/* Wait until every playing deck has the next stretch of audio decoded */
+bool OfflineMixRenderer::waitForReadAhead(OwnedArray<DJAudioPlayer>& decks, double seconds, ThreadPoolJob* job) {
+  // only the renderer's own events swap a deck's track, so the decks can be queried from here
+  for (auto* deck : decks) {
+    if (!deck->isPlaying.load())
+      continue;
+
+    auto giveUpAt = Time::getMillisecondCounter() + (uint32) readAheadTimeoutMs;
+
+    while (deck->getBufferedSeconds() < jmin(seconds, deck->getLengthInSeconds() - deck->getPosition())) {
+      if ((job != nullptr && job->shouldExit()) || Time::getMillisecondCounter() > giveUpAt)
+        return false;
+
+      Thread::sleep(1);
+    }
+  }
+
+  return true;
+}
+
+/* Create the writer for the output file */
+std::unique_ptr<AudioFormatWriter> OfflineMixRenderer::createWriter(const Mix& mix, String& error) {
+  auto* format = formatManager.findFormatForFileExtension(mix.outputFile.getFileExtension());
+
+  if (format == nullptr || !format->canDoStereo()) {
+    error = "can't write " + mix.outputFile.getFullPathName() + " (use .wav or .flac)";
+    return nullptr;
+  }
+
+  // a float WAV keeps the mix exactly as rendered; FLAC only goes up to 24 bits
+  auto bits = mix.bitsPerSample;
+
+  if (bits <= 0)
+    bits = format->getPossibleBitDepths().contains(32) ? 32 : 24;
+
+  mix.outputFile.deleteFile();
+  auto stream = std::make_unique<FileOutputStream>(mix.outputFile);
+
+  if (stream->failedToOpen()) {
+    error = "can't create " + mix.outputFile.getFullPathName();
+    return nullptr;
+  }
+
+  std::unique_ptr<AudioFormatWriter> writer(format->createWriterFor(stream.get(), mix.sampleRate, 2, bits, {}, 0));
+
+  if (writer == nullptr) {
+    error = format->getFormatName() + " can't write " + String(bits) + "-bit audio at " + String(mix.sampleRate) + " Hz";
+    return nullptr;
+  }
+
+  // the writer owns the stream now
+  stream.release();
+  return writer;
+}
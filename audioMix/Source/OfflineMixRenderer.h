@@ -0,0 +1,184 @@
+/*
+  ==============================================================================
+
+    OfflineMixRenderer.h
+    Created: 21 Oct 2026 11:37:02am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DJAudioPlayer.h"
+#include "MixEngine.h"
+#include "ReadAheadScheduler.h"
+
+//==============================================================================
+/*
+    Renders a mix to a WAV or FLAC file without an audio device, as fast as
+    the CPU allows.
+
+    A mix is a timeline of deck events (load, play, stop, seek, speed, volume
+    and crossfader moves). Rendering runs the same DJAudioPlayer and MixEngine
+    path as live playback, at a fixed block size: the events due in a block
+    are applied before it is rendered, exactly as controls moved during live
+    playback take effect at the start of the next audio block. Before each
+    block the renderer waits until every playing deck has enough audio
+    decoded, so the result never depends on how fast the decoder ran, and a
+    32-bit WAV matches a live playback at the same block size bit for bit
+    (audioMixBench --render-test checks this).
+
+    Each mix renders on its own thread, so independent mixes scale across
+    cores. A mix's decks are created, controlled and rendered on that thread
+    alone, and decode into the renderer's own caches rather than the live
+    decks' shared ones. The renderer frees the tracks a deck has swapped out
+    itself between blocks, where the message thread's timer would do it live,
+    so rendering never needs the message thread (or a running message loop)
+    and never evicts a track loaded on a live deck.
+*/
+class OfflineMixRenderer {
+public:
+  /**
+   * \brief
+   *    Something that happens to a deck (or to the crossfader) at a point in the mix.
+   */
+  struct Event {
+    enum class Type { load, play, stop, seek, speed, volume, crossfader };
+
+    double time = 0;      // seconds from the start of the mix
+    int deck = 0;         // ignored for crossfader moves, which fade decks 0 and 1
+    Type type = Type::play;
+    double value = 0;     // seek position in seconds, speed ratio, gain or crossfader position
+    File file;            // the track to load
+  };
+
+  /**
+   * \brief
+   *    Everything needed to render one mix.
+   */
+  struct Mix {
+    std::vector<Event> events;
+    int numDecks = 2;
+    double lengthInSeconds = 0;
+    File outputFile;              // .wav or .flac
+    double sampleRate = 44100.0;
+    int blockSize = 512;          // match the live device's to reproduce a live playback
+    int bitsPerSample = 0;        // 0 for 32-bit float WAV or 24-bit FLAC
+  };
+
+  /**
+   * \brief
+   *    Constructor.
+   *
+   * \param _formatManager
+   *    Used to open the tracks and to find the writer for the output file
+   * \param numThreads
+   *    Number of mixes rendered at once, or 0 for one per core
+   */
+  OfflineMixRenderer(AudioFormatManager& _formatManager, int numThreads = 0);
+
+  /**
+   * \brief
+   *    Destructor. Cancels the mixes that haven't finished and deletes the renderer's cache directory.
+   */
+  ~OfflineMixRenderer();
+
+  /**
+   * \brief
+   *    Read a mix from JSON, e.g.
+   *    { "decks": 2, "length": 300, "output": "mix.flac",
+   *      "events": [ { "time": 0, "deck": 0, "type": "load", "file": "a.mp3" },
+   *                  { "time": 0, "deck": 0, "type": "play" },
+   *                  { "time": 60, "type": "crossfader", "value": 1.0 } ] }
+   *
+   * \param json
+   *    The timeline
+   * \param mix
+   *    Filled in from the timeline
+   *
+   * \return
+   *    An error if the timeline can't be read
+   */
+  static Result parseTimeline(const String& json, Mix& mix);
+
+  /**
+   * \brief
+   *    Render a mix on one of the renderer's threads.
+   *
+   * \param mix
+   *    The mix to render
+   * \param onFinished
+   *    Called on the message thread once the file has been written, or with the reason it wasn't
+   */
+  void addMix(const Mix& mix, std::function<void(const Result&)> onFinished = nullptr);
+
+  /**
+   * \brief
+   *    Render a mix on the calling thread and return once the file has been written.
+   *
+   * \param mix
+   *    The mix to render
+   * \param job
+   *    The job the render is running in, checked to see if it should stop early (optional)
+   *
+   * \return
+   *    An error if the mix couldn't be rendered
+   */
+  Result renderMix(const Mix& mix, ThreadPoolJob* job = nullptr);
+
+  /**
+   * \brief
+   *    Get the number of mixes waiting or rendering.
+   */
+  int getNumPendingMixes() const;
+
+  /**
+   * \brief
+   *    Cancel every mix that hasn't finished.
+   */
+  void cancelAll();
+
+private:
+  class RenderJob;
+
+  /**
+   * \brief
+   *    Apply an event to the decks.
+   */
+  static void applyEvent(const Event& event, OwnedArray<DJAudioPlayer>& decks, MixEngine& mixEngine);
+
+  /**
+   * \brief
+   *    Wait until every playing deck has the next stretch of audio decoded.
+   *
+   * \return
+   *    False if the job should stop, or a deck didn't fill in time
+   */
+  static bool waitForReadAhead(OwnedArray<DJAudioPlayer>& decks, double seconds, ThreadPoolJob* job);
+
+  /**
+   * \brief
+   *    Create the writer for the output file, choosing the format from its extension.
+   */
+  std::unique_ptr<AudioFormatWriter> createWriter(const Mix& mix, String& error);
+
+  // how much audio a playing deck must have decoded before a block is rendered, and how long to wait for it
+  static constexpr double readAheadSeconds = 0.5;
+  static constexpr int readAheadTimeoutMs = 30000;
+
+  AudioFormatManager& formatManager;
+
+  // the renderer's own decoding threads and caches, so offline mixes never hold up the live decks.
+  // The disk cache goes in a directory of its own, which no other renderer or process shares
+  const File cacheDirectory;
+  ReadAheadScheduler readAheadScheduler;
+  DecodedTrackCache trackCache;
+  std::unique_ptr<PcmDiskCache> pcmDiskCache;
+
+  // renders the mixes (declared last so that it is stopped first)
+  ThreadPool renderPool;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OfflineMixRenderer)
+};
@@ -0,0 +1,188 @@
+/*
+  ==============================================================================
+
+    PcmDiskCache.cpp
+    Created: 17 Oct 2026 2:31:47pm
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "PcmDiskCache.h"
+
+namespace {
+  /* Keeps a mapping open for as long as a buffer refers into it */
+  struct MappedTrack {
+    std::unique_ptr<MemoryMappedFile> mapping;
+    AudioBuffer<float> audio;
+  };
+
+  /* Rounds a number of samples up to a whole number of pages */
+  int64 roundUpToPage(int64 numSamples, int pageSize) {
+    auto samplesPerPage = (int64) (pageSize / sizeof(float));
+    return ((numSamples + samplesPerPage - 1) / samplesPerPage) * samplesPerPage;
+  }
+}
+
+//==============================================================================
+PcmDiskCache::PcmDiskCache(const File& directory)
+                         : cacheDirectory(directory != File() ? directory
+                                                              : File::getSpecialLocation(File::userApplicationDataDirectory)
+                                                                  .getChildFile("audioMix").getChildFile("PCM Cache"),
+                                          ".pcm",
+                                          (int64) 20 * 1024 * 1024 * 1024) // 20 GB
+{
+  formatManager.registerBasicFormats();
+
+  weakThis = this;
+}
+
+PcmDiskCache::~PcmDiskCache() {
+  transcoderPool.removeAllJobs(true, 30000);
+}
+
+/* Memory-map the cached PCM of a track */
+std::shared_ptr<const AudioBuffer<float>> PcmDiskCache::openTrack(const File& file, double& sampleRate) {
+  auto cacheFile = cacheDirectory.getFileFor(file);
+
+  if (!cacheFile.existsAsFile())
+    return nullptr;
+
+  auto track = std::make_shared<MappedTrack>();
+  track->mapping.reset(new MemoryMappedFile(cacheFile, MemoryMappedFile::readOnly));
+
+  auto* data = static_cast<const char*>(track->mapping->getData());
+  auto mappedSize = (int64) track->mapping->getSize();
+
+  if (data == nullptr || mappedSize < pageSize)
+    return nullptr;
+
+  Header header;
+  std::memcpy(&header, data, sizeof(Header));
+
+  // reject anything that doesn't match the source file exactly, or was cut short
+  if (std::memcmp(header.magic, "AMPC", 4) != 0
+        || header.version != currentVersion
+        || header.numChannels == 0
+        || header.numSamples > std::numeric_limits<int>::max()
+        || header.sourceSize != file.getSize()
+        || header.sourceModTime != file.getLastModificationTime().toMilliseconds()
+        || mappedSize < pageSize + header.channelStride * (int64) sizeof(float) * header.numChannels)
+    return nullptr;
+
+  // point a buffer at each channel of the mapping - nothing is copied.
+  // AudioBuffer wants non-const pointers, but it is only ever handed out as const
+  HeapBlock<float*> channels(header.numChannels);
+
+  for (uint32 chan = 0; chan < header.numChannels; ++chan)
+    channels[chan] = const_cast<float*>(reinterpret_cast<const float*>(data + pageSize)) + chan * header.channelStride;
+
+  track->audio = AudioBuffer<float>(channels.get(), (int) header.numChannels, (int) header.numSamples);
+  sampleRate = header.sampleRate;
+
+  cacheDirectory.markUsed(cacheFile);
+
+  return std::shared_ptr<const AudioBuffer<float>>(track, &track->audio);
+}
+
+/* Transcode a track into the cache on the background thread */
+void PcmDiskCache::requestTranscode(const File& file) {
+  if (!file.existsAsFile() || cacheDirectory.getFileFor(file).existsAsFile())
+    return;
+
+  {
+    const ScopedLock sl(lock);
+    auto key = file.getFullPathName();
+
+    if (pendingTranscodes.contains(key))
+      return;
+
+    pendingTranscodes.add(key);
+  }
+
+  transcoderPool.addJob([this, file] {
+    transcode(file);
+
+    const ScopedLock sl(lock);
+    pendingTranscodes.removeString(file.getFullPathName());
+  });
+}
+
+/* Set the maximum total size of the cache directory */
+void PcmDiskCache::setMaxCacheSize(int64 bytes) {
+  cacheDirectory.setMaxSize(bytes);
+}
+
+/* Get the directory the cache files are stored in */
+File PcmDiskCache::getCacheDirectory() const {
+  return cacheDirectory.getDirectory();
+}
+
+void PcmDiskCache::addListener(Listener* listener) {
+  listeners.add(listener);
+}
+
+void PcmDiskCache::removeListener(Listener* listener) {
+  listeners.remove(listener);
+}
+
+/* Decode a track into a new cache file (transcoder thread) */
+void PcmDiskCache::transcode(const File& file) {
+  std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+  if (reader == nullptr || reader->numChannels == 0)
+    return;
+
+  Header header;
+  std::memcpy(header.magic, "AMPC", 4);
+  header.version = currentVersion;
+  header.numChannels = reader->numChannels;
+  header.reserved = 0;
+  header.sampleRate = reader->sampleRate;
+  header.numSamples = reader->lengthInSamples;
+  header.channelStride = roundUpToPage(reader->lengthInSamples, pageSize);
+  header.sourceSize = file.getSize();
+  header.sourceModTime = file.getLastModificationTime().toMilliseconds();
+
+  auto written = cacheDirectory.writeEntry(cacheDirectory.getFileFor(file), [&](FileOutputStream& out) {
+    HeapBlock<char> firstPage(pageSize, true);
+    std::memcpy(firstPage.get(), &header, sizeof(Header));
+    out.write(firstPage.get(), pageSize);
+
+    // decode in chunks and write each channel into its own block of the file
+    constexpr int chunkSize = 65536;
+    AudioBuffer<float> chunk((int) header.numChannels, chunkSize);
+
+    for (int64 pos = 0; pos < header.numSamples; pos += chunkSize) {
+      auto numSamples = (int) jmin((int64) chunkSize, header.numSamples - pos);
+      reader->read(&chunk, 0, numSamples, pos, true, true);
+
+      for (uint32 chan = 0; chan < header.numChannels; ++chan) {
+        out.setPosition(pageSize + (chan * header.channelStride + pos) * (int64) sizeof(float));
+        out.write(chunk.getReadPointer((int) chan), (size_t) numSamples * sizeof(float));
+      }
+    }
+
+    // pad the last channel out to a whole page
+    if (header.channelStride > header.numSamples) {
+      out.setPosition(pageSize + header.channelStride * header.numChannels * (int64) sizeof(float) - 1);
+      out.writeByte(0);
+    }
+
+    return true;
+  });
+
+  if (!written)
+    return;
+
+  DBG("PcmDiskCache::transcode " << file.getFullPathName() << " cached");
+
+  cacheDirectory.evictIfNeeded();
+
+  // tell the listeners on the message thread (if the cache still exists by then)
+  MessageManager::callAsync([weakThis = weakThis, file] {
+    if (auto* cache = weakThis.get())
+      cache->listeners.call([&file](Listener& l) { l.trackTranscoded(file); });
+  });
+}
+
@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    PcmDiskCache.h
+    Created: 17 Oct 2026 2:31:47pm
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CacheDirectory.h"
+
+//==============================================================================
+/*
+    A cache directory of tracks transcoded to raw float PCM, for tracks too
+    long to keep decoded in memory. The first load of a track that the
+    DecodedTrackCache won't hold transcodes it in the background; later loads
+    memory-map the cache file and play straight from the mapping, so there is
+    no decoding and seeking is O(1).
+
+    Each cache file starts with a one-page header followed by one page-aligned
+    block of samples per channel. Entries are keyed by the source file's path,
+    size and modification time, and the least recently used entries are deleted
+    once the directory grows past its size cap.
+
+    Use it through a SharedResourcePointer<PcmDiskCache>.
+*/
+class PcmDiskCache {
+public:
+  /**
+   * \brief
+   *    Receives a callback (on the message thread) whenever a track has finished transcoding.
+   */
+  class Listener {
+  public:
+    virtual ~Listener() = default;
+
+    /**
+     * \brief
+     *    Called on the message thread when a track has been transcoded into the cache.
+     *
+     * \param file
+     *    The file that can now be opened with openTrack()
+     */
+    virtual void trackTranscoded(const File& file) = 0;
+  };
+
+  /**
+   * \brief
+   *    Constructor.
+   *
+   * \param directory
+   *    Where to keep the cache files, or File() for a "PCM Cache" folder in the application data directory
+   */
+  PcmDiskCache(const File& directory = File());
+
+  /**
+   * \brief
+   *    Destructor. Waits for any transcode in progress.
+   */
+  ~PcmDiskCache();
+
+  /**
+   * \brief
+   *    Memory-map the cached PCM of a track.
+   *
+   * \param file
+   *    The source audio file
+   * \param sampleRate
+   *    Set to the sample rate of the track if it is cached
+   *
+   * \return
+   *    A buffer that refers directly to the mapped samples (and keeps the mapping open),
+   *    or nullptr if the file isn't cached or has changed since it was transcoded
+   */
+  std::shared_ptr<const AudioBuffer<float>> openTrack(const File& file, double& sampleRate);
+
+  /**
+   * \brief
+   *    Transcode a track into the cache on the background thread, if it isn't cached already.
+   *
+   * \param file
+   *    The source audio file
+   */
+  void requestTranscode(const File& file);
+
+  /**
+   * \brief
+   *    Set the maximum total size of the cache directory.
+   *
+   * \param bytes
+   *    The size cap in bytes
+   */
+  void setMaxCacheSize(int64 bytes);
+
+  /**
+   * \brief
+   *    Get the directory the cache files are stored in.
+   */
+  File getCacheDirectory() const;
+
+  void addListener(Listener* listener);
+  void removeListener(Listener* listener);
+
+private:
+  /**
+   * \brief
+   *    The first page of every cache file.
+   */
+  struct Header {
+    char magic[4];
+    uint32 version;
+    uint32 numChannels;
+    uint32 reserved;
+    double sampleRate;
+    int64 numSamples;
+    int64 channelStride;    // samples between the start of two channels (a whole number of pages)
+    int64 sourceSize;
+    int64 sourceModTime;    // milliseconds since the epoch
+  };
+
+  static constexpr uint32 currentVersion = 1;
+  static constexpr int pageSize = 4096;
+
+  /**
+   * \brief
+   *    Decode a track into a new cache file. Runs on the transcoder thread.
+   */
+  void transcode(const File& file);
+
+  CacheDirectory cacheDirectory;
+  AudioFormatManager formatManager;
+
+  CriticalSection lock;
+  StringArray pendingTranscodes;
+
+  ListenerList<Listener> listeners;
+
+  // copied by the transcoder thread to call back on the message thread. Made once in the constructor,
+  // because the first WeakReference to an object creates its shared pointer without a lock
+  WeakReference<PcmDiskCache> weakThis;
+
+  // transcodes one track at a time (declared last so that it is destroyed first)
+  ThreadPool transcoderPool{ 1 };
+
+  JUCE_DECLARE_WEAK_REFERENCEABLE(PcmDiskCache)
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PcmDiskCache)
+};
@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+    PerformanceComponent.cpp
+    Created: 22 Oct 2026 3:12:08pm
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "PerformanceComponent.h"
+
+//==============================================================================
+PerformanceComponent::PerformanceComponent(AudioCallbackStats& _masterStats,
+                                           DJAudioPlayer* _player1, DJAudioPlayer* _player2,
+                                           const WaveformDisplay& _waveform1, const WaveformDisplay& _waveform2,
+                                           PerformanceLogger& _logger)
+                                         : masterStats(_masterStats),
+                                           player1(_player1),
+                                           player2(_player2),
+                                           waveform1(_waveform1),
+                                           waveform2(_waveform2),
+                                           logger(_logger)
+{
+  addAndMakeVisible(resetButton);
+  addAndMakeVisible(logButton);
+
+  resetButton.addListener(this);
+  logButton.addListener(this);
+
+  logButton.setClickingTogglesState(true);
+  logButton.setToggleState(logger.isLogging(), dontSendNotification);
+  logButton.setTooltip(logger.getLogFile().getFullPathName());
+
+  setSize(720, 420);
+
+  timerCallback();
+  startTimerHz(4);
+}
+
+PerformanceComponent::~PerformanceComponent() {
+  stopTimer();
+}
+
+/* Drawing of the component */
+void PerformanceComponent::paint(Graphics& g) {
+  g.fillAll(Colour{ 0xff000000 });
+
+  auto area = getLocalBounds().reduced(8);
+  area.removeFromBottom(32);
+
+  auto sectionWidth = area.getWidth() / 3;
+
+  drawSection(g, area.removeFromLeft(sectionWidth).reduced(4), "Master", masterSnapshot, -1, nullptr);
+  drawSection(g, area.removeFromLeft(sectionWidth).reduced(4), "Deck 1", deck1Snapshot, player1->getBufferUnderruns(), &deck1Paint);
+  drawSection(g, area.reduced(4), "Deck 2", deck2Snapshot, player2->getBufferUnderruns(), &deck2Paint);
+}
+
+/* Sets the size of each object in the component */
+void PerformanceComponent::resized() {
+  auto buttons = getLocalBounds().reduced(8).removeFromBottom(28);
+
+  resetButton.setBounds(buttons.removeFromLeft(100));
+  buttons.removeFromLeft(8);
+  logButton.setBounds(buttons.removeFromLeft(120));
+}
+
+/* Implement Button::Listener */
+void PerformanceComponent::buttonClicked(Button* button) {
+  if (button == &resetButton) {
+    masterStats.reset();
+    player1->getCallbackStats().reset();
+    player2->getCallbackStats().reset();
+  }
+
+  if (button == &logButton)
+    logger.setLogging(logButton.getToggleState());
+}
+
+/* Takes new snapshots and repaints */
+void PerformanceComponent::timerCallback() {
+  masterSnapshot = masterStats.getSnapshot();
+  deck1Snapshot = player1->getCallbackStats().getSnapshot();
+  deck2Snapshot = player2->getCallbackStats().getSnapshot();
+  deck1Paint = waveform1.getPaintStats();
+  deck2Paint = waveform2.getPaintStats();
+
+  repaint();
+}
+
+/* Draw one section of statistics */
+void PerformanceComponent::drawSection(Graphics& g, Rectangle<int> area, const String& title,
+                                       const AudioCallbackStats::Snapshot& snapshot, int underruns,
+                                       const WaveformDisplay::PaintStats* paintStats) {
+  const int lineHeight = 16;
+
+  g.setColour(Colours::white);
+  g.setFont(15.0f);
+  g.drawText(title, area.removeFromTop(lineHeight + 4), Justification::centredLeft);
+
+  g.setFont(13.0f);
+
+  auto drawLine = [&](const String& name, const String& value) {
+    auto line = area.removeFromTop(lineHeight);
+    g.drawText(name, line, Justification::centredLeft);
+    g.drawText(value, line, Justification::centredRight);
+  };
+
+  drawLine("Budget used", String(snapshot.budgetUsedPercent, 1) + "% (peak " + String(snapshot.peakBudgetUsedPercent, 1) + "%)");
+
+  for (int i = 0; i < snapshot.stageNames.size(); ++i)
+    drawLine("  " + snapshot.stageNames[i],
+             String(snapshot.stageMicros[(size_t) i], 1) + " us (peak " + String(snapshot.stagePeakMicros[(size_t) i], 0) + ")");
+
+  drawLine("Callbacks", String((int64) snapshot.callbacks));
+  drawLine("Deadline misses", String(snapshot.deadlineMisses));
+  drawLine("Late callbacks", String(snapshot.lateCallbacks));
+
+  if (snapshot.deviceXruns >= 0)
+    drawLine("Device xruns", String(snapshot.deviceXruns));
+
+  if (underruns >= 0)
+    drawLine("Read-ahead underruns", String(underruns));
+
+  if (paintStats != nullptr) {
+    drawLine("Waveform paint", String(paintStats->paintMicros, 1) + " us (" + String(paintStats->paints) + " paints)");
+    drawLine("  layer redraw", String(paintStats->layerMicros, 1) + " us (" + String(paintStats->layerRenders) + " redraws)");
+  }
+
+  // histogram of the share of the budget used, the last bar is over budget
+  area.removeFromTop(8);
+  auto chart = area.removeFromTop(jmin(area.getHeight(), 100));
+
+  g.setColour(Colours::darkgrey);
+  g.drawRect(chart);
+
+  uint32 largest = 1;
+
+  for (auto count : snapshot.histogram)
+    largest = jmax(largest, count);
+
+  auto barWidth = (float) chart.getWidth() / (float) AudioCallbackStats::numHistogramBins;
+
+  for (int i = 0; i < AudioCallbackStats::numHistogramBins; ++i) {
+    auto height = (float) chart.getHeight() * (float) snapshot.histogram[(size_t) i] / (float) largest;
+
+    g.setColour(i == AudioCallbackStats::numHistogramBins - 1 ? Colours::red : Colour(0xff8e6ac0));
+    g.fillRect((float) chart.getX() + i * barWidth + 1.0f, (float) chart.getBottom() - height,
+               barWidth - 2.0f, height);
+  }
+
+  g.setColour(Colours::white);
+  g.setFont(11.0f);
+  g.drawText("0%", chart.withTrimmedTop(chart.getHeight() - 12), Justification::bottomLeft);
+  g.drawText(">100%", chart.withTrimmedTop(chart.getHeight() - 12), Justification::bottomRight);
+}
@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    PerformanceComponent.h
+    Created: 22 Oct 2026 3:12:08pm
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "AudioCallbackStats.h"
+#include "DJAudioPlayer.h"
+#include "PerformanceLogger.h"
+#include "WaveformDisplay.h"
+
+//==============================================================================
+/*
+    Shows the audio callback timing of the master output and of each deck:
+    time per stage, share of the block budget, a histogram of that share,
+    deadline misses, late callbacks, device xruns and read-ahead underruns,
+    and how long each deck's waveform takes to paint on the message thread.
+    It only takes snapshots, so having it open costs the audio thread nothing.
+*/
+class PerformanceComponent : public Component,
+                             public Button::Listener,
+                             public Timer
+{
+public:
+  /**
+   * \brief
+   *    Constructor.
+   *
+   * \param _masterStats
+   *    Timing of the master output callback
+   * \param _player1
+   *    Pointer to the left deck's player
+   * \param _player2
+   *    Pointer to the right deck's player
+   * \param _waveform1
+   *    The left deck's waveform
+   * \param _waveform2
+   *    The right deck's waveform
+   * \param _logger
+   *    The logger the "Log to file" button starts and stops
+   */
+  PerformanceComponent(AudioCallbackStats& _masterStats,
+                       DJAudioPlayer* _player1, DJAudioPlayer* _player2,
+                       const WaveformDisplay& _waveform1, const WaveformDisplay& _waveform2,
+                       PerformanceLogger& _logger);
+
+  /**
+   * \brief
+   *    Destructor.
+   */
+  ~PerformanceComponent() override;
+
+  /**
+   * \brief
+   *    Drawing of the component.
+   *
+   * \param g
+   *    Graphic reference used to do carry out drawing operations
+   */
+  void paint(Graphics& g) override;
+
+  /**
+   * \brief
+   *    Sets the size of each object in the component.
+   */
+  void resized() override;
+
+  /**
+   * \brief
+   *    Implement Button::Listener.
+   *
+   * \param button
+   *    Pointer to the button that was clicked
+   */
+  void buttonClicked(Button* button) override;
+
+  /**
+   * \brief
+   *    Takes new snapshots and repaints.
+   */
+  void timerCallback() override;
+
+private:
+  /**
+   * \brief
+   *    Draw one section of statistics.
+   *
+   * \param g
+   *    Graphic reference used to do carry out drawing operations
+   * \param area
+   *    The area to draw in
+   * \param title
+   *    Heading of the section
+   * \param snapshot
+   *    The statistics to draw
+   * \param underruns
+   *    Read-ahead underruns to show, or -1 to leave them out
+   * \param paintStats
+   *    Waveform paint times to show, or nullptr to leave them out
+   */
+  void drawSection(Graphics& g, Rectangle<int> area, const String& title,
+                   const AudioCallbackStats::Snapshot& snapshot, int underruns,
+                   const WaveformDisplay::PaintStats* paintStats);
+
+  AudioCallbackStats& masterStats;
+  DJAudioPlayer* player1;
+  DJAudioPlayer* player2;
+  const WaveformDisplay& waveform1;
+  const WaveformDisplay& waveform2;
+  PerformanceLogger& logger;
+
+  AudioCallbackStats::Snapshot masterSnapshot;
+  AudioCallbackStats::Snapshot deck1Snapshot;
+  AudioCallbackStats::Snapshot deck2Snapshot;
+  WaveformDisplay::PaintStats deck1Paint;
+  WaveformDisplay::PaintStats deck2Paint;
+
+  TextButton resetButton{ "Reset" };
+  TextButton logButton{ "Log to file" };
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PerformanceComponent)
+};
@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    PerformanceLogger.cpp
+    Created: 22 Oct 2026 2:05:37pm
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "PerformanceLogger.h"
+
+//==============================================================================
+PerformanceLogger::PerformanceLogger(const File& _logFile)
+                                   : Thread("Performance logger"),
+                                     logFile(_logFile)
+{
+}
+
+PerformanceLogger::~PerformanceLogger() {
+  stopThread(2000);
+}
+
+/* Add statistics to every line of the log */
+void PerformanceLogger::addSource(const String& name, AudioCallbackStats& stats) {
+  jassert(!isThreadRunning());
+  sources.emplace_back(name, &stats);
+}
+
+/* Start or stop writing to the log */
+void PerformanceLogger::setLogging(bool shouldLog) {
+  if (shouldLog)
+    startThread();
+  else
+    stopThread(2000);
+}
+
+/* Checks whether the log is being written */
+bool PerformanceLogger::isLogging() const {
+  return isThreadRunning();
+}
+
+/* Get the file the log is written to */
+File PerformanceLogger::getLogFile() const {
+  return logFile;
+}
+
+/* Append a line to the log once a second until told to stop */
+void PerformanceLogger::run() {
+  logFile.getParentDirectory().createDirectory();
+
+  FileOutputStream out(logFile);
+
+  if (out.failedToOpen()) {
+    DBG("PerformanceLogger::run - can't open " << logFile.getFullPathName());
+    return;
+  }
+
+  while (!threadShouldExit()) {
+    auto* line = new DynamicObject();
+    line->setProperty("time", Time::getCurrentTime().toISO8601(true));
+
+    for (auto& source : sources)
+      line->setProperty(source.first, source.second->getSnapshot().toJSON());
+
+    out << JSON::toString(var(line), true) << newLine;
+    out.flush();
+
+    wait(intervalMs);
+  }
+}
@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    PerformanceLogger.h
+    Created: 22 Oct 2026 2:05:37pm
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "AudioCallbackStats.h"
+
+//==============================================================================
+/*
+    A background thread that appends a snapshot of the audio callback
+    statistics to a log file once a second, one JSON object per line. It only
+    reads the statistics' atomics, so it never holds up the audio thread.
+*/
+class PerformanceLogger : private Thread {
+public:
+  /**
+   * \brief
+   *    Constructor.
+   *
+   * \param _logFile
+   *    The file to append to
+   */
+  PerformanceLogger(const File& _logFile);
+
+  /**
+   * \brief
+   *    Destructor. Stops logging.
+   */
+  ~PerformanceLogger() override;
+
+  /**
+   * \brief
+   *    Add statistics to every line of the log. Call before logging starts.
+   *
+   * \param name
+   *    The key the statistics are logged under
+   * \param stats
+   *    The statistics (not owned)
+   */
+  void addSource(const String& name, AudioCallbackStats& stats);
+
+  /**
+   * \brief
+   *    Start or stop writing to the log.
+   */
+  void setLogging(bool shouldLog);
+
+  /**
+   * \brief
+   *    Checks whether the log is being written.
+   */
+  bool isLogging() const;
+
+  /**
+   * \brief
+   *    Get the file the log is written to.
+   */
+  File getLogFile() const;
+
+private:
+  /**
+   * \brief
+   *    Append a line to the log once a second until told to stop.
+   */
+  void run() override;
+
+  static constexpr int intervalMs = 1000;
+
+  const File logFile;
+  std::vector<std::pair<String, AudioCallbackStats*>> sources;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PerformanceLogger)
+};
@@ -36,7 +36,9 @@ PlaylistComponent::PlaylistComponent(DeckGUI* _deckGUI1,
 
   // set the header of the TableListBox
   tableComponent.getHeader().addColumn("Track Title", 1, 250);
-  tableComponent.getHeader().addColumn("Length", 2, 150);
+  tableComponent.getHeader().addColumn("Length", 2, 90);
+  tableComponent.getHeader().addColumn("BPM", 6, 60);
+  tableComponent.getHeader().addColumn("Waveform", 7, 120);
   tableComponent.getHeader().addColumn("PLAY IN", 3, 75);
   tableComponent.getHeader().addColumn("PLAY IN", 4, 75);
   tableComponent.getHeader().addColumn("", 5, 40);
@@ -64,11 +66,19 @@ PlaylistComponent::PlaylistComponent(DeckGUI* _deckGUI1,
     search(searchBox.getText());
   };
 
+  trackAnalyser->addListener(this);
+  waveformCache->addListener(this);
+  libraryScanner.addListener(this);
+
   // call function to restore library
   addSavedLibrary();
 }
 
 PlaylistComponent::~PlaylistComponent() {
+  trackAnalyser->removeListener(this);
+  waveformCache->removeListener(this);
+  libraryScanner.removeListener(this);
+
   // save tracks that are currently in the library whenever desctructor is called
   saveLibrary();
 }
@@ -91,7 +101,7 @@ void PlaylistComponent::paint(juce::Graphics& g) {
 
   // display number of tracks added
   if (searchBox.isEmpty()) {
-    g.drawText(String{ trackInfo.size() } + " TRACKS ADDED",
+    g.drawText(String{ trackStore->size() } + " TRACKS ADDED" + scanStatus,
                searchBox.getRight() + 20, 5, (getWidth() / 3) - 50, getHeight() / 10,
                Justification::centredLeft,
                true);
@@ -121,8 +131,8 @@ void PlaylistComponent::resized() {
 /* Counts the number of items in the TableListBox */
 int PlaylistComponent::getNumRows() { 
   repaint();
-  // return size of trackInfo vector if empty, searchResult vector otherwise
-  return searchBox.isEmpty() ? trackInfo.size() : searchResult.size();
+  // return size of the library if empty, searchResult vector otherwise
+  return searchBox.isEmpty() ? trackStore->size() : (int) searchResult.size();
 }
 
 /* Set the background color of the TableListBox */
@@ -142,21 +152,44 @@ void PlaylistComponent::paintCell(Graphics& g, int rowNumber, int columnId, int
   g.setColour(Colour(0xFFFFFFFF)); // set colour of text when drawn
   
   if (rowNumber < getNumRows()) {
+    // the library's own track, whether the row shows the library or a search result
+    auto& track = getTrackForRow(rowNumber);
+
     if (columnId == 1) { // display track titles
-      if (searchBox.isEmpty()) {
-         g.drawText(trackInfo[rowNumber].trackTitle, 2, 0, width - 4, height, Justification::centredLeft, true);
-      }
-      else { // display seach results if search box is not empty
-        g.drawText(searchResult[rowNumber].trackTitle, 2, 0, width - 4, height, Justification::centredLeft, true);
-      } 
+      g.drawText(track.trackTitle, 2, 0, width - 4, height, Justification::centredLeft, true);
     }
 
     if (columnId == 2) { // display track lengths
-      if (searchBox.isEmpty()) {
-        g.drawText(trackInfo[rowNumber].trackLength, 2, 0, width - 4, height, Justification::centredLeft, true);
+      // lengths are filled in as the library scanner reads them
+      g.drawText(track.hasLength() ? String{ track.trackLength } : "...", 2, 0, width - 4, height, Justification::centredLeft, true);
+    }
+
+    if (columnId == 6) { // display track tempos
+      TrackAnalyser::BeatGrid grid;
+
+      if (trackAnalyser->getBeatGrid(track.file, grid)) {
+        g.drawText(grid.bpm > 0 ? String(grid.bpm, 1) : "-", 2, 0, width - 4, height, Justification::centredLeft, true);
+      }
+      else { // rows on screen are analysed before the rest of the library
+        trackAnalyser->requestAnalysis(track.file, TrackAnalyser::Priority::visible);
+        g.drawText("...", 2, 0, width - 4, height, Justification::centredLeft, true);
       }
-      else { // display seach results if search box is not empty
-        g.drawText(searchResult[rowNumber].trackLength, 2, 0, width - 4, height, Justification::centredLeft, true);
+    }
+
+    if (columnId == 7) { // display track waveforms, for tracks that have been drawn on a deck before
+      auto overview = waveformCache->getOverview(track.file);
+
+      if (overview != nullptr && width > 2) {
+        auto numPixels = width - 2;
+        auto centre = height * 0.5f;
+
+        overviewPeaks.resize((size_t) numPixels);
+        overview->getPeaks(0, 0.0, (double) overview->getLengthInSamples(), overviewPeaks.data(), numPixels);
+
+        g.setColour(Colour(0xffA8F9FF));
+
+        for (int px = 0; px < numPixels; ++px)
+          g.drawVerticalLine(1 + px, centre - overviewPeaks[(size_t) px].max * centre, centre - overviewPeaks[(size_t) px].min * centre + 1.0f);
       }
     }
   }
@@ -228,10 +261,15 @@ void PlaylistComponent::buttonClicked(Button* button) {
     // if at least 1 row is selected
     if (tableComponent.getNumSelectedRows() > 0) {
       int selectedRow = tableComponent.getSelectedRow(); // get id of selected row
+      auto& track = getTrackForRow(selectedRow);
 
-      // add the file of the selected row into queuedTracks vector
-      queueComponent->queuedTracks.push_back(trackInfo[selectedRow].file);
+      // add the ID of the selected row's track into queuedTracks vector
+      queueComponent->queuedTracks.push_back(track.id);
       queueComponent->queueTable.updateContent();
+
+      // decode it ahead of time so that it loads from memory when its turn comes
+      trackCache->requestDecode(track.file);
+      trackAnalyser->requestAnalysis(track.file, TrackAnalyser::Priority::queued);
     }
   }
 
@@ -242,47 +280,18 @@ void PlaylistComponent::buttonClicked(Button* button) {
     // load track into Deck 1 player if "DECK 1" button is pressed
     if (button->getButtonText() == "DECK 1") {
       DBG("PlaylistComponent::buttonClicked DECK 1 button clicked");
-
-      if (searchBox.isEmpty()) {
-        deckGUI1->player->loadURL(URL{ trackInfo[id].file });
-        deckGUI1->waveformdisplay.loadURL(URL{ trackInfo[id].file });
-        deckGUI1->waveformdisplay.setPositionRelative(deckGUI1->player->getPositionRelative());
-
-        deckGUI1->setNameAndLength(File{ URL(URL{ trackInfo[id].file }).getLocalFile() });
-      }
-      else {
-        deckGUI1->player->loadURL(URL{ searchResult[id].file });
-        deckGUI1->waveformdisplay.loadURL(URL{ searchResult[id].file });
-        deckGUI1->waveformdisplay.setPositionRelative(deckGUI1->player->getPositionRelative());
-
-        deckGUI1->setNameAndLength(File{ URL(URL{ searchResult[id].file }).getLocalFile() });
-      }
-
+      deckGUI1->loadTrack(URL{ getTrackForRow(id).file });
     }
 
     // load track into Deck 2 player if "DECK 2" button is pressed
     if (button->getButtonText() == "DECK 2") {
       DBG("PlaylistComponent::buttonClicked DECK 2 button clicked");
-
-      if (searchBox.isEmpty()) {
-        deckGUI2->player->loadURL(URL{ trackInfo[id].file });
-        deckGUI2->waveformdisplay.loadURL(URL{ trackInfo[id].file });
-        deckGUI2->waveformdisplay.setPositionRelative(deckGUI2->player->getPositionRelative());
-
-        deckGUI2->setNameAndLength(File{ URL{ trackInfo[id].file }.getLocalFile() });
-      }
-      else {
-        deckGUI2->player->loadURL(URL{ searchResult[id].file });
-        deckGUI2->waveformdisplay.loadURL(URL{ searchResult[id].file });
-        deckGUI2->waveformdisplay.setPositionRelative(deckGUI2->player->getPositionRelative());
-
-        deckGUI2->setNameAndLength(File{ URL{ searchResult[id].file }.getLocalFile() });
-      }
+      deckGUI2->loadTrack(URL{ getTrackForRow(id).file });
     }
 
     // remove the selected track from library if the "X" button is pressed
     if (button->getButtonText() == "X") {
-      if (!trackInfo.empty())
+      if (!trackStore->isEmpty())
         removeTrack(id);
     }
   }
@@ -295,21 +304,13 @@ void PlaylistComponent::addToLibrary() {
 
   // able to select one or multiple files
   if (chooser.browseForMultipleFilesToOpen()) {
-    for (File& file : chooser.getResults()) {
-      
-      bool exists = false; // true = track exists, false = track does not exist
-
-      // compare name of chosen file with the names stored in trackTitle to determine if it already exists
-      if (!trackInfo.empty()) {
-        for (TrackInfo& track : trackInfo) {
-          if (track.file == file) 
-            exists = true;
-        }
-      }
+    Array<File> newFiles;
 
-      // add file into trackInfo if the file does not already exist
-      if (!exists) {
-        trackInfo.push_back(file);
+    for (File& file : chooser.getResults()) {
+      // add file into the library if it does not already exist (the store looks it up by path)
+      if (trackStore->add(file) != 0) {
+        newFiles.add(file);
+        trackAnalyser->requestAnalysis(file);
       }
 
       // display message box if track name already exists in library
@@ -324,6 +325,9 @@ void PlaylistComponent::addToLibrary() {
       // refresh the list to update it with the newly added row
       tableComponent.updateContent();
     }
+
+    // the lengths are filled in as they are read
+    libraryScanner.scan(newFiles);
   }
 }
 
@@ -334,24 +338,16 @@ bool PlaylistComponent::isInterestedInFileDrag(const StringArray&) {
 
 /* Processing of the files dropped onto this component */
 void PlaylistComponent::filesDropped(const StringArray& files, int, int) {
+  Array<File> newFiles;
+
   // one or more files droppped
   for (String file : files) {
     File droppedFile{ file };
 
-    // track does not exist = false, already exists = true
-    bool exists = false;
-
-    // compare name of chosen file with the names stored in trackTitle to determine if it already exists
-    if (!trackInfo.empty()) {
-      for (TrackInfo& line : trackInfo) {
-        if (line.file == droppedFile)
-          exists = true;
-      }
-    }
-
-    // add track name and length into respective vectors if track does not already exist
-    if (!exists) {
-      trackInfo.push_back(droppedFile);
+    // add the track into the library if it does not already exist (the store looks it up by path)
+    if (trackStore->add(droppedFile) != 0) {
+      newFiles.add(droppedFile);
+      trackAnalyser->requestAnalysis(droppedFile);
     }
 
     // diisplay message box if track name already exists in library
@@ -366,28 +362,19 @@ void PlaylistComponent::filesDropped(const StringArray& files, int, int) {
 
   // refresh the list to update with the new rows
   tableComponent.updateContent();
+  libraryScanner.scan(newFiles);
 }
 
 /* Remove the track that matches the id passed in */
 void PlaylistComponent::removeTrack(int id) {
-  // pop_back if it is the last item in the vector
-  // otherwise, remove item from the vector at index of [id]
-  if (searchBox.isEmpty()) {
-    id == trackInfo.size() ? trackInfo.pop_back() : trackInfo.erase(trackInfo.begin() + id);
-  }
+  trackStore->remove({ getTrackForRow(id).id });
 
-  // if searchbox is not empty, remove the track from both searchResult and trackInfo vector
-  else {
-    auto i = 0;
-    for (TrackInfo& title : trackInfo) {
-      if (title.trackTitle == searchResult[id].trackTitle) {
-        i == trackInfo.size() ? trackInfo.pop_back() : trackInfo.erase(trackInfo.begin() + i);
-      } 
-      i++;
-    }
-    id == searchResult.size() ? searchResult.pop_back() : searchResult.erase(searchResult.begin() + id);
-  }
+  // if searchbox is not empty, remove the track from searchResult as well
+  if (!searchBox.isEmpty())
+    searchResult.erase(searchResult.begin() + id);
 
+  // the queue drops the track too
+  queueComponent->removeMissingTracks();
   tableComponent.updateContent();
 }
 
@@ -395,24 +382,19 @@ void PlaylistComponent::removeTrack(int id) {
 void PlaylistComponent::removeAllTracks() {
   // if the search box is empty
   if (searchBox.isEmpty()) {
-    // clear the trackInfo vector to remove all items
-    if (!trackInfo.empty()) {
-      trackInfo.clear();
+    // clear the library to remove all items
+    if (!trackStore->isEmpty()) {
+      trackStore->clear();
+      queueComponent->removeMissingTracks();
       tableComponent.updateContent();
     }
   }
   else {
-    // if library is displaying search results
+    // if library is displaying search results, delete all of them from the library
     if (!searchResult.empty()) {
-      for (TrackInfo& result : searchResult) {
-        // delete all the tracks in searchResult from the trackInfo vector
-        for (int i = 0; i < trackInfo.size(); i++) {
-          if (result.trackTitle == trackInfo[i].trackTitle) {
-            i == trackInfo.size() ? trackInfo.pop_back() : trackInfo.erase(trackInfo.begin() + i);
-          }
-        }
-      }
+      trackStore->remove(searchResult);
       searchResult.clear();
+      queueComponent->removeMissingTracks();
       tableComponent.updateContent();
     }
   }
@@ -423,43 +405,95 @@ void PlaylistComponent::search(String keyword) {
   // clear vector before adding new search results
   searchResult.clear();
 
-  // compare keyword to track titles of all added tracks to find matches
-  if (keyword.isNotEmpty()) {
-    for (TrackInfo& track : trackInfo) {
-      if (String{ track.trackTitle }.containsIgnoreCase(keyword)) {
-        searchResult.push_back(track.file);
-      }
-    }
-  }
+  // the store's index finds the matching titles (narrowing the last results as more is typed)
+  if (keyword.isNotEmpty())
+    searchResult = trackStore->search(keyword);
+
   tableComponent.updateContent();
 }
 
-/* Persist the library by storing the file path in a .txt file */
+/* Persist the library by storing the path, length and beat grid of each track in the library index */
 void PlaylistComponent::saveLibrary() {
-  // create a .txt file to store information of tracks added into library 
-  std::ofstream playlist("library.txt");
+  std::vector<LibraryIndex::Entry> entries;
+  entries.reserve((size_t) trackStore->size());
+
+  for (TrackInfo& track : *trackStore) {
+    LibraryIndex::Entry entry;
+    entry.file = track.file;
+
+    // a track that hasn't been read yet is saved without its details, so it is read on the next start
+    if (track.hasLength()) {
+      entry.fileSize = track.fileSize;
+      entry.modificationTime = track.modificationTime;
+      entry.lengthInSeconds = track.lengthInSeconds;
+    }
 
-  // store the full file path into the .txt file
-  for (TrackInfo& track : trackInfo) {
-    playlist << track.file.getFullPathName() << '\n';
+    entry.hasBeatGrid = trackAnalyser->getBeatGrid(track.file, entry.beatGrid);
+    entries.push_back(entry);
   }
+
+  if (!libraryIndex.save(entries))
+    DBG("PlaylistComponent::saveLibrary - can't write " << libraryIndex.getFile().getFullPathName());
 }
 
-/* Loads track by reading from the .txt file created in saveLibrary() function */
+/* Loads tracks from the library index created in saveLibrary() function */
 void PlaylistComponent::addSavedLibrary() {
-  // open the .txt file containing saved tracks
+  std::vector<LibraryIndex::Entry> entries;
+
+  // the rows appear straight away, and only tracks that have changed since are read again
+  if (libraryIndex.load(entries)) {
+    std::vector<LibraryScanner::Result> savedFiles;
+    savedFiles.reserve(entries.size());
+    trackStore->reserve((int) entries.size());
+
+    for (auto& entry : entries) {
+      auto* track = trackStore->getTrack(trackStore->add(entry.file));
+
+      if (track == nullptr)
+        continue;
+
+      LibraryScanner::Result saved;
+      saved.file = entry.file;
+
+      if (entry.lengthInSeconds >= 0) {
+        track->setLength(entry.lengthInSeconds);
+        track->fileSize = saved.fileSize = entry.fileSize;
+        track->modificationTime = saved.modificationTime = entry.modificationTime;
+      }
+
+      // a saved beat grid saves opening the track's analysis result
+      if (entry.hasBeatGrid)
+        trackAnalyser->addKnownResult(entry.file, entry.beatGrid);
+
+      savedFiles.push_back(saved);
+      trackAnalyser->requestAnalysis(entry.file);
+    }
+
+    tableComponent.updateContent();
+    libraryScanner.scan(savedFiles);
+    return;
+  }
+
+  // no index yet: restore the .txt file of older versions, whose tracks all have to be read
   std::ifstream library{ "library.txt" };
+  Array<File> savedFiles;
 
   if (library.is_open()) {
     std::string line;
 
     while (getline(library, line, '\n')) {
       File file { line };
-      trackInfo.push_back(file);
+
+      if (trackStore->add(file) != 0) {
+        savedFiles.add(file);
+        trackAnalyser->requestAnalysis(file);
+      }
     }
   }
 
   tableComponent.updateContent();
+  libraryScanner.scan(savedFiles);
+
   // close the .txt file
   library.close();
 }
@@ -469,9 +503,65 @@ var PlaylistComponent::getDragSourceDescription(const SparseSet<int>& selectedRo
   String details;
 
   // return the URL of the row that is dragged (in String)
-  // use trackInfo vector if searchBox is empty and searchResult vector otherwise
-  URL row = searchBox.isEmpty() ? URL{ trackInfo[selectedRow[0]].file } : URL{ searchResult[selectedRow[0]].file };
+  URL row{ getTrackForRow(selectedRow[0]).file };
   details << row.toString(false) << " ";
 
   return details;
 }
+
+/* Get the track shown in a row, from the library or the search results */
+TrackInfo& PlaylistComponent::getTrackForRow(int rowNumber) {
+  if (searchBox.isEmpty())
+    return trackStore->getTrackAt(rowNumber);
+
+  // removing a track from the library removes it from the search results too, so it is always found
+  auto* track = trackStore->getTrack(searchResult[(size_t) rowNumber]);
+  jassert(track != nullptr);
+
+  return *track;
+}
+
+/* Shows the tempo of a track once it has been analysed */
+void PlaylistComponent::trackAnalysed(const File&) {
+  tableComponent.repaint();
+}
+
+/* Draws the waveform of a track once its overview has been read */
+void PlaylistComponent::overviewAvailable(const File&) {
+  tableComponent.repaint();
+}
+
+/* Fills in the lengths of a batch of tracks once they have been read (or read again, if they changed) */
+void PlaylistComponent::tracksScanned(const std::vector<LibraryScanner::Result>& results) {
+  for (auto& result : results) {
+    // search results and the queue refer to the same track, so they see the length too
+    auto* track = trackStore->getTrack(trackStore->getId(result.file));
+
+    // removed while it was being read
+    if (track == nullptr)
+      continue;
+
+    // a saved track that has changed since is analysed again
+    if (track->fileSize >= 0) {
+      trackAnalyser->forgetResult(track->file);
+      trackAnalyser->requestAnalysis(track->file);
+    }
+
+    track->setLength(result.isReadable ? result.lengthInSeconds : 0.0);
+    track->fileSize = result.fileSize;
+    track->modificationTime = result.modificationTime;
+  }
+
+  int numDone = 0, numTotal = 0;
+  libraryScanner.getProgress(numDone, numTotal);
+  scanStatus = " (SCANNING " + String(numDone) + "/" + String(numTotal) + ")";
+
+  tableComponent.repaint();
+  repaint();
+}
+
+/* Shows how long it took to read the library */
+void PlaylistComponent::scanFinished(int, double seconds) {
+  scanStatus = " (SCANNED IN " + String(seconds, 1) + " S)";
+  repaint();
+}
@@ -15,8 +15,14 @@
 #include <string>
 #include <fstream>
 #include "TrackInfo.h"
+#include "TrackStore.h"
 #include "DeckGUI.h"
 #include "QueueComponent.h"
+#include "DecodedTrackCache.h"
+#include "TrackAnalyser.h"
+#include "LibraryScanner.h"
+#include "WaveformCache.h"
+#include "LibraryIndex.h"
 
 
 //==============================================================================
@@ -27,7 +33,10 @@ class PlaylistComponent : public Component,
                           public Button::Listener,
                           public FileDragAndDropTarget,
                           public TextEditor::Listener,
-                          public DragAndDropContainer
+                          public DragAndDropContainer,
+                          public TrackAnalyser::Listener,
+                          public LibraryScanner::Listener,
+                          public WaveformCache::Listener
 {
 public:
   /**
@@ -194,15 +203,15 @@ public:
 
   /**
    * \brief
-   *    Persist the library by storing storing the file path of all tracks added into the library in a .txt file.
-   *    This function is called in the destructor.
+   *    Persist the library by storing the path, length and beat grid of all tracks added into the library
+   *    in the LibraryIndex. This function is called in the destructor.
    */
   void saveLibrary();
 
   /**
    * \brief
-   *    Loads all track infomation by reading from the .txt file created in saveLibrary() function.
-   *    This function is called in the constructor.
+   *    Loads all track infomation from the LibraryIndex written by the saveLibrary() function (or from the
+   *    library.txt of older versions). This function is called in the constructor.
    */
   void addSavedLibrary();
 
@@ -218,17 +227,60 @@ public:
    */
   var getDragSourceDescription(const SparseSet<int>& selectedRow);
 
+  /**
+   * \brief
+   *    Shows the tempo of a track once it has been analysed.
+   *
+   * \param file
+   *    The track that was analysed
+   */
+  void trackAnalysed(const File& file) override;
+
+  /**
+   * \brief
+   *    Draws the waveform of a track once its overview has been read.
+   *
+   * \param file
+   *    The track whose overview is available
+   */
+  void overviewAvailable(const File& file) override;
+
+  /**
+   * \brief
+   *    Fills in the lengths of a batch of tracks once they have been read.
+   *
+   * \param results
+   *    The tracks that were read
+   */
+  void tracksScanned(const std::vector<LibraryScanner::Result>& results) override;
+
+  /**
+   * \brief
+   *    Shows how long it took to read the library.
+   *
+   * \param numFiles
+   *    Number of tracks read
+   * \param seconds
+   *    Time taken to read them
+   */
+  void scanFinished(int numFiles, double seconds) override;
+
 
 private:
+  /**
+   * \brief
+   *    Get the track shown in a row, from the library or the search results.
+   */
+  TrackInfo& getTrackForRow(int rowNumber);
 
   // TableListBox displaying track information
   TableListBox tableComponent;
 
-  // vector for storing and retrieving track information
-  std::vector<TrackInfo> trackInfo;
+  // the tracks in the library, in order
+  SharedResourcePointer<TrackStore> trackStore;
 
-  // vector for storing tracks matching search keyword
-  std::vector<TrackInfo> searchResult;
+  // IDs of the tracks matching search keyword
+  std::vector<TrackStore::TrackId> searchResult;
 
   // button to load tracks into the playlist component
   ImageButton loadToLibrary;
@@ -250,5 +302,24 @@ private:
  
   QueueComponent* queueComponent;
 
+  // used to decode queued tracks ahead of time
+  SharedResourcePointer<DecodedTrackCache> trackCache;
+
+  // works out the tempo of every track in the library
+  SharedResourcePointer<TrackAnalyser> trackAnalyser;
+
+  // overviews of the tracks' waveforms, and the peaks of the row being drawn
+  SharedResourcePointer<WaveformCache> waveformCache;
+  std::vector<WaveformPyramid::Range> overviewPeaks;
+
+  // reads the length of added tracks in the background
+  LibraryScanner libraryScanner;
+
+  // the saved library
+  LibraryIndex libraryIndex;
+
+  // progress or duration of the last library scan, shown next to the track count
+  String scanStatus;
+
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlaylistComponent)
 };
@@ -0,0 +1,352 @@
+/*
+  ==============================================================================
+
+    PolyphaseResampler.cpp
+    Created: 18 Oct 2026 10:05:33am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "PolyphaseResampler.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <xmmintrin.h>
+#elif JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+#endif
+
+namespace {
+  constexpr int maxHalfTapsPerTier = 32; // the mastering tier
+
+  /* Zeroth-order modified Bessel function, for the Kaiser window */
+  double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+
+    for (int k = 1; k < 32; ++k) {
+      term *= (x / (2.0 * k)) * (x / (2.0 * k));
+      sum += term;
+
+      if (term < sum * 1.0e-12)
+        break;
+    }
+
+    return sum;
+  }
+
+  /* Dot product of two float arrays whose length is a multiple of 4 */
+  inline float dotProduct(const float* a, const float* b, int num) noexcept {
+   #if JUCE_USE_SSE_INTRINSICS
+    auto acc = _mm_setzero_ps();
+
+    for (int i = 0; i < num; i += 4)
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+   #elif JUCE_USE_ARM_NEON
+    auto acc = vdupq_n_f32(0.0f);
+
+    for (int i = 0; i < num; i += 4)
+      acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+
+    auto pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    return vget_lane_f32(vpadd_f32(pair, pair), 0);
+   #else
+    // four independent sums so that the compiler can keep them in one vector register
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+
+    for (int i = 0; i < num; i += 4) {
+      s0 += a[i] * b[i];
+      s1 += a[i + 1] * b[i + 1];
+      s2 += a[i + 2] * b[i + 2];
+      s3 += a[i + 3] * b[i + 3];
+    }
+
+    return (s0 + s1) + (s2 + s3);
+   #endif
+  }
+}
+
+//==============================================================================
+PolyphaseResampler::PolyphaseResampler(AudioSource* _input, int _numChannels)
+                                     : input(_input),
+                                       numChannels(_numChannels),
+                                       numBuffered(0),
+                                       readPos(0),
+                                       stride(0),
+                                       effectiveHalfTaps(0),
+                                       builtNumPhases(0),
+                                       builtScale(0),
+                                       builtQuality(Quality::normal),
+                                       deviceSampleRate(44100.0)
+{
+  jassert(input != nullptr);
+
+  // room for the longest rows of the largest tier, plus padding up to a multiple of 4
+  auto maxStride = 2 * maxHalfTapsPerTier * maxScaleFactor + 4;
+  auto maxRows = getPrototype(Quality::mastering).numPhases + 1;
+  coefficients.allocate((size_t) (maxStride * maxRows), true);
+
+  rebuildCoefficients(quality.load(), 1.0f);
+}
+
+PolyphaseResampler::~PolyphaseResampler() {
+}
+
+/* Allocate the input history for the largest block that can be requested */
+void PolyphaseResampler::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+  deviceSampleRate = sampleRate;
+
+  auto maxHalfTaps = maxHalfTapsPerTier * maxScaleFactor;
+  auto capacity = 2 * maxHalfTaps + getMaxInputBlockSize(samplesPerBlockExpected);
+
+  inputBuffer.setSize(numChannels, capacity);
+  positions.allocate((size_t) jmax(1, samplesPerBlockExpected), true);
+  resetState();
+
+  smoothedSpeed.reset(sampleRate, 0.05);
+  smoothedSpeed.setCurrentAndTargetValue(speed.load());
+
+  // the input runs at the file's sample rate, not the device's
+  input->prepareToPlay(getMaxInputBlockSize(samplesPerBlockExpected), sourceSampleRate.load());
+}
+
+/* Free the input history */
+void PolyphaseResampler::releaseResources() {
+  input->releaseResources();
+  inputBuffer.setSize(numChannels, 0);
+}
+
+/* Pull audio from the input and resample it into the destination buffer */
+void PolyphaseResampler::getNextAudioBlock(const AudioSourceChannelInfo& info) {
+  auto startTicks = Time::getHighResolutionTicks();
+
+  if (inputBuffer.getNumSamples() == 0) {
+    info.clearActiveBufferRegion();
+    return;
+  }
+
+  if (resetRequested.exchange(false))
+    resetState();
+
+  // one fused ratio for the sample rate conversion and the speed, the speed part ramping per sample
+  auto rateRatio = sourceSampleRate.load() / deviceSampleRate;
+  smoothedSpeed.setTargetValue(speed.load());
+
+  // when downsampling, lower the cutoff to stop the input aliasing (quantised so that
+  // small speed changes don't rebuild the rows every block). Sized for the faster end of a ramp
+  auto ratio = jlimit(0.01, maxRatio, rateRatio * jmax(smoothedSpeed.getCurrentValue(), smoothedSpeed.getTargetValue()));
+  auto scale = ratio > 1.0 ? jmax(1.0f / maxScaleFactor, (float) (1.0 / ratio)) : 1.0f;
+  scale = std::ceil(scale * 32.0f) / 32.0f;
+
+  auto currentQuality = quality.load();
+
+  if (currentQuality != builtQuality || scale != builtScale)
+    rebuildCoefficients(currentQuality, scale);
+
+  auto maxHalfTaps = maxHalfTapsPerTier * maxScaleFactor;
+  auto maxChunk = jmax(1, (inputBuffer.getNumSamples() - 2 * maxHalfTaps - 8) / (int) std::ceil(maxRatio));
+  auto numTaps = stride;
+
+  for (int done = 0; done < info.numSamples;) {
+    auto numOut = jmin(maxChunk, info.numSamples - done);
+
+    // work out where each output sample reads from once, for all channels
+    auto nextPos = readPos;
+
+    for (int i = 0; i < numOut; ++i) {
+      positions[i] = nextPos;
+      nextPos += jlimit(0.01, maxRatio, rateRatio * smoothedSpeed.getNextValue());
+    }
+
+    // pull just enough input to compute this chunk
+    auto lastBase = (int) positions[numOut - 1];
+    auto needed = jmin(lastBase + effectiveHalfTaps + 1, inputBuffer.getNumSamples());
+
+    if (needed > numBuffered) {
+      AudioSourceChannelInfo in(&inputBuffer, numBuffered, needed - numBuffered);
+      input->getNextAudioBlock(in);
+      numBuffered = needed;
+    }
+
+    for (int chan = 0; chan < jmin(numChannels, info.buffer->getNumChannels()); ++chan) {
+      auto* src = inputBuffer.getReadPointer(chan);
+      auto* dest = info.buffer->getWritePointer(chan, info.startSample + done);
+
+      for (int i = 0; i < numOut; ++i) {
+        auto pos = positions[i];
+        auto base = (int) pos;
+        auto phase = (pos - base) * builtNumPhases;
+        auto row = (int) phase;
+        auto rowFrac = (float) (phase - row);
+
+        auto* taps = src + base - effectiveHalfTaps + 1;
+        auto* row0 = coefficients.get() + row * stride;
+
+        // interpolate between the two nearest phases
+        auto y0 = dotProduct(taps, row0, numTaps);
+        auto y1 = dotProduct(taps, row0 + stride, numTaps);
+        dest[i] = y0 + rowFrac * (y1 - y0);
+      }
+    }
+
+    readPos = nextPos;
+    done += numOut;
+
+    // keep the longest possible history in front of the read position and drop the rest
+    auto consumed = (int) readPos - (maxHalfTaps - 1);
+
+    if (consumed > 0) {
+      auto remaining = numBuffered - consumed;
+
+      for (int chan = 0; chan < numChannels; ++chan) {
+        auto* data = inputBuffer.getWritePointer(chan);
+        std::memmove(data, data + consumed, (size_t) remaining * sizeof(float));
+      }
+
+      numBuffered = remaining;
+      readPos -= consumed;
+    }
+  }
+
+  for (int chan = numChannels; chan < info.buffer->getNumChannels(); ++chan)
+    info.buffer->clear(chan, info.startSample, info.numSamples);
+
+  // share of the block's time budget, smoothed over the last few blocks
+  auto elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+  auto budget = info.numSamples / deviceSampleRate;
+
+  if (budget > 0)
+    cpuLoad = cpuLoad.load() * 0.9 + (elapsed / budget) * 0.1;
+}
+
+/* Set the sample rate of the input */
+void PolyphaseResampler::setSourceSampleRate(double newSourceSampleRate) {
+  if (newSourceSampleRate > 0)
+    sourceSampleRate = newSourceSampleRate;
+}
+
+/* Set the speed ratio applied on top of the sample rate conversion */
+void PolyphaseResampler::setSpeed(double newSpeed) {
+  speed = jmax(0.01, newSpeed);
+}
+
+/* Set the filter quality */
+void PolyphaseResampler::setQuality(Quality newQuality) {
+  quality = newQuality;
+}
+
+/* Get the current filter quality */
+PolyphaseResampler::Quality PolyphaseResampler::getQuality() const {
+  return quality.load();
+}
+
+/* Throw away the input history at the start of the next block */
+void PolyphaseResampler::reset() {
+  resetRequested = true;
+}
+
+/* Get the share of the callback's time budget used by this resampler */
+double PolyphaseResampler::getCpuLoad() const {
+  return cpuLoad.load();
+}
+
+/* Get the number of taps each output sample is computed from */
+int PolyphaseResampler::getNumTaps(Quality quality) {
+  return 2 * getPrototype(quality).halfTaps;
+}
+
+/* Get the largest number of input samples pulled for one output block */
+int PolyphaseResampler::getMaxInputBlockSize(int outputBlockSize) {
+  return (int) std::ceil(outputBlockSize * maxRatio) + 8;
+}
+
+/* Build (once) the sampled kernel of a quality tier */
+const PolyphaseResampler::Prototype& PolyphaseResampler::getPrototype(Quality quality) {
+  // half taps, phases, Kaiser beta, cutoff (relative to Nyquist)
+  struct Design { int halfTaps; int numPhases; double beta; double cutoff; };
+
+  static const auto build = [](Design d) {
+    Prototype p;
+    p.halfTaps = d.halfTaps;
+    p.numPhases = d.numPhases;
+    p.samplesPerZeroCrossing = 512;
+
+    auto size = d.halfTaps * p.samplesPerZeroCrossing + 2;
+    p.table.resize((size_t) size);
+
+    for (int i = 0; i < size; ++i) {
+      auto x = (double) i / p.samplesPerZeroCrossing;
+      auto r = x / d.halfTaps;
+
+      auto sinc = x == 0 ? 1.0 : std::sin(MathConstants<double>::pi * d.cutoff * x) / (MathConstants<double>::pi * d.cutoff * x);
+      auto window = r < 1.0 ? besselI0(d.beta * std::sqrt(1.0 - r * r)) / besselI0(d.beta) : 0.0;
+
+      p.table[(size_t) i] = (float) (d.cutoff * sinc * window);
+    }
+
+    return p;
+  };
+
+  static const Prototype draft = build({ 4, 64, 5.0, 0.90 });
+  static const Prototype normal = build({ 8, 256, 7.0, 0.94 });
+  static const Prototype mastering = build({ maxHalfTapsPerTier, 256, 10.0, 0.97 });
+
+  switch (quality) {
+    case Quality::draft: return draft;
+    case Quality::mastering: return mastering;
+    case Quality::normal:
+    default: return normal;
+  }
+}
+
+/* Recompute the coefficient rows for the current quality and anti-aliasing scale */
+void PolyphaseResampler::rebuildCoefficients(Quality newQuality, float scale) {
+  auto& proto = getPrototype(newQuality);
+
+  effectiveHalfTaps = (int) std::ceil(proto.halfTaps / scale);
+  auto numTaps = 2 * effectiveHalfTaps;
+  stride = (numTaps + 3) & ~3;
+  builtNumPhases = proto.numPhases;
+
+  auto tableSize = (int) proto.table.size();
+
+  for (int p = 0; p <= builtNumPhases; ++p) {
+    auto frac = (float) p / builtNumPhases;
+    auto* row = coefficients.get() + p * stride;
+    float sum = 0;
+
+    for (int k = 0; k < numTaps; ++k) {
+      // distance from the output position to tap k, in (scaled) input samples
+      auto x = std::abs((frac + effectiveHalfTaps - 1 - k) * scale) * proto.samplesPerZeroCrossing;
+      auto index = (int) x;
+
+      row[k] = index + 1 < tableSize
+             ? proto.table[(size_t) index] + (x - index) * (proto.table[(size_t) index + 1] - proto.table[(size_t) index])
+             : 0.0f;
+
+      sum += row[k];
+    }
+
+    // normalise each phase to unity gain at DC
+    if (sum != 0)
+      FloatVectorOperations::multiply(row, 1.0f / sum, numTaps);
+
+    for (int k = numTaps; k < stride; ++k)
+      row[k] = 0;
+  }
+
+  builtQuality = newQuality;
+  builtScale = scale;
+}
+
+/* Clear the input history and place the read position just past the filter's history */
+void PolyphaseResampler::resetState() {
+  inputBuffer.clear();
+
+  auto maxHalfTaps = maxHalfTapsPerTier * maxScaleFactor;
+  numBuffered = maxHalfTaps - 1;
+  readPos = maxHalfTaps - 1;
+}
@@ -0,0 +1,205 @@
+/*
+  ==============================================================================
+
+    PolyphaseResampler.h
+    Created: 18 Oct 2026 10:05:33am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    A windowed-sinc polyphase resampler that converts a deck from the file's
+    sample rate to the device's and applies the speed ratio in the same pass,
+    so each deck is only resampled once.
+
+    The input source is pulled at the file's sample rate. The coefficient rows
+    are preallocated for the highest quality tier, so changing the quality or
+    the speed never allocates on the audio thread.
+*/
+class PolyphaseResampler : public AudioSource {
+public:
+  /**
+   * \brief
+   *    Quality tiers, trading filter length (and CPU) for stop-band rejection.
+   */
+  enum class Quality {
+    draft,     // 8 taps, 64 phases
+    normal,    // 16 taps, 256 phases
+    mastering  // 64 taps, 256 phases
+  };
+
+  /**
+   * \brief
+   *    Constructor.
+   *
+   * \param _input
+   *    The source to resample (not owned)
+   * \param _numChannels
+   *    Number of channels to process
+   */
+  PolyphaseResampler(AudioSource* _input, int _numChannels = 2);
+
+  /**
+   * \brief
+   *    Destructor.
+   */
+  ~PolyphaseResampler() override;
+
+  /**
+   * \brief
+   *    Allocate the input history for the largest block that can be requested.
+   *
+   * \param samplesPerBlockExpected
+   *    Number of samples to be supplied by the source
+   * \param sampleRate
+   *    The device sample rate
+   */
+  void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+
+  /**
+   * \brief
+   *    Free the input history.
+   */
+  void releaseResources() override;
+
+  /**
+   * \brief
+   *    Pull audio from the input and resample it into the destination buffer.
+   *
+   * \param bufferToFill
+   *    The destination buffer to fill with audio data
+   */
+  void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+  /**
+   * \brief
+   *    Set the sample rate of the input (i.e. of the loaded file).
+   */
+  void setSourceSampleRate(double newSourceSampleRate);
+
+  /**
+   * \brief
+   *    Set the speed ratio applied on top of the sample rate conversion.
+   *    The audio thread ramps to it sample by sample over about 50 ms.
+   *
+   * \param newSpeed
+   *    The speed ratio (1.0 = normal)
+   */
+  void setSpeed(double newSpeed);
+
+  /**
+   * \brief
+   *    Set the filter quality. Takes effect at the start of the next block.
+   */
+  void setQuality(Quality newQuality);
+
+  /**
+   * \brief
+   *    Get the current filter quality.
+   */
+  Quality getQuality() const;
+
+  /**
+   * \brief
+   *    Throw away the input history at the start of the next block (e.g. after a seek).
+   */
+  void reset();
+
+  /**
+   * \brief
+   *    Get the share of the audio callback's time budget this resampler is using,
+   *    smoothed over the last few blocks. Dividing 1 by it gives a rough number of decks
+   *    that can run at the current quality on one core.
+   *
+   * \return
+   *    The CPU load between 0 and 1
+   */
+  double getCpuLoad() const;
+
+  /**
+   * \brief
+   *    Get the number of taps each output sample is computed from, for a quality tier.
+   */
+  static int getNumTaps(Quality quality);
+
+  /**
+   * \brief
+   *    Get the largest number of input samples pulled for one output block.
+   *    The input source is prepared with this block size.
+   *
+   * \param outputBlockSize
+   *    The block size the resampler itself was prepared with
+   */
+  static int getMaxInputBlockSize(int outputBlockSize);
+
+private:
+  /**
+   * \brief
+   *    A windowed-sinc kernel sampled finely over its positive half, built once per tier.
+   */
+  struct Prototype {
+    int halfTaps = 0;
+    int numPhases = 0;
+    int samplesPerZeroCrossing = 0;
+    std::vector<float> table;
+  };
+
+  static const Prototype& getPrototype(Quality quality);
+
+  /**
+   * \brief
+   *    Recompute the coefficient rows for the current quality and anti-aliasing scale.
+   *    Runs on the audio thread and never allocates.
+   */
+  void rebuildCoefficients(Quality quality, float scale);
+
+  /**
+   * \brief
+   *    Clear the input history and place the read position just past the filter's history.
+   */
+  void resetState();
+
+  // downsampling by more than this still works but starts to alias
+  static constexpr int maxScaleFactor = 4;
+
+  // the largest ratio (file rate / device rate x speed) handled in one go
+  static constexpr double maxRatio = 8.0;
+
+  AudioSource* input;
+  const int numChannels;
+
+  // input samples waiting to be resampled, starting with the filter's history
+  AudioBuffer<float> inputBuffer;
+  int numBuffered;
+  double readPos;
+
+  // the read position of each output sample in the current chunk (the ratio can change per sample)
+  HeapBlock<double> positions;
+
+  // (numPhases + 1) rows of `stride` coefficients, so that row p + 1 is always valid
+  HeapBlock<float> coefficients;
+  int stride;
+  int effectiveHalfTaps;
+  int builtNumPhases;
+  float builtScale;
+  Quality builtQuality;
+
+  std::atomic<Quality> quality{ Quality::normal };
+  std::atomic<double> sourceSampleRate{ 44100.0 };
+  std::atomic<double> speed{ 1.0 };
+  std::atomic<bool> resetRequested{ false };
+
+  // the speed actually applied, ramped towards `speed` on the audio thread
+  SmoothedValue<double> smoothedSpeed{ 1.0 };
+
+  double deviceSampleRate;
+  std::atomic<double> cpuLoad{ 0 };
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PolyphaseResampler)
+};
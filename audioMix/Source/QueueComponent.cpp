@@ -70,7 +70,8 @@ void QueueComponent::paintRowBackground(Graphics& g, int rowNumber, int width, i
 void QueueComponent::paintCell(Graphics& g, int rowNumber, int columnId, int width, int height, bool rowIsSelected) {
   if (rowNumber < getNumRows()) {
     if (columnId == 1) {
-      g.drawText(queuedTracks[rowNumber].trackTitle, 2, 0, width - 4, height, Justification::centredLeft, true);
+      if (auto* track = trackStore->getTrack(queuedTracks[rowNumber]))
+        g.drawText(track->trackTitle, 2, 0, width - 4, height, Justification::centredLeft, true);
     }
   }
 }
@@ -120,3 +121,23 @@ void QueueComponent::buttonClicked(Button* button) {
   }
 }
 
+/* Get the file of a queued track */
+File QueueComponent::getQueuedFile(int index) {
+  if (index < 0 || index >= (int) queuedTracks.size())
+    return {};
+
+  auto* track = trackStore->getTrack(queuedTracks[(size_t) index]);
+  return track != nullptr ? track->file : File();
+}
+
+/* Take tracks that have been removed from the library off the queue */
+void QueueComponent::removeMissingTracks() {
+  auto numQueued = queuedTracks.size();
+
+  queuedTracks.erase(std::remove_if(queuedTracks.begin(), queuedTracks.end(), [this](TrackStore::TrackId id) {
+    return trackStore->getTrack(id) == nullptr;
+  }), queuedTracks.end());
+
+  if (queuedTracks.size() != numQueued)
+    queueTable.updateContent();
+}
@@ -12,6 +12,7 @@
 
 #include <JuceHeader.h>
 #include "TrackInfo.h"
+#include "TrackStore.h"
 
 //==============================================================================
 /*
@@ -130,12 +131,33 @@ public:
      */
     void buttonClicked(Button* button) override;
 
+    /**
+     * \brief
+     *    Get the file of a queued track.
+     *
+     * \param index
+     *    Position of the track in the queue
+     *
+     * \return
+     *    The track's file, or File() if there is no such track
+     */
+    File getQueuedFile(int index);
+
+    /**
+     * \brief
+     *    Take tracks that have been removed from the library off the queue.
+     */
+    void removeMissingTracks();
+
 private:
   // TableListBox displaying songs added to queue
   TableListBox queueTable;
 
-  // vector storing information of queued tracks
-  std::vector<TrackInfo> queuedTracks;
+  // IDs of the queued tracks in the library's TrackStore
+  std::vector<TrackStore::TrackId> queuedTracks;
+
+  // the tracks in the library
+  SharedResourcePointer<TrackStore> trackStore;
 
   // button to clear the queue
   TextButton clearQueue{ "Clear Queue" };
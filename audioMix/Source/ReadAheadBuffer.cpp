@@ -0,0 +1,353 @@
+/*
+  ==============================================================================
+
+    ReadAheadBuffer.cpp
+    Created: 17 Oct 2026 9:14:05am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "ReadAheadBuffer.h"
+
+ReadAheadBuffer::ReadAheadBuffer(PositionableAudioSource* _source,
+                                 bool deleteSourceWhenDeleted,
+                                 ReadAheadScheduler& _scheduler,
+                                 int numChannels,
+                                 double _sourceSampleRate)
+                               : source(_source, deleteSourceWhenDeleted),
+                                 scheduler(_scheduler),
+                                 numberOfChannels(numChannels),
+                                 sourceSampleRate(_sourceSampleRate > 0 ? _sourceSampleRate : 44100.0),
+                                 isPrepared(false)
+{
+  jassert(source != nullptr);
+}
+
+ReadAheadBuffer::~ReadAheadBuffer() {
+  releaseResources();
+}
+
+/* Allocate the ring buffer and register with the scheduler */
+void ReadAheadBuffer::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+  auto bufferSizeNeeded = jmax(samplesPerBlockExpected * 2,
+                               roundToInt(scheduler.getReadAheadSeconds() * sourceSampleRate));
+
+  if (isPrepared && buffer.getNumSamples() == bufferSizeNeeded)
+    return;
+
+  // make sure no worker is writing into the buffer while it is resized
+  scheduler.removeBuffer(this);
+
+  source->prepareToPlay(samplesPerBlockExpected, sampleRate);
+  buffer.setSize(numberOfChannels, bufferSizeNeeded);
+  buffer.clear();
+
+  {
+    const SpinLock::ScopedLockType sl(bufferRangeLock);
+    bufferValidStart = 0;
+    bufferValidEnd = 0;
+  }
+
+  isPrepared = true;
+  scheduler.addBuffer(this);
+}
+
+/* Unregister from the scheduler and free the ring buffer */
+void ReadAheadBuffer::releaseResources() {
+  scheduler.removeBuffer(this);
+  isPrepared = false;
+
+  buffer.setSize(numberOfChannels, 0);
+  source->releaseResources();
+}
+
+/* Copy already decoded samples into the destination buffer */
+void ReadAheadBuffer::getNextAudioBlock(const AudioSourceChannelInfo& info) {
+  // the whole track is in memory, so read it directly
+  if (auto* decoded = decodedAudio.load()) {
+    auto pos = nextPlayPos.load();
+    auto numAvailable = (int) jlimit((int64) 0, (int64) info.numSamples, decoded->getNumSamples() - pos);
+
+    if (pos < 0 || numAvailable <= 0) {
+      info.clearActiveBufferRegion();
+    }
+    else {
+      for (int chan = jmin(numberOfChannels, info.buffer->getNumChannels()); --chan >= 0;)
+        info.buffer->copyFrom(chan, info.startSample,
+                              *decoded, jmin(chan, decoded->getNumChannels() - 1), (int) pos,
+                              numAvailable);
+
+      if (numAvailable < info.numSamples)
+        info.buffer->clear(info.startSample + numAvailable, info.numSamples - numAvailable);
+    }
+
+    nextPlayPos = pos + info.numSamples;
+    return;
+  }
+
+  const SpinLock::ScopedLockType sl(bufferRangeLock);
+
+  auto validStart = bufferValidStart.load();
+  auto validEnd = bufferValidEnd.load();
+  auto pos = nextPlayPos.load();
+
+  // the part of the requested block that has been decoded, relative to pos
+  auto validStartInBlock = (int) (jlimit(validStart, validEnd, pos) - pos);
+  auto validEndInBlock = (int) (jlimit(validStart, validEnd, pos + info.numSamples) - pos);
+
+  if (validStartInBlock == validEndInBlock) {
+    info.clearActiveBufferRegion();
+
+    if (isPrepared && pos < source->getTotalLength())
+      ++underruns;
+  }
+  else {
+    if (validStartInBlock > 0)
+      info.buffer->clear(info.startSample, validStartInBlock);
+
+    if (validEndInBlock < info.numSamples) {
+      info.buffer->clear(info.startSample + validEndInBlock, info.numSamples - validEndInBlock);
+
+      if (pos + info.numSamples < source->getTotalLength())
+        ++underruns;
+    }
+
+    auto bufferSize = buffer.getNumSamples();
+    auto startInRing = (int) ((pos + validStartInBlock) % bufferSize);
+    auto numToCopy = validEndInBlock - validStartInBlock;
+
+    // copy in up to two sections to handle the wrap-around of the ring
+    auto firstSection = jmin(numToCopy, bufferSize - startInRing);
+    auto secondSection = numToCopy - firstSection;
+
+    for (int chan = jmin(numberOfChannels, info.buffer->getNumChannels()); --chan >= 0;) {
+      info.buffer->copyFrom(chan, info.startSample + validStartInBlock, buffer, chan, startInRing, firstSection);
+
+      if (secondSection > 0)
+        info.buffer->copyFrom(chan, info.startSample + validStartInBlock + firstSection, buffer, chan, 0, secondSection);
+    }
+  }
+
+  nextPlayPos = pos + info.numSamples;
+}
+
+/* Move the playhead (the workers refill from here on their next slice) */
+void ReadAheadBuffer::setNextReadPosition(int64 newPosition) {
+  nextPlayPos = newPosition;
+}
+
+int64 ReadAheadBuffer::getNextReadPosition() const {
+  return nextPlayPos.load();
+}
+
+int64 ReadAheadBuffer::getTotalLength() const {
+  return source->getTotalLength();
+}
+
+bool ReadAheadBuffer::isLooping() const {
+  return source->isLooping();
+}
+
+/* Tell the buffer whether its deck is playing and how fast */
+void ReadAheadBuffer::setPlaybackState(bool isPlaying, double speedRatio) {
+  playing = isPlaying;
+  playbackSpeed = jmax(0.01, speedRatio);
+}
+
+/* Decode the first chunk on the calling thread */
+void ReadAheadBuffer::prime() {
+  // a worker may already have picked it up, in which case there's nothing left to do
+  if (isPrepared && tryStartServicing()) {
+    if (needsMoreData())
+      readNextChunk();
+
+    finishedServicing();
+  }
+}
+
+/* Play from a fully decoded copy of the source from now on */
+void ReadAheadBuffer::setDecodedAudio(std::shared_ptr<const AudioBuffer<float>> audio, bool isMemoryMapped) {
+  if (decodedAudioOwner != nullptr || audio == nullptr)
+    return;
+
+  // keep it alive for as long as this buffer exists, then let the audio thread see it
+  decodedAudioOwner = std::move(audio);
+  decodedAudioIsMapped = isMemoryMapped;
+  decodedAudio = decodedAudioOwner.get();
+}
+
+/* Amount of decoded audio ahead of the playhead, in seconds */
+double ReadAheadBuffer::getBufferedSeconds() const {
+  auto pos = nextPlayPos.load();
+
+  if (auto* decoded = decodedAudio.load())
+    return (double) jmax((int64) 0, decoded->getNumSamples() - pos) / sourceSampleRate;
+
+  if (pos < bufferValidStart.load())
+    return 0;
+
+  return (double) jmax((int64) 0, bufferValidEnd.load() - pos) / sourceSampleRate;
+}
+
+/* Fill level relative to the size of the ring buffer */
+double ReadAheadBuffer::getFillLevel() const {
+  if (decodedAudio.load() != nullptr)
+    return 1.0;
+
+  if (buffer.getNumSamples() == 0)
+    return 0;
+
+  return jlimit(0.0, 1.0, getBufferedSeconds() * sourceSampleRate / buffer.getNumSamples());
+}
+
+/* How long the deck can keep playing before it runs out of decoded audio */
+double ReadAheadBuffer::getSecondsUntilStarved() const {
+  auto realTimeLeft = getBufferedSeconds() / playbackSpeed.load();
+
+  // a stopped deck can't starve, but should still be filled once the playing decks are safe
+  return playing.load() ? realTimeLeft : realTimeLeft + 3600.0;
+}
+
+/* Number of blocks that could not be filled completely */
+int ReadAheadBuffer::getUnderrunCount() const {
+  return underruns.load();
+}
+
+/* Checks whether there is room for more audio and audio left to decode */
+bool ReadAheadBuffer::needsMoreData() const {
+  if (!isPrepared)
+    return false;
+
+  // fully decoded audio only needs its pages touched, and only if it is memory-mapped
+  if (auto* decoded = decodedAudio.load()) {
+    if (!decodedAudioIsMapped)
+      return false;
+
+    auto pos = jmax((int64) 0, nextPlayPos.load());
+    auto wantedEnd = jmin(pos + buffer.getNumSamples(), (int64) decoded->getNumSamples());
+
+    return pos < touchedFrom.load() || touchedUpTo.load() < wantedEnd;
+  }
+
+  auto pos = jmax((int64) 0, nextPlayPos.load());
+  auto validStart = bufferValidStart.load();
+  auto validEnd = bufferValidEnd.load();
+
+  // the playhead was moved outside of what has been decoded
+  if (pos < validStart || pos >= validEnd)
+    return pos < source->getTotalLength();
+
+  auto wantedEnd = jmin(pos + buffer.getNumSamples() - 4, source->getTotalLength());
+  return validEnd < wantedEnd;
+}
+
+/* Decode the next chunk from the source into the ring buffer */
+bool ReadAheadBuffer::readNextChunk() {
+  if (decodedAudio.load() != nullptr)
+    return decodedAudioIsMapped && touchMappedPages();
+
+  int64 newBVS, newBVE, sectionToReadStart, sectionToReadEnd;
+
+  {
+    const SpinLock::ScopedLockType sl(bufferRangeLock);
+
+    newBVS = jmax((int64) 0, nextPlayPos.load());
+    newBVE = newBVS + buffer.getNumSamples() - 4;
+    sectionToReadStart = 0;
+    sectionToReadEnd = 0;
+
+    if (newBVS < bufferValidStart || newBVS >= bufferValidEnd) {
+      // the playhead jumped: start again from the new position
+      newBVE = jmin(newBVE, newBVS + maxChunkSize);
+
+      sectionToReadStart = newBVS;
+      sectionToReadEnd = newBVE;
+
+      bufferValidStart = 0;
+      bufferValidEnd = 0;
+    }
+    else {
+      // carry on from the end of what has already been decoded
+      newBVE = jmin(newBVE, bufferValidEnd + maxChunkSize);
+
+      sectionToReadStart = bufferValidEnd;
+      sectionToReadEnd = newBVE;
+
+      bufferValidStart = newBVS;
+      bufferValidEnd = jmin(bufferValidEnd.load(), newBVE);
+    }
+  }
+
+  if (sectionToReadStart >= sectionToReadEnd)
+    return false;
+
+  auto bufferSize = buffer.getNumSamples();
+  auto block1Start = (int) (sectionToReadStart % bufferSize);
+  auto block2Start = (int) (sectionToReadEnd % bufferSize);
+
+  if (block2Start > block1Start) {
+    readBufferSection(sectionToReadStart, (int) (sectionToReadEnd - sectionToReadStart), block1Start);
+  }
+  else {
+    readBufferSection(sectionToReadStart, bufferSize - block1Start, block1Start);
+    readBufferSection(sectionToReadStart + (bufferSize - block1Start), block2Start, 0);
+  }
+
+  {
+    const SpinLock::ScopedLockType sl(bufferRangeLock);
+    bufferValidStart = newBVS;
+    bufferValidEnd = newBVE;
+  }
+
+  return true;
+}
+
+/* Touch the pages of memory-mapped audio ahead of the playhead */
+bool ReadAheadBuffer::touchMappedPages() {
+  auto* decoded = decodedAudio.load();
+  auto pos = jmax((int64) 0, nextPlayPos.load());
+
+  auto from = touchedFrom.load();
+  auto upTo = touchedUpTo.load();
+
+  // the playhead jumped: start again from the new position
+  if (pos < from || pos > upTo)
+    from = upTo = pos;
+
+  auto end = jmin(upTo + (int64) maxChunkSize * 16,
+                  pos + buffer.getNumSamples(),
+                  (int64) decoded->getNumSamples());
+
+  if (end <= upTo)
+    return false;
+
+  constexpr int64 samplesPerPage = 4096 / sizeof(float);
+  float sum = 0;
+
+  for (int chan = 0; chan < decoded->getNumChannels(); ++chan) {
+    auto* data = decoded->getReadPointer(chan);
+
+    for (auto i = upTo; i < end; i += samplesPerPage)
+      sum += data[i];
+  }
+
+  // stored so that the reads can't be optimised away
+  touchedSampleSum = sum;
+
+  touchedFrom = from;
+  touchedUpTo = end;
+  return true;
+}
+
+/* Decode a section of the source into the ring buffer */
+void ReadAheadBuffer::readBufferSection(int64 start, int length, int bufferOffset) {
+  if (length <= 0)
+    return;
+
+  if (source->getNextReadPosition() != start)
+    source->setNextReadPosition(start);
+
+  AudioSourceChannelInfo info(&buffer, bufferOffset, length);
+  source->getNextAudioBlock(info);
+}
@@ -0,0 +1,222 @@
+/*
+  ==============================================================================
+
+    ReadAheadBuffer.h
+    Created: 17 Oct 2026 9:14:05am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ReadAheadScheduler.h"
+
+//==============================================================================
+/*
+    A ring buffer of decoded audio that sits between an AudioFormatReaderSource
+    and the AudioTransportSource of a deck. The ReadAheadScheduler's workers
+    decode into it, so the audio callback only ever copies samples that are
+    already in memory and never touches the decoder.
+*/
+class ReadAheadBuffer : public PositionableAudioSource {
+public:
+  /**
+   * \brief
+   *    Constructor.
+   *
+   * \param source
+   *    The source to decode from
+   * \param deleteSourceWhenDeleted
+   *    true if this buffer should take ownership of the source
+   * \param scheduler
+   *    The scheduler whose workers fill this buffer
+   * \param numChannels
+   *    Number of channels to buffer
+   * \param sourceSampleRate
+   *    Sample rate of the source (used to convert the fill level into seconds)
+   */
+  ReadAheadBuffer(PositionableAudioSource* source,
+                  bool deleteSourceWhenDeleted,
+                  ReadAheadScheduler& scheduler,
+                  int numChannels,
+                  double sourceSampleRate);
+
+  /**
+   * \brief
+   *    Destructor. Unregisters from the scheduler.
+   */
+  ~ReadAheadBuffer() override;
+
+  /**
+   * \brief
+   *    Allocate the ring buffer and register with the scheduler.
+   *
+   * \param samplesPerBlockExpected
+   *    Number of samples to be supplied by the source
+   * \param sampleRate
+   *    The sample rate at which the output will be used
+   */
+  void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+
+  /**
+   * \brief
+   *    Unregister from the scheduler and free the ring buffer.
+   */
+  void releaseResources() override;
+
+  /**
+   * \brief
+   *    Copy already decoded samples into the destination buffer.
+   *    Any part that has not been decoded yet is filled with silence and counted as an underrun.
+   *
+   * \param bufferToFill
+   *    The destination buffer to fill with audio data
+   */
+  void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+  void setNextReadPosition(int64 newPosition) override;
+  int64 getNextReadPosition() const override;
+  int64 getTotalLength() const override;
+  bool isLooping() const override;
+
+  /**
+   * \brief
+   *    Tell the buffer whether its deck is playing and how fast,
+   *    so that the scheduler can work out when it will run dry.
+   *
+   * \param isPlaying
+   *    true if the deck is playing
+   * \param speedRatio
+   *    The deck's playback speed (1.0 = normal)
+   */
+  void setPlaybackState(bool isPlaying, double speedRatio);
+
+  /**
+   * \brief
+   *    Decode the first chunk on the calling thread, so that the buffer can be played
+   *    straight away. Used when a track is loaded in the background.
+   */
+  void prime();
+
+  /**
+   * \brief
+   *    Play from a fully decoded copy of the source from now on (see DecodedTrackCache).
+   *    The ring buffer and the workers are bypassed, so seeking becomes a pure memory read.
+   *    Message thread only, and can only be set once.
+   *
+   * \param audio
+   *    The decoded audio of the whole source
+   * \param isMemoryMapped
+   *    true if the audio refers into a memory-mapped file (see PcmDiskCache). The workers then
+   *    touch the pages ahead of the playhead so that the audio thread never waits on a page fault
+   */
+  void setDecodedAudio(std::shared_ptr<const AudioBuffer<float>> audio, bool isMemoryMapped = false);
+
+  /**
+   * \brief
+   *    Get the amount of decoded audio ahead of the playhead.
+   *
+   * \return
+   *    The fill level in seconds
+   */
+  double getBufferedSeconds() const;
+
+  /**
+   * \brief
+   *    Get the fill level relative to the size of the ring buffer.
+   *
+   * \return
+   *    The fill level between 0 and 1
+   */
+  double getFillLevel() const;
+
+  /**
+   * \brief
+   *    Get how long the deck can keep playing before it runs out of decoded audio.
+   *    Stopped decks report their fill level plus a large offset so that they are serviced last.
+   *
+   * \return
+   *    Time to starvation in seconds
+   */
+  double getSecondsUntilStarved() const;
+
+  /**
+   * \brief
+   *    Get the number of audio blocks that could not be filled completely from the buffer.
+   */
+  int getUnderrunCount() const;
+
+private:
+  friend class ReadAheadScheduler;
+
+  /**
+   * \brief
+   *    Checks whether the buffer has room for more audio and the source has audio left to give.
+   */
+  bool needsMoreData() const;
+
+  /**
+   * \brief
+   *    Decode the next chunk from the source into the ring buffer.
+   *    Called on a scheduler worker thread.
+   *
+   * \return
+   *    true if anything was decoded
+   */
+  bool readNextChunk();
+
+  /**
+   * \brief
+   *    Read one sample from every page of memory-mapped audio ahead of the playhead,
+   *    so that the pages are resident before the audio thread gets there.
+   *
+   * \return
+   *    true if any new pages were touched
+   */
+  bool touchMappedPages();
+
+  /**
+   * \brief
+   *    Decode a section of the source into the ring buffer.
+   */
+  void readBufferSection(int64 start, int length, int bufferOffset);
+
+  bool isBeingServiced() const { return beingServiced.load(); }
+  bool tryStartServicing() { bool expected = false; return beingServiced.compare_exchange_strong(expected, true); }
+  void finishedServicing() { beingServiced = false; }
+
+  // largest number of samples decoded per scheduling slice,
+  // kept small so that a worker can switch to a more urgent deck quickly
+  static constexpr int maxChunkSize = 4096;
+
+  OptionalScopedPointer<PositionableAudioSource> source;
+  ReadAheadScheduler& scheduler;
+  const int numberOfChannels;
+  const double sourceSampleRate;
+
+  AudioBuffer<float> buffer;
+
+  // only held for index updates and the copy in getNextAudioBlock
+  SpinLock bufferRangeLock;
+  std::atomic<int64> bufferValidStart{ 0 }, bufferValidEnd{ 0 }, nextPlayPos{ 0 };
+
+  // set once the whole track is available in memory; the raw pointer is what the audio thread reads
+  std::shared_ptr<const AudioBuffer<float>> decodedAudioOwner;
+  std::atomic<const AudioBuffer<float>*> decodedAudio{ nullptr };
+  bool decodedAudioIsMapped = false;
+
+  // range of a memory-mapped track whose pages have been touched by a worker
+  std::atomic<int64> touchedFrom{ 0 }, touchedUpTo{ 0 };
+  std::atomic<float> touchedSampleSum{ 0 };
+
+  std::atomic<bool> playing{ false };
+  std::atomic<double> playbackSpeed{ 1.0 };
+  std::atomic<bool> beingServiced{ false };
+  std::atomic<int> underruns{ 0 };
+
+  bool isPrepared;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ReadAheadBuffer)
+};
@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    ReadAheadScheduler.cpp
+    Created: 17 Oct 2026 9:12:40am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "ReadAheadScheduler.h"
+#include "ReadAheadBuffer.h"
+
+//==============================================================================
+/* A worker thread that keeps decoding into the most urgent buffer */
+class ReadAheadScheduler::Worker : public Thread {
+public:
+  Worker(ReadAheadScheduler& _owner, int index)
+       : Thread("Read-ahead worker " + String(index)),
+         owner(_owner)
+  {
+  }
+
+  void run() override {
+    while (!threadShouldExit()) {
+      if (auto* buffer = owner.claimMostUrgentBuffer()) {
+        buffer->readNextChunk();
+        buffer->finishedServicing();
+      }
+      else {
+        // every buffer is full, sleep until one drains a little
+        wait(idleWaitMs);
+      }
+    }
+  }
+
+private:
+  static constexpr int idleWaitMs = 5;
+
+  ReadAheadScheduler& owner;
+};
+
+//==============================================================================
+ReadAheadScheduler::ReadAheadScheduler(int numWorkers, double secondsAhead)
+                                     : readAheadSeconds(secondsAhead)
+{
+  // leave at least one core for the audio and message threads
+  if (numWorkers <= 0)
+    numWorkers = jlimit(1, 4, SystemStats::getNumCpus() - 1);
+
+  for (int i = 0; i < numWorkers; ++i) {
+    auto* worker = workers.add(new Worker(*this, i));
+    worker->startThread();
+  }
+}
+
+ReadAheadScheduler::~ReadAheadScheduler() {
+  for (auto* worker : workers)
+    worker->signalThreadShouldExit();
+
+  for (auto* worker : workers)
+    worker->stopThread(2000);
+}
+
+/* Set how many seconds of audio each deck keeps decoded ahead */
+void ReadAheadScheduler::setReadAheadSeconds(double seconds) {
+  readAheadSeconds = jmax(0.1, seconds);
+}
+
+/* Get the configured read-ahead length */
+double ReadAheadScheduler::getReadAheadSeconds() const {
+  return readAheadSeconds;
+}
+
+/* Get the number of worker threads */
+int ReadAheadScheduler::getNumWorkers() const {
+  return workers.size();
+}
+
+/* Add a buffer to the set serviced by the workers */
+void ReadAheadScheduler::addBuffer(ReadAheadBuffer* buffer) {
+  const ScopedLock sl(bufferListLock);
+  buffers.addIfNotAlreadyThere(buffer);
+}
+
+/* Remove a buffer and wait for any worker still decoding into it */
+void ReadAheadScheduler::removeBuffer(ReadAheadBuffer* buffer) {
+  {
+    const ScopedLock sl(bufferListLock);
+    buffers.removeFirstMatchingValue(buffer);
+  }
+
+  // no worker can claim it any more, so only wait for the current chunk to finish
+  while (buffer->isBeingServiced())
+    Thread::yield();
+}
+
+/* Pick the buffer that will run dry first */
+ReadAheadBuffer* ReadAheadScheduler::claimMostUrgentBuffer() {
+  const ScopedLock sl(bufferListLock);
+
+  ReadAheadBuffer* mostUrgent = nullptr;
+  double earliestDeadline = std::numeric_limits<double>::max();
+
+  for (auto* buffer : buffers) {
+    if (buffer->isBeingServiced() || !buffer->needsMoreData())
+      continue;
+
+    auto deadline = buffer->getSecondsUntilStarved();
+
+    if (deadline < earliestDeadline) {
+      earliestDeadline = deadline;
+      mostUrgent = buffer;
+    }
+  }
+
+  // the buffer may have been claimed by ReadAheadBuffer::prime in the meantime
+  if (mostUrgent != nullptr && !mostUrgent->tryStartServicing())
+    return nullptr;
+
+  return mostUrgent;
+}
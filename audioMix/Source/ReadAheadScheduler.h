@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    ReadAheadScheduler.h
+    Created: 17 Oct 2026 9:12:40am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class ReadAheadBuffer;
+
+//==============================================================================
+/*
+    A single pool of background threads that decodes audio ahead of the
+    playhead for every deck. Each worker always services the registered
+    buffer that will run dry soonest, so a deck that is close to starving
+    is refilled before one that still has plenty of audio buffered.
+*/
+class ReadAheadScheduler {
+public:
+  /**
+   * \brief
+   *    Constructor. Starts the worker threads.
+   *
+   * \param numWorkers
+   *    Number of decoding threads shared by all decks (0 = pick from the CPU count)
+   * \param secondsAhead
+   *    Number of seconds each deck keeps decoded ahead of its playhead
+   */
+  ReadAheadScheduler(int numWorkers = 0, double secondsAhead = 5.0);
+
+  /**
+   * \brief
+   *    Destructor. Stops the worker threads.
+   */
+  ~ReadAheadScheduler();
+
+  /**
+   * \brief
+   *    Set how many seconds of audio each deck should keep decoded ahead of its playhead.
+   *    Takes effect the next time a buffer is prepared (i.e. on the next track load).
+   *
+   * \param seconds
+   *    The read-ahead length in seconds
+   */
+  void setReadAheadSeconds(double seconds);
+
+  /**
+   * \brief
+   *    Get the configured read-ahead length.
+   *
+   * \return
+   *    The read-ahead length in seconds
+   */
+  double getReadAheadSeconds() const;
+
+  /**
+   * \brief
+   *    Get the number of worker threads in the pool.
+   */
+  int getNumWorkers() const;
+
+  /**
+   * \brief
+   *    Add a buffer to the set serviced by the workers.
+   *    Called by ReadAheadBuffer::prepareToPlay.
+   */
+  void addBuffer(ReadAheadBuffer* buffer);
+
+  /**
+   * \brief
+   *    Remove a buffer from the set serviced by the workers.
+   *    Blocks until no worker is still decoding into it.
+   */
+  void removeBuffer(ReadAheadBuffer* buffer);
+
+private:
+  class Worker;
+
+  /**
+   * \brief
+   *    Pick the buffer with the earliest starvation deadline that needs more data,
+   *    and mark it as being serviced so that no other worker picks it as well.
+   *
+   * \return
+   *    The buffer to service, or nullptr if every buffer is full
+   */
+  ReadAheadBuffer* claimMostUrgentBuffer();
+
+  // guards the list of registered buffers (never taken on the audio thread)
+  CriticalSection bufferListLock;
+  Array<ReadAheadBuffer*> buffers;
+
+  OwnedArray<Worker> workers;
+
+  std::atomic<double> readAheadSeconds;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ReadAheadScheduler)
+};
@@ -0,0 +1,277 @@
+/*
+  ==============================================================================
+
+    RealtimeGuard.cpp
+    Created: 23 Oct 2026 9:41:26am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "RealtimeGuard.h"
+
+#if AUDIOMIX_RT_CHECK
+
+#include <new>
+
+#if JUCE_LINUX && defined(__GLIBC__)
+ #define AUDIOMIX_RT_CHECK_LIBC 1
+ #include <dlfcn.h>
+ #include <pthread.h>
+
+extern "C" {
+  void* __libc_malloc(size_t);
+  void* __libc_calloc(size_t, size_t);
+  void* __libc_realloc(void*, size_t);
+  void __libc_free(void*);
+}
+#else
+ #define AUDIOMIX_RT_CHECK_LIBC 0
+#endif
+
+namespace {
+  // everything here is constant-initialised, as the hooks can run before any constructor
+  thread_local int realtimeDepth = 0;
+  thread_local int allowedDepth = 0;
+
+  std::atomic<bool> enabled{ true };
+  std::atomic<int> numViolations{ 0 };
+
+  constexpr size_t reportLength = 4096;
+
+  struct Report {
+    std::atomic<bool> ready{ false };
+    char text[reportLength];
+  };
+
+  Report reports[RealtimeGuard::maxReports];
+  std::atomic<int> numReportsClaimed{ 0 };
+  std::atomic<int> numReportsTaken{ 0 };
+
+  /* Allocate without going through the checks */
+  void* allocate(size_t size) {
+  #if AUDIOMIX_RT_CHECK_LIBC
+    return __libc_malloc(size);
+  #else
+    return std::malloc(size);
+  #endif
+  }
+
+  /* Free without going through the checks */
+  void deallocate(void* p) {
+  #if AUDIOMIX_RT_CHECK_LIBC
+    __libc_free(p);
+  #else
+    std::free(p);
+  #endif
+  }
+}
+
+//==============================================================================
+RealtimeGuard::ScopedRealtimeThread::ScopedRealtimeThread() {
+  ++realtimeDepth;
+}
+
+RealtimeGuard::ScopedRealtimeThread::~ScopedRealtimeThread() {
+  --realtimeDepth;
+}
+
+RealtimeGuard::ScopedAllowed::ScopedAllowed() {
+  ++allowedDepth;
+}
+
+RealtimeGuard::ScopedAllowed::~ScopedAllowed() {
+  --allowedDepth;
+}
+
+/* Checks whether the checks were compiled in */
+bool RealtimeGuard::isAvailable() {
+  return true;
+}
+
+/* Turn the checks on or off at run time */
+void RealtimeGuard::setEnabled(bool shouldBeEnabled) {
+  enabled = shouldBeEnabled;
+}
+
+/* Get the number of violations since the last reset */
+int RealtimeGuard::getNumViolations() {
+  return numViolations.load();
+}
+
+/* Get the reports of the violations kept since the last call */
+StringArray RealtimeGuard::takeReports() {
+  StringArray taken;
+
+  for (;;) {
+    auto index = numReportsTaken.load();
+
+    if (index >= jmin(numReportsClaimed.load(), maxReports) || !reports[index].ready.load())
+      break;
+
+    if (numReportsTaken.compare_exchange_strong(index, index + 1))
+      taken.add(String::fromUTF8(reports[index].text));
+  }
+
+  return taken;
+}
+
+/* Forget every violation */
+void RealtimeGuard::reset() {
+  for (auto& report : reports)
+    report.ready = false;
+
+  numViolations = 0;
+  numReportsClaimed = 0;
+  numReportsTaken = 0;
+}
+
+/* Record a violation if the current thread is an audio thread */
+void RealtimeGuard::check(const char* what) {
+  if (realtimeDepth == 0 || allowedDepth > 0 || !enabled.load(std::memory_order_relaxed))
+    return;
+
+  // taking the call stack allocates too, which mustn't be reported again
+  ++allowedDepth;
+
+  numViolations.fetch_add(1);
+  auto index = numReportsClaimed.fetch_add(1);
+
+  if (index < maxReports) {
+    auto text = String(what) + " on the audio thread\n" + SystemStats::getStackBacktrace();
+    text.copyToUTF8(reports[index].text, reportLength);
+    reports[index].ready = true;
+  }
+
+  --allowedDepth;
+}
+
+//==============================================================================
+void* operator new(size_t size) {
+  RealtimeGuard::check("operator new");
+
+  if (auto* p = allocate(size))
+    return p;
+
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  RealtimeGuard::check("operator new[]");
+
+  if (auto* p = allocate(size))
+    return p;
+
+  throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  RealtimeGuard::check("operator new");
+  return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  RealtimeGuard::check("operator new[]");
+  return allocate(size);
+}
+
+void operator delete(void* p) noexcept {
+  if (p != nullptr)
+    RealtimeGuard::check("operator delete");
+
+  deallocate(p);
+}
+
+void operator delete[](void* p) noexcept {
+  if (p != nullptr)
+    RealtimeGuard::check("operator delete[]");
+
+  deallocate(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  operator delete[](p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  operator delete(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  operator delete[](p);
+}
+
+//==============================================================================
+#if AUDIOMIX_RT_CHECK_LIBC
+// JUCE's HeapBlock (and so AudioBuffer) uses malloc directly, and CriticalSection and
+// std::mutex end up in pthread_mutex_lock, so those are caught as well
+extern "C" {
+  void* malloc(size_t size) {
+    RealtimeGuard::check("malloc");
+    return __libc_malloc(size);
+  }
+
+  void* calloc(size_t num, size_t size) {
+    RealtimeGuard::check("calloc");
+    return __libc_calloc(num, size);
+  }
+
+  void* realloc(void* p, size_t size) {
+    RealtimeGuard::check("realloc");
+    return __libc_realloc(p, size);
+  }
+
+  void free(void* p) {
+    if (p != nullptr)
+      RealtimeGuard::check("free");
+
+    __libc_free(p);
+  }
+
+  int pthread_mutex_lock(pthread_mutex_t* mutex) {
+    using LockFunction = int (*)(pthread_mutex_t*);
+
+    // looked up on first use; a plain atomic, since a guarded static would lock
+    static std::atomic<LockFunction> realLock{ nullptr };
+    auto lock = realLock.load();
+
+    if (lock == nullptr) {
+      lock = (LockFunction) dlsym(RTLD_NEXT, "pthread_mutex_lock");
+      realLock = lock;
+    }
+
+    RealtimeGuard::check("pthread_mutex_lock");
+    return lock(mutex);
+  }
+}
+#endif
+
+#else
+
+//==============================================================================
+bool RealtimeGuard::isAvailable() {
+  return false;
+}
+
+void RealtimeGuard::setEnabled(bool) {
+}
+
+int RealtimeGuard::getNumViolations() {
+  return 0;
+}
+
+StringArray RealtimeGuard::takeReports() {
+  return {};
+}
+
+void RealtimeGuard::reset() {
+}
+
+void RealtimeGuard::check(const char*) {
+}
+
+#endif
@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    RealtimeGuard.h
+    Created: 23 Oct 2026 9:41:26am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Set to 1 (the Debug build and the benchmark do) to catch allocations and locks on the audio thread
+#ifndef AUDIOMIX_RT_CHECK
+ #define AUDIOMIX_RT_CHECK 0
+#endif
+
+//==============================================================================
+/*
+    Catches work on the audio thread that can block: memory allocation and
+    mutex locks.
+
+    A thread counts as an audio thread while a ScopedRealtimeThread exists on
+    it. With AUDIOMIX_RT_CHECK on, operator new and delete are replaced for the
+    whole program, and on Linux (glibc) so are malloc, calloc, realloc, free
+    and pthread_mutex_lock. Each of them checks a thread-local flag first, so
+    threads that aren't marked pay next to nothing. A call from a marked thread
+    counts as a violation, and the first few are kept with their call stack.
+
+    With AUDIOMIX_RT_CHECK off, the scoped classes are empty and every check
+    compiles away.
+*/
+class RealtimeGuard {
+public:
+  // number of violations whose call stack is kept
+  static constexpr int maxReports = 32;
+
+  /**
+   * \brief
+   *    Marks the current thread as an audio thread for as long as it exists. Can be nested.
+   */
+  class ScopedRealtimeThread {
+  public:
+  #if AUDIOMIX_RT_CHECK
+    ScopedRealtimeThread();
+    ~ScopedRealtimeThread();
+  #else
+    ScopedRealtimeThread() {}
+  #endif
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedRealtimeThread)
+  };
+
+  /**
+   * \brief
+   *    Lets the current thread allocate or lock for as long as it exists, for the few
+   *    places that do so on purpose. Say why wherever it is used.
+   */
+  class ScopedAllowed {
+  public:
+  #if AUDIOMIX_RT_CHECK
+    ScopedAllowed();
+    ~ScopedAllowed();
+  #else
+    ScopedAllowed() {}
+  #endif
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedAllowed)
+  };
+
+  /**
+   * \brief
+   *    Checks whether the checks were compiled in.
+   */
+  static bool isAvailable();
+
+  /**
+   * \brief
+   *    Turn the checks on or off at run time (they start on), e.g. to skip the warm-up of a test.
+   */
+  static void setEnabled(bool shouldBeEnabled);
+
+  /**
+   * \brief
+   *    Get the number of violations since the last reset.
+   */
+  static int getNumViolations();
+
+  /**
+   * \brief
+   *    Get the reports of the violations kept since the last call, each with its call stack.
+   *    Not for the audio thread.
+   */
+  static StringArray takeReports();
+
+  /**
+   * \brief
+   *    Forget every violation. Only call while no audio thread is running.
+   */
+  static void reset();
+
+  /**
+   * \brief
+   *    Record a violation if the current thread is an audio thread. Called by the hooks.
+   *
+   * \param what
+   *    The call that was made
+   */
+  static void check(const char* what);
+};
@@ -0,0 +1,188 @@
+/*
+  ==============================================================================
+
+    RenderWorkerPool.cpp
+    Created: 20 Oct 2026 3:18:27pm
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "RenderWorkerPool.h"
+
+//==============================================================================
+/* A real-time worker that runs jobs for every block it sees */
+class RenderWorkerPool::Worker : public Thread {
+public:
+  Worker(RenderWorkerPool& _owner, int _queue)
+       : Thread("Render worker " + String(_queue)),
+         owner(_owner),
+         queue(_queue)
+  {
+  }
+
+  void run() override {
+    uint32 seenGeneration = owner.generation.load();
+    auto spinStartTicks = Time::getHighResolutionTicks();
+
+    while (!threadShouldExit()) {
+      auto blockGeneration = owner.generation.load();
+
+      if (blockGeneration != seenGeneration) {
+        seenGeneration = blockGeneration;
+        owner.runJobs(queue, blockGeneration);
+        spinStartTicks = Time::getHighResolutionTicks();
+        continue;
+      }
+
+      // a block that is already on its way is picked up without going through the scheduler
+      if (Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - spinStartTicks) < spinSeconds)
+        continue;
+
+      // then sleep until run() wakes us. The flag is set before the generation is read again,
+      // and run() publishes the generation before it reads the flag, so one of them sees the other
+      sleeping = true;
+
+      if (owner.generation.load() == seenGeneration)
+        wait(-1);
+
+      sleeping = false;
+      spinStartTicks = Time::getHighResolutionTicks();
+    }
+  }
+
+  /* Wake the worker up if it is sleeping */
+  void wakeUp() {
+    if (sleeping.load())
+      notify();
+  }
+
+private:
+  static constexpr double spinSeconds = 0.00002;
+
+  RenderWorkerPool& owner;
+  const int queue;
+  std::atomic<bool> sleeping{ false };
+};
+
+//==============================================================================
+RenderWorkerPool::RenderWorkerPool(int maxJobsPerBlock, int numWorkers) {
+  auto numCpus = SystemStats::getNumCpus();
+
+  // the audio thread renders too, so one worker per remaining core
+  if (numWorkers <= 0)
+    numWorkers = numCpus - 1;
+
+  // and it takes a job of its own, so a worker beyond the jobs left over would never get one
+  numWorkers = jmax(0, jmin(numWorkers, maxWorkers, maxJobsPerBlock - 1));
+  numQueues = numWorkers + 1;
+
+  for (auto& q : queues)
+    q = 0;
+
+  for (int i = 0; i < numWorkers; ++i) {
+    auto* worker = workers.add(new Worker(*this, i + 1));
+
+    // keep each worker on its own core, leaving the first one to the audio thread
+    worker->setAffinityMask((uint32) 1 << ((i + 1) % jmin(32, numCpus)));
+    worker->startRealtimeThread(Thread::RealtimeOptions{});
+  }
+}
+
+RenderWorkerPool::~RenderWorkerPool() {
+  for (auto* worker : workers) {
+    worker->signalThreadShouldExit();
+    worker->notify();
+  }
+
+  for (auto* worker : workers)
+    worker->stopThread(2000);
+}
+
+/* Run every job of a task and return once they have all finished */
+void RenderWorkerPool::run(Task& task, int numJobs) {
+  jassert(numJobs <= maxJobs);
+
+  if (numJobs <= 0)
+    return;
+
+  auto blockGeneration = generation.load() + 1;
+
+  currentTask = &task;
+  numCompleted = 0;
+
+  // a block with fewer jobs than threads only needs one queue per job
+  auto activeQueues = jmin(numQueues, numJobs);
+  numActiveQueues = activeQueues;
+
+  // deal the jobs out round-robin: queue q holds jobs q, q + activeQueues, ...
+  for (int q = 0; q < activeQueues; ++q) {
+    auto count = (numJobs - q + activeQueues - 1) / activeQueues;
+    queues[(size_t) q] = ((uint64) blockGeneration << 32) | (uint64) count;
+  }
+
+  generation = blockGeneration;
+
+  // wake the workers that have a queue in this block (worker i owns queue i + 1)
+  for (int i = 0; i < activeQueues - 1; ++i)
+    workers.getUnchecked(i)->wakeUp();
+
+  // the calling thread works through its own queue and then helps with the rest
+  runJobs(0, blockGeneration);
+
+  // every job has been taken; wait for the ones still running on the workers
+  while (numCompleted.load() < numJobs)
+    Thread::yield();
+}
+
+/* Get the number of worker threads */
+int RenderWorkerPool::getNumWorkers() const {
+  return workers.size();
+}
+
+/* Run jobs of the current block until none are left */
+bool RenderWorkerPool::runJobs(int ownQueue, uint32 blockGeneration) {
+  auto* task = currentTask.load();
+  auto activeQueues = numActiveQueues.load();
+  bool ranAny = false;
+
+  for (int i = 0; i < activeQueues;) {
+    int job;
+
+    // always go back to our own queue first, then steal from the next one along
+    if (popJob((ownQueue + i) % activeQueues, blockGeneration, job)) {
+      task->runJob(job);
+      numCompleted.fetch_add(1);
+      ranAny = true;
+      i = 0;
+    }
+    else {
+      ++i;
+    }
+  }
+
+  return ranAny;
+}
+
+/* Take the next job off a queue */
+bool RenderWorkerPool::popJob(int queue, uint32 blockGeneration, int& job) {
+  auto& q = queues[(size_t) queue];
+  auto state = q.load();
+
+  for (;;) {
+    // a worker that woke up late must not take jobs from the next block
+    if ((uint32) (state >> 32) != blockGeneration)
+      return false;
+
+    auto next = (int) ((state >> 16) & 0xffff);
+    auto end = (int) (state & 0xffff);
+
+    if (next >= end)
+      return false;
+
+    if (q.compare_exchange_weak(state, state + ((uint64) 1 << 16))) {
+      job = queue + next * numActiveQueues.load();
+      return true;
+    }
+  }
+}
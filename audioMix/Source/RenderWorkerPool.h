@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    RenderWorkerPool.h
+    Created: 20 Oct 2026 3:18:27pm
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    A pool of real-time threads, each pinned to its own core, that render the
+    independent parts of an audio block (one deck each) in parallel.
+
+    The caller's jobs are dealt out round-robin to one queue per thread, with
+    the calling (audio) thread owning a queue of its own. Every thread takes
+    jobs from the front of its queue and steals from the others once it runs
+    dry, so a slow deck never holds up the rest. Queues are single atomic
+    words popped with compare-and-swap, and the caller spins until every job
+    has finished, so nothing on this path allocates. Because the caller works
+    through the queues too, a worker that wakes up late only costs
+    parallelism, never a missed block.
+
+    There are never more workers than a block has jobs to share with them.
+    An idle worker spins for a few microseconds after its last job, then
+    sleeps until the next block wakes it, so it never takes a core away from
+    the rest of the system between blocks.
+*/
+class RenderWorkerPool {
+public:
+  /**
+   * \brief
+   *    A block of work split into jobs that can run in any order, on any thread.
+   */
+  class Task {
+  public:
+    virtual ~Task() = default;
+
+    /**
+     * \brief
+     *    Run one job. Called exactly once for each index below the number of jobs.
+     */
+    virtual void runJob(int index) = 0;
+  };
+
+  /**
+   * \brief
+   *    Constructor.
+   *
+   * \param maxJobsPerBlock
+   *    The most jobs a block will have (the calling thread takes one, so this caps the workers at one fewer)
+   * \param numWorkers
+   *    Number of worker threads, or 0 to use one per spare core (up to maxWorkers)
+   */
+  RenderWorkerPool(int maxJobsPerBlock, int numWorkers = 0);
+
+  /**
+   * \brief
+   *    Destructor. Stops the workers.
+   */
+  ~RenderWorkerPool();
+
+  /**
+   * \brief
+   *    Run every job of a task on the workers and the calling thread, and return once
+   *    they have all finished. Call from one thread only (the audio thread).
+   *
+   * \param task
+   *    The task to run
+   * \param numJobs
+   *    Number of jobs, at most maxJobs
+   */
+  void run(Task& task, int numJobs);
+
+  /**
+   * \brief
+   *    Get the number of worker threads (not counting the calling thread).
+   */
+  int getNumWorkers() const;
+
+  static constexpr int maxWorkers = 7;
+  static constexpr int maxJobs = 0xffff;
+
+private:
+  class Worker;
+
+  /**
+   * \brief
+   *    Run jobs of the current block until none are left, starting with a queue and then
+   *    stealing from the others.
+   *
+   * \return
+   *    True if any job was run
+   */
+  bool runJobs(int ownQueue, uint32 blockGeneration);
+
+  /**
+   * \brief
+   *    Take the next job off a queue.
+   *
+   * \return
+   *    False if the queue is empty or belongs to another block
+   */
+  bool popJob(int queue, uint32 blockGeneration, int& job);
+
+  OwnedArray<Worker> workers;
+  int numQueues;
+
+  // the queues the current block's jobs are dealt to: one per job, at most numQueues
+  std::atomic<int> numActiveQueues{ 1 };
+
+  // each queue is one word: the block generation, the next job and the end, 32/16/16 bits
+  std::array<std::atomic<uint64>, maxWorkers + 1> queues;
+
+  std::atomic<uint32> generation{ 0 };
+  std::atomic<Task*> currentTask{ nullptr };
+  std::atomic<int> numCompleted{ 0 };
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderWorkerPool)
+};
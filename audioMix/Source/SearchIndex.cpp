@@ -0,0 +1,286 @@
+/*
+  ==============================================================================
+
+    SearchIndex.cpp
+    Created: 30 Oct 2026 2:17:39pm
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "SearchIndex.h"
+
+//==============================================================================
+SearchIndex::SearchIndex() {
+}
+
+SearchIndex::~SearchIndex() {
+}
+
+/* Index a track */
+void SearchIndex::add(TrackId id, const String& text) {
+  // posting lists stay in ID order only if IDs only ever grow
+  jassert(allIds.empty() || id > allIds.back());
+
+  if (textStart.size() <= (size_t) id) {
+    textStart.resize((size_t) id + 1, 0);
+    textLength.resize((size_t) id + 1, 0);
+  }
+
+  auto folded = fold(text);
+  textStart[id] = (uint32) texts.size();
+  textLength[id] = (uint32) folded.size();
+  texts += folded;
+
+  for (size_t length = 1; length <= (size_t) maxGramLength; ++length) {
+    for (size_t start = 0; start + length <= folded.size(); ++start) {
+      auto& list = postings[gramKey(folded, start, length)];
+
+      // an n-gram that appears twice in the text is already listed
+      if (list.empty() || list.back() != id)
+        list.push_back(id);
+    }
+  }
+
+  allIds.push_back(id);
+  ++numTracks;
+
+  // the new track may match the last query
+  lastResultsValid = false;
+}
+
+/* Remove tracks from the index */
+void SearchIndex::remove(const std::vector<TrackId>& ids) {
+  std::vector<bool> removed(textStart.size(), false);
+  std::vector<uint64> keys;
+  auto numRemoved = 0;
+
+  for (auto id : ids) {
+    if ((size_t) id >= textStart.size() || removed[id] || !std::binary_search(allIds.begin(), allIds.end(), id))
+      continue;
+
+    // the text itself stays in the arena until the index is cleared
+    auto grams = gramsOf(texts.substr(textStart[id], textLength[id]));
+    keys.insert(keys.end(), grams.begin(), grams.end());
+    textLength[id] = 0;
+
+    removed[id] = true;
+    ++numRemoved;
+  }
+
+  if (numRemoved == 0)
+    return;
+
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  auto isRemoved = [&removed](TrackId id) { return removed[id]; };
+
+  // each affected list is compacted once, however many of its tracks go
+  for (auto key : keys) {
+    auto it = postings.find(key);
+
+    if (it == postings.end())
+      continue;
+
+    auto& list = it->second;
+    list.erase(std::remove_if(list.begin(), list.end(), isRemoved), list.end());
+
+    if (list.empty())
+      postings.erase(it);
+  }
+
+  allIds.erase(std::remove_if(allIds.begin(), allIds.end(), isRemoved), allIds.end());
+  numTracks = (int) allIds.size();
+
+  lastResultsValid = false;
+}
+
+/* Remove every track from the index */
+void SearchIndex::clear() {
+  postings.clear();
+  texts.clear();
+  textStart.clear();
+  textLength.clear();
+  allIds.clear();
+  numTracks = 0;
+
+  lastResultsValid = false;
+}
+
+/* Find the tracks whose text contains a keyword, ignoring case */
+const std::vector<SearchIndex::TrackId>& SearchIndex::search(const String& keyword) {
+  auto query = fold(keyword);
+
+  if (query.empty())
+    return allIds;
+
+  if (lastResultsValid && query == lastQuery)
+    return lastResults;
+
+  // typing on from a query that was long enough to be selective: only its results can match
+  auto canNarrow = lastResultsValid
+                     && lastQuery.size() >= (size_t) maxGramLength
+                     && query.size() > (size_t) maxGramLength
+                     && query.find(lastQuery) != std::u32string::npos;
+
+  if (canNarrow) {
+    lastResults.erase(std::remove_if(lastResults.begin(), lastResults.end(), [this, &query](TrackId id) {
+      return !contains(id, query);
+    }), lastResults.end());
+  }
+  else {
+    searchIndex(query, lastResults);
+  }
+
+  lastQuery = query;
+  lastResultsValid = true;
+
+  return lastResults;
+}
+
+/* Get the (approximate) memory used by the index, in bytes */
+size_t SearchIndex::getMemoryUsed() const {
+  size_t bytes = postings.bucket_count() * sizeof(void*);
+
+  for (auto& entry : postings)
+    bytes += sizeof(entry) + entry.second.capacity() * sizeof(TrackId);
+
+  bytes += texts.capacity() * sizeof(char32_t) + (textStart.capacity() + textLength.capacity()) * sizeof(uint32);
+
+  return bytes + allIds.capacity() * sizeof(TrackId) + lastResults.capacity() * sizeof(TrackId);
+}
+
+/* Lower-case a text, one code point per character */
+std::u32string SearchIndex::fold(const String& text) {
+  std::u32string folded;
+  folded.reserve((size_t) text.length());
+
+  for (auto p = text.getCharPointer(); !p.isEmpty(); ++p)
+    folded.push_back((char32_t) CharacterFunctions::toLowerCase(*p));
+
+  return folded;
+}
+
+/* Get the key of the n-gram starting at a position */
+uint64 SearchIndex::gramKey(const std::u32string& text, size_t start, size_t length) {
+  // 21 bits hold any code point, and no text contains a 0, so n-grams of different lengths never share a key
+  uint64 key = 0;
+
+  for (size_t i = 0; i < length; ++i)
+    key |= (uint64) (text[start + i] & 0x1fffff) << (21 * i);
+
+  return key;
+}
+
+/* Get the distinct n-grams of a text */
+std::vector<uint64> SearchIndex::gramsOf(const std::u32string& text) {
+  std::vector<uint64> grams;
+  grams.reserve(text.size() * maxGramLength);
+
+  for (size_t length = 1; length <= (size_t) maxGramLength; ++length)
+    for (size_t start = 0; start + length <= text.size(); ++start)
+      grams.push_back(gramKey(text, start, length));
+
+  std::sort(grams.begin(), grams.end());
+  grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+  return grams;
+}
+
+/* Search the whole index */
+void SearchIndex::searchIndex(const std::u32string& query, std::vector<TrackId>& results) const {
+  results.clear();
+
+  // short enough to be an n-gram itself: its posting list is the answer
+  if (query.size() <= (size_t) maxGramLength) {
+    if (auto* list = findPostings(gramKey(query, 0, query.size())))
+      results = *list;
+
+    return;
+  }
+
+  std::vector<uint64> keys;
+
+  for (size_t start = 0; start + maxGramLength <= query.size(); ++start)
+    keys.push_back(gramKey(query, start, maxGramLength));
+
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  std::vector<const Postings*> lists;
+
+  for (auto key : keys) {
+    auto* list = findPostings(key);
+
+    // a trigram no track has: nothing can match
+    if (list == nullptr)
+      return;
+
+    lists.push_back(list);
+  }
+
+  // intersect the smallest lists first, so the candidates shrink as fast as possible
+  std::sort(lists.begin(), lists.end(), [](const Postings* a, const Postings* b) { return a->size() < b->size(); });
+
+  results = *lists.front();
+
+  for (size_t i = 1; i < lists.size() && !results.empty(); ++i)
+    intersect(results, *lists[i]);
+
+  // having all the trigrams doesn't mean having them in the right order
+  results.erase(std::remove_if(results.begin(), results.end(), [this, &query](TrackId id) {
+    return !contains(id, query);
+  }), results.end());
+}
+
+/* Checks whether a track's text contains a query */
+bool SearchIndex::contains(TrackId id, const std::u32string& query) const {
+  if (textLength[id] < query.size())
+    return false;
+
+  auto* text = texts.data() + textStart[id];
+  auto* lastStart = text + textLength[id] - query.size();
+  auto first = query[0];
+
+  // look for the first character, and only compare the rest where it is found
+  for (auto* p = text; p <= lastStart; ++p)
+    if (*p == first && std::equal(query.begin() + 1, query.end(), p + 1))
+      return true;
+
+  return false;
+}
+
+/* Keep only the IDs that are also in a posting list */
+void SearchIndex::intersect(std::vector<TrackId>& ids, const Postings& list) {
+  auto cursor = list.begin();
+  auto end = list.end();
+  size_t kept = 0;
+
+  for (auto id : ids) {
+    // gallop from the last match, so a long list costs a few steps per ID rather than a whole walk
+    size_t step = 1;
+
+    while (cursor + (std::ptrdiff_t) step < end && *(cursor + (std::ptrdiff_t) step) < id) {
+      cursor += (std::ptrdiff_t) step;
+      step *= 2;
+    }
+
+    auto limit = cursor + (std::ptrdiff_t) step < end ? cursor + (std::ptrdiff_t) step + 1 : end;
+    cursor = std::lower_bound(cursor, limit, id);
+
+    if (cursor == end)
+      break;
+
+    if (*cursor == id)
+      ids[kept++] = id;
+  }
+
+  ids.resize(kept);
+}
+
+/* Get the posting list of an n-gram */
+const SearchIndex::Postings* SearchIndex::findPostings(uint64 key) const {
+  auto it = postings.find(key);
+  return it != postings.end() ? &it->second : nullptr;
+}
@@ -0,0 +1,166 @@
+/*
+  ==============================================================================
+
+    SearchIndex.h
+    Created: 30 Oct 2026 2:17:39pm
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <string>
+#include <unordered_map>
+
+//==============================================================================
+/*
+    An inverted index of library track titles, for searching as you type.
+
+    Each title is lower-cased once, when it is added, and every distinct
+    sequence of one, two and three characters in it (its n-grams) gets a
+    posting list of the tracks that contain it. A query of up to three
+    characters is then a single posting list. A longer query intersects the
+    lists of its trigrams, smallest first, and only the tracks left are
+    checked for the whole query. Posting lists are kept in ID order, which is
+    library order, so results need no sorting.
+
+    The last query's results are kept, so that typing another character only
+    filters them rather than searching the whole library again.
+
+    Tracks are added and removed as the library changes. More fields (e.g.
+    artist and album tags) can be indexed by passing them along with the
+    title, separated by a line break.
+*/
+class SearchIndex {
+public:
+  // the TrackStore's track IDs
+  using TrackId = uint32;
+
+  /**
+   * \brief
+   *    Constructor.
+   */
+  SearchIndex();
+
+  /**
+   * \brief
+   *    Destructor.
+   */
+  ~SearchIndex();
+
+  /**
+   * \brief
+   *    Index a track. IDs must be added in increasing order, as the TrackStore hands them out.
+   *
+   * \param id
+   *    The track's ID
+   * \param text
+   *    The text to find the track by
+   */
+  void add(TrackId id, const String& text);
+
+  /**
+   * \brief
+   *    Remove tracks from the index.
+   *
+   * \param ids
+   *    The IDs of the tracks (IDs that aren't indexed are ignored)
+   */
+  void remove(const std::vector<TrackId>& ids);
+
+  /**
+   * \brief
+   *    Remove every track from the index.
+   */
+  void clear();
+
+  /**
+   * \brief
+   *    Find the tracks whose text contains a keyword, ignoring case.
+   *
+   * \param keyword
+   *    The text to look for
+   *
+   * \return
+   *    IDs of the matching tracks, in library order (every track if the keyword is empty)
+   */
+  const std::vector<TrackId>& search(const String& keyword);
+
+  /**
+   * \brief
+   *    Get the number of tracks indexed.
+   */
+  int size() const { return numTracks; }
+
+  /**
+   * \brief
+   *    Get the (approximate) memory used by the index, in bytes.
+   */
+  size_t getMemoryUsed() const;
+
+private:
+  using Postings = std::vector<TrackId>;
+
+  // n-grams longer than this are found by intersecting trigrams
+  static constexpr int maxGramLength = 3;
+
+  /**
+   * \brief
+   *    Lower-case a text, one code point per character.
+   */
+  static std::u32string fold(const String& text);
+
+  /**
+   * \brief
+   *    Get the key of the n-gram (of up to three characters) starting at a position.
+   */
+  static uint64 gramKey(const std::u32string& text, size_t start, size_t length);
+
+  /**
+   * \brief
+   *    Get the distinct n-grams of a text, of every length up to maxGramLength.
+   */
+  static std::vector<uint64> gramsOf(const std::u32string& text);
+
+  /**
+   * \brief
+   *    Search the whole index.
+   */
+  void searchIndex(const std::u32string& query, std::vector<TrackId>& results) const;
+
+  /**
+   * \brief
+   *    Checks whether a track's text contains a (lower-cased) query.
+   */
+  bool contains(TrackId id, const std::u32string& query) const;
+
+  /**
+   * \brief
+   *    Keep only the IDs that are also in a posting list. Both must be in ID order.
+   */
+  static void intersect(std::vector<TrackId>& ids, const Postings& list);
+
+  /**
+   * \brief
+   *    Get the posting list of an n-gram, or nullptr if no track contains it.
+   */
+  const Postings* findPostings(uint64 key) const;
+
+  std::unordered_map<uint64, Postings> postings;
+
+  // lower-cased text of every track, one after another so that checking candidates in ID order
+  // reads memory in order; textStart and textLength are indexed by ID (a length of 0 once removed)
+  std::u32string texts;
+  std::vector<uint32> textStart, textLength;
+  std::vector<TrackId> allIds;
+  int numTracks = 0;
+
+  // the last query and its results, for narrowing them as the user types
+  std::u32string lastQuery;
+  std::vector<TrackId> lastResults;
+  bool lastResultsValid = false;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SearchIndex)
+};
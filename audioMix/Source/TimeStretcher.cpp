@@ -0,0 +1,301 @@
+/*
+  ==============================================================================
+
+    TimeStretcher.cpp
+    Created: 18 Oct 2026 3:47:12pm
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "TimeStretcher.h"
+
+namespace {
+  /* Cross-correlation of b against a, normalised by the energy of b, over every step-th sample */
+  float normalisedCorrelation(const float* a, const float* b, int num, int step) noexcept {
+    float dot = 0, energy = 0;
+
+    for (int i = 0; i < num; i += step) {
+      dot += a[i] * b[i];
+      energy += b[i] * b[i];
+    }
+
+    return energy > 0 ? dot / std::sqrt(energy) : 0.0f;
+  }
+}
+
+//==============================================================================
+TimeStretcher::TimeStretcher(AudioSource* _input, int _numChannels)
+                           : input(_input),
+                             numChannels(_numChannels),
+                             inputStart(0),
+                             numInput(0),
+                             outputReadPos(0),
+                             numOutput(0),
+                             frameSize(0),
+                             hopSize(0),
+                             searchRadius(0),
+                             analysisPos(0),
+                             previousFrameStart(0),
+                             hasPreviousFrame(false),
+                             wasEnabled(false),
+                             configuredSampleRate(0)
+{
+  jassert(input != nullptr);
+}
+
+TimeStretcher::~TimeStretcher() {
+}
+
+/* Allocate all buffers for the largest supported frame size */
+void TimeStretcher::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+  // the span of input one frame can reach is at most about 2.5 frames at the highest tempo
+  auto inputCapacity = 4 * maxFrameSize;
+
+  inputBuffer.setSize(numChannels, inputCapacity);
+  monoInput.allocate((size_t) inputCapacity, true);
+  overlapBuffer.setSize(numChannels, maxFrameSize);
+  outputHop.setSize(numChannels, maxFrameSize / 2);
+  window.allocate((size_t) maxFrameSize, true);
+
+  setSourceSampleRate(sampleRate);
+  smoothedTempo.reset(sampleRate, 0.05);
+  resetState();
+
+  input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+/* Free all buffers */
+void TimeStretcher::releaseResources() {
+  input->releaseResources();
+
+  inputBuffer.setSize(numChannels, 0);
+  overlapBuffer.setSize(numChannels, 0);
+  outputHop.setSize(numChannels, 0);
+}
+
+/* Fill the destination buffer with the stretched input */
+void TimeStretcher::getNextAudioBlock(const AudioSourceChannelInfo& info) {
+  auto isOn = enabled.load();
+  auto needsReset = resetRequested.exchange(false);
+
+  // switching key-lock on or off, or loading a track at another rate, starts from scratch
+  if (isOn != wasEnabled || sourceSampleRate.load() != configuredSampleRate) {
+    wasEnabled = isOn;
+    needsReset = true;
+  }
+
+  if (needsReset && inputBuffer.getNumSamples() > 0)
+    resetState();
+
+  if (!isOn) {
+    input->getNextAudioBlock(info);
+    return;
+  }
+
+  if (inputBuffer.getNumSamples() == 0) {
+    info.clearActiveBufferRegion();
+    return;
+  }
+
+  smoothedTempo.setTargetValue(tempo.load());
+
+  for (int done = 0; done < info.numSamples;) {
+    if (numOutput == 0)
+      synthesiseFrame();
+
+    auto num = jmin(numOutput, info.numSamples - done);
+
+    for (int chan = 0; chan < jmin(numChannels, info.buffer->getNumChannels()); ++chan)
+      info.buffer->copyFrom(chan, info.startSample + done, outputHop, chan, outputReadPos, num);
+
+    outputReadPos += num;
+    numOutput -= num;
+    done += num;
+  }
+
+  for (int chan = numChannels; chan < info.buffer->getNumChannels(); ++chan)
+    info.buffer->clear(chan, info.startSample, info.numSamples);
+}
+
+/* Turn key-lock on or off */
+void TimeStretcher::setEnabled(bool shouldBeEnabled) {
+  enabled = shouldBeEnabled;
+}
+
+/* Checks whether key-lock is on */
+bool TimeStretcher::isEnabled() const {
+  return enabled.load();
+}
+
+/* Set the tempo ratio to ramp to */
+void TimeStretcher::setTempo(double newTempo) {
+  tempo = jlimit(0.1, maxTempo, newTempo);
+}
+
+/* Set the sample rate of the input */
+void TimeStretcher::setSourceSampleRate(double newSourceSampleRate) {
+  if (newSourceSampleRate > 0)
+    sourceSampleRate = newSourceSampleRate;
+}
+
+/* Throw away the buffered audio at the start of the next block */
+void TimeStretcher::reset() {
+  resetRequested = true;
+}
+
+/* Get the fixed latency added while key-lock is on */
+int TimeStretcher::getLatencyInSamples() const {
+  return enabled.load() ? getFrameSizeFor(sourceSampleRate.load()) : 0;
+}
+
+/* Get the frame size used at a sample rate */
+int TimeStretcher::getFrameSizeFor(double sampleRate) {
+  return jlimit(256, maxFrameSize, nextPowerOfTwo((int) (sampleRate * 0.02)));
+}
+
+/* Pick the frame size for the current sample rate and clear all state */
+void TimeStretcher::resetState() {
+  configuredSampleRate = sourceSampleRate.load();
+
+  frameSize = getFrameSizeFor(configuredSampleRate);
+  hopSize = frameSize / 2;
+  searchRadius = frameSize / 4;
+
+  // a periodic Hann window, whose copies a hop apart sum to exactly one
+  for (int i = 0; i < frameSize; ++i)
+    window[i] = (float) (0.5 - 0.5 * std::cos(MathConstants<double>::twoPi * i / frameSize));
+
+  inputBuffer.clear();
+  overlapBuffer.clear();
+  outputHop.clear();
+
+  inputStart = 0;
+  numInput = 0;
+  outputReadPos = 0;
+  numOutput = 0;
+
+  analysisPos = 0;
+  previousFrameStart = 0;
+  hasPreviousFrame = false;
+
+  // starting from scratch, so there is nothing to ramp from
+  smoothedTempo.setCurrentAndTargetValue(tempo.load());
+}
+
+/* Make sure the input buffer holds everything up to an absolute input position */
+void TimeStretcher::pullInputUpTo(int64 endPosition) {
+  auto needed = (int) (endPosition - (inputStart + numInput));
+
+  if (needed <= 0)
+    return;
+
+  jassert(numInput + needed <= inputBuffer.getNumSamples());
+
+  AudioSourceChannelInfo in(&inputBuffer, numInput, needed);
+  input->getNextAudioBlock(in);
+
+  // the search only needs one channel, so it runs on the average of all of them
+  auto* mono = monoInput.get() + numInput;
+  FloatVectorOperations::copy(mono, inputBuffer.getReadPointer(0, numInput), needed);
+
+  for (int chan = 1; chan < numChannels; ++chan)
+    FloatVectorOperations::add(mono, inputBuffer.getReadPointer(chan, numInput), needed);
+
+  FloatVectorOperations::multiply(mono, 1.0f / numChannels, needed);
+
+  numInput += needed;
+}
+
+/* Find the shift of the next frame that best matches the natural continuation of the previous one */
+int TimeStretcher::findBestOffset(int64 naturalStart, int64 nominalStart) {
+  auto* natural = monoInput.get() + (naturalStart - inputStart);
+  auto* nominal = monoInput.get() + (nominalStart - inputStart);
+
+  // the two frames overlap by one hop, so that is the stretch that has to line up
+  auto overlap = frameSize - hopSize;
+
+  // never look before the start of the buffered input
+  auto lowest = (int) jmax((int64) -searchRadius, inputStart - nominalStart);
+
+  // a coarse pass over every 4th offset and sample, then a fine pass around the best one
+  auto bestOffset = lowest;
+  auto bestScore = std::numeric_limits<float>::lowest();
+
+  for (int offset = lowest; offset <= searchRadius; offset += 4) {
+    auto score = normalisedCorrelation(natural, nominal + offset, overlap, 4);
+
+    if (score > bestScore) {
+      bestScore = score;
+      bestOffset = offset;
+    }
+  }
+
+  auto coarseBest = bestOffset;
+  bestScore = std::numeric_limits<float>::lowest();
+
+  for (int offset = jmax(lowest, coarseBest - 3); offset <= jmin(searchRadius, coarseBest + 3); ++offset) {
+    auto score = normalisedCorrelation(natural, nominal + offset, overlap, 1);
+
+    if (score > bestScore) {
+      bestScore = score;
+      bestOffset = offset;
+    }
+  }
+
+  return bestOffset;
+}
+
+/* Overlap-add the next frame and move one hop of finished audio into outputHop */
+void TimeStretcher::synthesiseFrame() {
+  auto nominalStart = (int64) analysisPos;
+  pullInputUpTo(nominalStart + searchRadius + frameSize);
+
+  auto frameStart = nominalStart;
+
+  if (hasPreviousFrame)
+    frameStart += findBestOffset(previousFrameStart + hopSize, nominalStart);
+
+  for (int chan = 0; chan < numChannels; ++chan) {
+    auto* overlap = overlapBuffer.getWritePointer(chan);
+    auto* src = inputBuffer.getReadPointer(chan, (int) (frameStart - inputStart));
+
+    FloatVectorOperations::addWithMultiply(overlap, src, window.get(), frameSize);
+
+    // the first hop has now received both of its frames
+    outputHop.copyFrom(chan, 0, overlap, hopSize);
+    std::memmove(overlap, overlap + hopSize, (size_t) (frameSize - hopSize) * sizeof(float));
+    FloatVectorOperations::clear(overlap + frameSize - hopSize, hopSize);
+  }
+
+  outputReadPos = 0;
+  numOutput = hopSize;
+
+  previousFrameStart = frameStart;
+  hasPreviousFrame = true;
+
+  // the tempo only changes how far apart the frames are taken from the input, ramping hop by hop
+  analysisPos += hopSize * smoothedTempo.skip(hopSize);
+
+  discardInputBefore(jmin(previousFrameStart + hopSize, (int64) analysisPos - searchRadius));
+}
+
+/* Drop input that no future frame can use */
+void TimeStretcher::discardInputBefore(int64 position) {
+  auto consumed = (int) jmin((int64) numInput, position - inputStart);
+
+  if (consumed <= 0)
+    return;
+
+  auto remaining = numInput - consumed;
+
+  for (int chan = 0; chan < numChannels; ++chan) {
+    auto* data = inputBuffer.getWritePointer(chan);
+    std::memmove(data, data + consumed, (size_t) remaining * sizeof(float));
+  }
+
+  std::memmove(monoInput.get(), monoInput.get() + consumed, (size_t) remaining * sizeof(float));
+
+  inputStart += consumed;
+  numInput = remaining;
+}
@@ -0,0 +1,194 @@
+/*
+  ==============================================================================
+
+    TimeStretcher.h
+    Created: 18 Oct 2026 3:47:12pm
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    A WSOLA (waveform similarity overlap-add) time-stretcher for key-lock.
+    It changes the tempo of its input without changing the pitch, by
+    overlap-adding Hann-windowed frames taken from the input at a faster or
+    slower rate than they are written out. Each frame is shifted by up to a
+    few milliseconds to the position that best continues the previous one.
+
+    Runs at the file's sample rate, sits between a deck's transport source and
+    its resampler, and passes audio straight through while disabled. All
+    buffers are allocated in prepareToPlay for the largest supported frame, so
+    nothing is allocated on the audio thread.
+*/
+class TimeStretcher : public AudioSource {
+public:
+  /**
+   * \brief
+   *    Constructor.
+   *
+   * \param _input
+   *    The source to stretch (not owned)
+   * \param _numChannels
+   *    Number of channels to process
+   */
+  TimeStretcher(AudioSource* _input, int _numChannels = 2);
+
+  /**
+   * \brief
+   *    Destructor.
+   */
+  ~TimeStretcher() override;
+
+  /**
+   * \brief
+   *    Allocate all buffers for the largest supported frame size.
+   *
+   * \param samplesPerBlockExpected
+   *    Largest number of samples requested per block
+   * \param sampleRate
+   *    The sample rate of the input (the file's)
+   */
+  void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+
+  /**
+   * \brief
+   *    Free all buffers.
+   */
+  void releaseResources() override;
+
+  /**
+   * \brief
+   *    Fill the destination buffer with the stretched input (or the input itself while disabled).
+   *
+   * \param bufferToFill
+   *    The destination buffer to fill with audio data
+   */
+  void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+  /**
+   * \brief
+   *    Turn key-lock on or off. Takes effect at the start of the next block.
+   */
+  void setEnabled(bool shouldBeEnabled);
+
+  /**
+   * \brief
+   *    Checks whether key-lock is on.
+   */
+  bool isEnabled() const;
+
+  /**
+   * \brief
+   *    Set the tempo ratio (input samples consumed per output sample). The
+   *    stretcher ramps to it over 50 ms, starting at the next block.
+   *
+   * \param newTempo
+   *    The tempo ratio, between 0.1 and 2.0 (1.0 = normal)
+   */
+  void setTempo(double newTempo);
+
+  /**
+   * \brief
+   *    Set the sample rate of the input. Picks a frame size of about 20 ms,
+   *    applied at the start of the next block without allocating.
+   */
+  void setSourceSampleRate(double newSourceSampleRate);
+
+  /**
+   * \brief
+   *    Throw away the buffered audio at the start of the next block (e.g. after a seek).
+   */
+  void reset();
+
+  /**
+   * \brief
+   *    Get the fixed latency added while key-lock is on (one frame).
+   *
+   * \return
+   *    The latency in samples at the input's sample rate
+   */
+  int getLatencyInSamples() const;
+
+private:
+  /**
+   * \brief
+   *    Pick the frame size for the current sample rate and clear all state.
+   */
+  void resetState();
+
+  /**
+   * \brief
+   *    Make sure the input buffer holds everything up to (but not including) an absolute input position.
+   */
+  void pullInputUpTo(int64 endPosition);
+
+  /**
+   * \brief
+   *    Find the shift of the next frame that best matches the natural continuation of the previous one.
+   *
+   * \return
+   *    The offset in samples, within +/- searchRadius
+   */
+  int findBestOffset(int64 naturalStart, int64 nominalStart);
+
+  /**
+   * \brief
+   *    Overlap-add the next frame and move one hop of finished audio into outputHop.
+   */
+  void synthesiseFrame();
+
+  /**
+   * \brief
+   *    Drop input that no future frame can use.
+   */
+  void discardInputBefore(int64 position);
+
+  /**
+   * \brief
+   *    Get the frame size used at a sample rate (about 20 ms, rounded up to a power of two).
+   */
+  static int getFrameSizeFor(double sampleRate);
+
+  static constexpr int maxFrameSize = 4096;
+  static constexpr double maxTempo = 2.0;
+
+  AudioSource* input;
+  const int numChannels;
+
+  // input samples, starting at absolute position inputStart, plus a mono mix used for the search
+  AudioBuffer<float> inputBuffer;
+  HeapBlock<float> monoInput;
+  int64 inputStart;
+  int numInput;
+
+  // the frames being overlap-added, and the last finished hop waiting to be played
+  AudioBuffer<float> overlapBuffer;
+  AudioBuffer<float> outputHop;
+  int outputReadPos;
+  int numOutput;
+
+  HeapBlock<float> window;
+
+  int frameSize;
+  int hopSize;
+  int searchRadius;
+
+  double analysisPos;
+  int64 previousFrameStart;
+  bool hasPreviousFrame;
+
+  std::atomic<bool> enabled{ false };
+  std::atomic<double> tempo{ 1.0 };
+  SmoothedValue<double> smoothedTempo{ 1.0 };
+  std::atomic<double> sourceSampleRate{ 44100.0 };
+  std::atomic<bool> resetRequested{ false };
+  bool wasEnabled;
+  double configuredSampleRate;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TimeStretcher)
+};
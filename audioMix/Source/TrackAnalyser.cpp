@@ -0,0 +1,446 @@
+/*
+  ==============================================================================
+
+    TrackAnalyser.cpp
+    Created: 24 Oct 2026 10:14:52am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "TrackAnalyser.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <xmmintrin.h>
+#elif JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+#endif
+
+namespace {
+  constexpr double hopSeconds = 0.01;   // resolution of the onset envelope
+  constexpr int hopsPerChunk = 512;     // audio read (and analysed) at a time
+  constexpr double minBpm = 60.0;
+  constexpr double maxBpm = 200.0;
+  constexpr double preferredBpm = 120.0;
+  constexpr double lowBandHz = 150.0;   // kick drums
+  constexpr double minSeconds = 5.0;    // shorter tracks don't get a tempo
+
+  /* Dot product of two float arrays of any length */
+  float dotProduct(const float* a, const float* b, int num) noexcept {
+    int i = 0;
+
+   #if JUCE_USE_SSE_INTRINSICS
+    auto acc = _mm_setzero_ps();
+
+    for (; i + 4 <= num; i += 4)
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc);
+    auto sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+   #elif JUCE_USE_ARM_NEON
+    auto acc = vdupq_n_f32(0.0f);
+
+    for (; i + 4 <= num; i += 4)
+      acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+
+    auto pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    auto sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+   #else
+    auto sum = 0.0f;
+   #endif
+
+    for (; i < num; ++i)
+      sum += a[i] * b[i];
+
+    return sum;
+  }
+
+  /* Turn per-hop energies into the half-wave rectified rise of their log, in place */
+  void energyToOnsets(std::vector<float>& energy) {
+    auto n = (int) energy.size();
+
+    for (auto& e : energy)
+      e = std::log1p(1000.0f * e);
+
+    for (int k = n - 1; k > 0; --k)
+      energy[(size_t) k] -= energy[(size_t) k - 1];
+
+    energy[0] = 0;
+    FloatVectorOperations::max(energy.data(), energy.data(), 0.0f, n);
+  }
+}
+
+//==============================================================================
+class TrackAnalyser::AnalysisJob : public ThreadPoolJob {
+public:
+  AnalysisJob(TrackAnalyser& _owner)
+            : ThreadPoolJob("Track analysis"),
+              owner(_owner)
+  {
+  }
+
+  /* Analyse the most urgent track until none are left */
+  JobStatus runJob() override {
+    File file;
+
+    while (!shouldExit() && owner.takeNextPending(file))
+      owner.analyseFile(file, *this);
+
+    return jobHasFinished;
+  }
+
+private:
+  TrackAnalyser& owner;
+};
+
+//==============================================================================
+/* Get the time of a beat, counted from the first beat */
+double TrackAnalyser::BeatGrid::getBeatTime(int beat) const {
+  return bpm > 0 ? firstBeatSeconds + beat * 60.0 / bpm : 0.0;
+}
+
+/* Get the number of beats in the track */
+int TrackAnalyser::BeatGrid::getNumBeats() const {
+  if (bpm <= 0 || lengthInSeconds <= firstBeatSeconds)
+    return 0;
+
+  return (int) ((lengthInSeconds - firstBeatSeconds) * bpm / 60.0) + 1;
+}
+
+//==============================================================================
+TrackAnalyser::TrackAnalyser()
+                           : resultDirectory(File::getSpecialLocation(File::userApplicationDataDirectory)
+                                               .getChildFile("audioMix").getChildFile("Analysis"),
+                                             ".json"),
+                             numThreads(jlimit(1, 4, SystemStats::getNumCpus() / 2)),
+                             analysisPool(numThreads)
+{
+  formatManager.registerBasicFormats();
+
+  weakThis = this;
+}
+
+TrackAnalyser::~TrackAnalyser() {
+  analysisPool.removeAllJobs(true, 10000);
+}
+
+/* Get the beat grid of a track, if it has been analysed already */
+bool TrackAnalyser::getBeatGrid(const File& file, BeatGrid& grid) {
+  const ScopedLock sl(lock);
+
+  auto it = results.find(keyFor(file));
+
+  if (it == results.end())
+    return false;
+
+  grid = it->second;
+  return true;
+}
+
+/* Analyse a track in the background, unless it has been already */
+void TrackAnalyser::requestAnalysis(const File& file, Priority priority) {
+  auto key = keyFor(file);
+
+  {
+    const ScopedLock sl(lock);
+
+    if (results.find(key) != results.end() || inProgress.find(key) != inProgress.end())
+      return;
+
+    auto it = pending.find(key);
+
+    if (it != pending.end()) {
+      if (priority <= it->second.priority)
+        return;
+
+      pendingOrder.erase({ -(int) it->second.priority, it->second.order, key });
+      it->second.priority = priority;
+    }
+    else {
+      pending[key] = { priority, ++requestCounter };
+    }
+
+    pendingOrder.insert({ -(int) priority, pending[key].order, key });
+
+    // the jobs running already will get to it
+    if (numJobs >= numThreads)
+      return;
+
+    ++numJobs;
+  }
+
+  analysisPool.addJob(new AnalysisJob(*this), true);
+}
+
+/* Use a beat grid that is known already */
+void TrackAnalyser::addKnownResult(const File& file, const BeatGrid& grid) {
+  const ScopedLock sl(lock);
+  results[keyFor(file)] = grid;
+}
+
+/* Forget the beat grid of a track that has changed */
+void TrackAnalyser::forgetResult(const File& file) {
+  const ScopedLock sl(lock);
+  results.erase(keyFor(file));
+}
+
+/* Tell the analyser whether any deck is playing */
+void TrackAnalyser::setPlaybackActive(bool isActive) {
+  playbackActive = isActive;
+}
+
+/* Get the number of tracks waiting to be analysed */
+int TrackAnalyser::getNumPending() {
+  const ScopedLock sl(lock);
+  return (int) pending.size();
+}
+
+void TrackAnalyser::addListener(Listener* listener) {
+  listeners.add(listener);
+}
+
+void TrackAnalyser::removeListener(Listener* listener) {
+  listeners.remove(listener);
+}
+
+/* Take the most urgent track off the list */
+bool TrackAnalyser::takeNextPending(File& file) {
+  const ScopedLock sl(lock);
+
+  if (pendingOrder.empty()) {
+    --numJobs;
+    return false;
+  }
+
+  auto key = std::get<2>(*pendingOrder.begin());
+  pendingOrder.erase(pendingOrder.begin());
+  pending.erase(key);
+  inProgress.insert(key);
+
+  file = File(key);
+  return true;
+}
+
+/* Load a track's stored result, or analyse the track and store it (analysis thread) */
+void TrackAnalyser::analyseFile(const File& file, ThreadPoolJob& job) {
+  auto key = keyFor(file);
+  auto resultFile = resultDirectory.getFileFor(file);
+
+  BeatGrid grid;
+  auto found = false;
+
+  // analysed in an earlier session
+  if (resultFile.existsAsFile()) {
+    auto stored = JSON::parse(resultFile);
+
+    if ((int) stored["version"] == analysisVersion) {
+      grid.bpm = stored["bpm"];
+      grid.firstBeatSeconds = stored["firstBeat"];
+      grid.lengthInSeconds = stored["length"];
+      found = true;
+    }
+  }
+
+  if (!found && file.existsAsFile()) {
+    std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+    if (reader != nullptr) {
+      auto holdsTurn = false;
+      auto chunkStart = Time::getMillisecondCounter();
+
+      found = analyse(*reader, grid, [&] {
+        if (playbackActive.load()) {
+          // while a deck is playing only one track is analysed at a time...
+          while (!holdsTurn && playbackActive.load()) {
+            auto expected = false;
+            holdsTurn = playbackTurnTaken.compare_exchange_strong(expected, true);
+
+            if (!holdsTurn) {
+              if (job.shouldExit())
+                return false;
+
+              Thread::sleep(50);
+            }
+          }
+
+          // ...and it rests as long as it worked, so that it takes at most half a core
+          Thread::sleep(jlimit(1, 200, (int) (Time::getMillisecondCounter() - chunkStart)));
+        }
+
+        chunkStart = Time::getMillisecondCounter();
+        return !job.shouldExit();
+      });
+
+      if (holdsTurn)
+        playbackTurnTaken = false;
+
+      if (found) {
+        auto* stored = new DynamicObject();
+        stored->setProperty("version", analysisVersion);
+        stored->setProperty("file", key);
+        stored->setProperty("bpm", grid.bpm);
+        stored->setProperty("firstBeat", grid.firstBeatSeconds);
+        stored->setProperty("length", grid.lengthInSeconds);
+
+        resultDirectory.getDirectory().createDirectory();
+
+        if (!resultFile.replaceWithText(JSON::toString(var(stored))))
+          DBG("TrackAnalyser::analyseFile - can't write " << resultFile.getFullPathName());
+      }
+    }
+  }
+
+  {
+    const ScopedLock sl(lock);
+    inProgress.erase(key);
+
+    if (found)
+      results[key] = grid;
+  }
+
+  if (!found)
+    return;
+
+  DBG("TrackAnalyser::analyseFile " << key << " " << grid.bpm << " bpm");
+
+  // tell the listeners on the message thread (if the analyser still exists by then)
+  MessageManager::callAsync([weakThis = weakThis, file] {
+    if (auto* analyser = weakThis.get())
+      analyser->listeners.call([&file](Listener& l) { l.trackAnalysed(file); });
+  });
+}
+
+/* Work out the beat grid of a track */
+bool TrackAnalyser::analyse(AudioFormatReader& reader, BeatGrid& grid, const std::function<bool()>& betweenChunks) {
+  grid = {};
+
+  if (reader.sampleRate <= 0 || reader.lengthInSamples <= 0)
+    return true;
+
+  grid.lengthInSeconds = reader.lengthInSamples / reader.sampleRate;
+
+  auto hop = jmax(1, roundToInt(reader.sampleRate * hopSeconds));
+  auto envelopeRate = reader.sampleRate / hop;
+  auto chunkSize = hop * hopsPerChunk;
+  auto numChannels = jlimit(1, 2, (int) reader.numChannels);
+
+  AudioBuffer<float> chunk(numChannels, chunkSize);
+  HeapBlock<float> low((size_t) chunkSize);
+
+  IIRFilter lowPass;
+  lowPass.setCoefficients(IIRCoefficients::makeLowPass(reader.sampleRate, lowBandHz));
+
+  // energy of every hop, over the whole band and over the low band
+  std::vector<float> fullOnsets, lowOnsets;
+  fullOnsets.reserve((size_t) (reader.lengthInSamples / hop));
+  lowOnsets.reserve((size_t) (reader.lengthInSamples / hop));
+
+  for (int64 pos = 0; reader.lengthInSamples - pos >= hop; pos += chunkSize) {
+    auto num = (int) jmin((int64) chunkSize, reader.lengthInSamples - pos);
+    num -= num % hop;
+
+    reader.read(&chunk, 0, num, pos, true, true);
+
+    auto* mono = chunk.getWritePointer(0);
+
+    if (numChannels > 1) {
+      FloatVectorOperations::add(mono, chunk.getReadPointer(1), num);
+      FloatVectorOperations::multiply(mono, 0.5f, num);
+    }
+
+    FloatVectorOperations::copy(low.get(), mono, num);
+    lowPass.processSamples(low.get(), num);
+
+    for (int i = 0; i < num; i += hop) {
+      fullOnsets.push_back(dotProduct(mono + i, mono + i, hop) / (float) hop);
+      lowOnsets.push_back(dotProduct(low.get() + i, low.get() + i, hop) / (float) hop);
+    }
+
+    if (!betweenChunks())
+      return false;
+  }
+
+  auto n = (int) fullOnsets.size();
+
+  if (n < minSeconds * envelopeRate || *std::max_element(fullOnsets.begin(), fullOnsets.end()) < 1.0e-8f)
+    return true;
+
+  // onset strength: rises in loudness, with the kick drum counted twice
+  energyToOnsets(fullOnsets);
+  energyToOnsets(lowOnsets);
+
+  std::vector<float> onsets((size_t) n);
+  FloatVectorOperations::copy(onsets.data(), fullOnsets.data(), n);
+  FloatVectorOperations::add(onsets.data(), lowOnsets.data(), n);
+
+  // tempo: the autocorrelation of the onsets (without their mean), favouring tempos near 120
+  double mean = 0;
+
+  for (auto o : onsets)
+    mean += o;
+
+  mean /= n;
+
+  std::vector<float> centred(onsets);
+  FloatVectorOperations::add(centred.data(), (float) -mean, n);
+
+  auto minLag = jmax(1, (int) std::floor(envelopeRate * 60.0 / maxBpm));
+  auto maxLag = (int) std::ceil(envelopeRate * 60.0 / minBpm);
+  auto numLags = jmin(2 * maxLag + 2, n);
+
+  std::vector<double> acf((size_t) numLags, 0.0);
+
+  for (int lag = 1; lag < numLags; ++lag)
+    acf[(size_t) lag] = dotProduct(centred.data(), centred.data() + lag, n - lag) / (double) (n - lag);
+
+  int bestLag = 0;
+  double bestScore = 0;
+
+  for (int lag = minLag; lag <= maxLag && 2 * lag < numLags; ++lag) {
+    auto octaves = std::log2(60.0 * envelopeRate / lag / preferredBpm);
+    auto score = std::exp(-0.5 * octaves * octaves) * (acf[(size_t) lag] + 0.5 * acf[(size_t) (2 * lag)]);
+
+    if (score > bestScore) {
+      bestScore = score;
+      bestLag = lag;
+    }
+  }
+
+  // nothing repeats
+  if (bestLag == 0)
+    return true;
+
+  // refine the period to a hundredth of a hop, and find the phase, by fitting a comb of
+  // beats to the (lightly smoothed) onsets over the whole track
+  std::vector<float> smoothed((size_t) n);
+
+  for (int k = 0; k < n; ++k)
+    smoothed[(size_t) k] = 0.5f * onsets[(size_t) k] + 0.25f * (onsets[(size_t) jmax(0, k - 1)] + onsets[(size_t) jmin(n - 1, k + 1)]);
+
+  double bestPeriod = bestLag, bestPhase = 0, bestComb = -1;
+
+  for (int step = -100; step <= 100; ++step) {
+    auto period = bestLag + step * 0.01;
+
+    for (int phase = 0; phase < (int) std::ceil(period); ++phase) {
+      double comb = 0;
+      int beats = 0;
+
+      for (auto t = (double) phase; t < n - 0.5; t += period, ++beats)
+        comb += smoothed[(size_t) (t + 0.5)];
+
+      comb /= jmax(1, beats);
+
+      if (comb > bestComb) {
+        bestComb = comb;
+        bestPeriod = period;
+        bestPhase = phase;
+      }
+    }
+  }
+
+  grid.bpm = 60.0 * envelopeRate / bestPeriod;
+  grid.firstBeatSeconds = bestPhase / envelopeRate;
+  return true;
+}
@@ -0,0 +1,210 @@
+/*
+  ==============================================================================
+
+    TrackAnalyser.h
+    Created: 24 Oct 2026 10:14:52am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CacheDirectory.h"
+#include <map>
+#include <set>
+#include <tuple>
+
+//==============================================================================
+/*
+    Works out the tempo and beat grid of library tracks in the background.
+
+    Tracks are analysed on a small pool of threads, highest priority first
+    (queued tracks, then rows on screen, then the rest of the library). Each
+    result is stored on disk, keyed like the PcmDiskCache, so a file is only
+    ever analysed once unless it changes. While a deck is playing, only one
+    track is analysed at a time and it pauses between chunks, so the analysis
+    leaves the CPU to the decks.
+
+    Use it through a SharedResourcePointer<TrackAnalyser>.
+*/
+class TrackAnalyser {
+public:
+  /**
+   * \brief
+   *    Tempo and beat positions of a track, assuming a constant tempo.
+   */
+  struct BeatGrid {
+    double bpm = 0;                 // 0 if no tempo was found (e.g. silence)
+    double firstBeatSeconds = 0;
+    double lengthInSeconds = 0;
+
+    /**
+     * \brief
+     *    Get the time of a beat, counted from the first beat.
+     */
+    double getBeatTime(int beat) const;
+
+    /**
+     * \brief
+     *    Get the number of beats in the track.
+     */
+    int getNumBeats() const;
+  };
+
+  // higher goes first
+  enum class Priority { library = 0, visible = 1, queued = 2 };
+
+  // bump when the analysis changes, so that old results are analysed again
+  static constexpr int analysisVersion = 1;
+
+  /**
+   * \brief
+   *    Receives a callback (on the message thread) whenever a track has been analysed.
+   */
+  class Listener {
+  public:
+    virtual ~Listener() = default;
+
+    /**
+     * \brief
+     *    Called on the message thread when a track's beat grid is available through getBeatGrid().
+     */
+    virtual void trackAnalysed(const File& file) = 0;
+  };
+
+  /**
+   * \brief
+   *    Constructor.
+   */
+  TrackAnalyser();
+
+  /**
+   * \brief
+   *    Destructor. Stops any analysis in progress.
+   */
+  ~TrackAnalyser();
+
+  /**
+   * \brief
+   *    Get the beat grid of a track, if it has been analysed (or loaded from disk) already.
+   *
+   * \param file
+   *    The track to look up
+   * \param grid
+   *    Set to the track's beat grid if there is one
+   *
+   * \return
+   *    true if the track has been analysed
+   */
+  bool getBeatGrid(const File& file, BeatGrid& grid);
+
+  /**
+   * \brief
+   *    Analyse a track in the background, unless it has been already. Asking again for a
+   *    track that is still waiting raises its priority.
+   *
+   * \param file
+   *    The track to analyse
+   * \param priority
+   *    How soon it should be analysed
+   */
+  void requestAnalysis(const File& file, Priority priority = Priority::library);
+
+  /**
+   * \brief
+   *    Use a beat grid that is known already (e.g. from the library index), so that the
+   *    track is neither analysed nor looked up on disk.
+   *
+   * \param file
+   *    The track the beat grid belongs to
+   * \param grid
+   *    The track's beat grid
+   */
+  void addKnownResult(const File& file, const BeatGrid& grid);
+
+  /**
+   * \brief
+   *    Forget the beat grid of a track that has changed, so that asking for it again
+   *    analyses the new version.
+   */
+  void forgetResult(const File& file);
+
+  /**
+   * \brief
+   *    Tell the analyser whether any deck is playing, so that it can step back.
+   */
+  void setPlaybackActive(bool isActive);
+
+  /**
+   * \brief
+   *    Get the number of tracks waiting to be analysed.
+   */
+  int getNumPending();
+
+  void addListener(Listener* listener);
+  void removeListener(Listener* listener);
+
+private:
+  class AnalysisJob;
+
+  struct Pending {
+    Priority priority;
+    uint64 order;
+  };
+
+  /**
+   * \brief
+   *    Take the most urgent track off the list. Called by the analysis jobs.
+   *
+   * \return
+   *    false if there is nothing left to analyse
+   */
+  bool takeNextPending(File& file);
+
+  /**
+   * \brief
+   *    Load a track's stored result, or analyse the track and store it. Runs on an analysis thread.
+   */
+  void analyseFile(const File& file, ThreadPoolJob& job);
+
+  /**
+   * \brief
+   *    Work out the beat grid of a track, calling betweenChunks after each chunk of audio.
+   *
+   * \return
+   *    false if betweenChunks asked to stop
+   */
+  static bool analyse(AudioFormatReader& reader, BeatGrid& grid, const std::function<bool()>& betweenChunks);
+
+  static String keyFor(const File& file) { return file.getFullPathName(); }
+
+  CacheDirectory resultDirectory;
+  const int numThreads;
+
+  AudioFormatManager formatManager;
+
+  CriticalSection lock;
+  std::map<String, BeatGrid> results;
+  std::map<String, Pending> pending;
+  std::set<std::tuple<int, uint64, String>> pendingOrder; // (-priority, order, key)
+  std::set<String> inProgress;
+  uint64 requestCounter = 0;
+  int numJobs = 0;
+
+  std::atomic<bool> playbackActive{ false };
+  std::atomic<bool> playbackTurnTaken{ false };
+
+  ListenerList<Listener> listeners;
+
+  // copied by the analysis threads to call back on the message thread. Made once in the constructor,
+  // because the first WeakReference to an object creates its shared pointer without a lock
+  WeakReference<TrackAnalyser> weakThis;
+
+  // declared last so that it is destroyed first
+  ThreadPool analysisPool;
+
+  JUCE_DECLARE_WEAK_REFERENCEABLE(TrackAnalyser)
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackAnalyser)
+};
@@ -16,23 +16,43 @@ class TrackInfo {
   /**
    * \brief 
    *     Constructor. Takes in a File and initialises the other variables.
+   *     The length is unknown until setLength() is called (see LibraryScanner).
    */
   TrackInfo(File _file);
 
+  /**
+   * \brief
+   *    Set the length of the track once it has been read.
+   *
+   * \param seconds
+   *    Length of the track in seconds, or 0 if the file could not be read
+   */
+  void setLength(double seconds);
+
+  /**
+   * \brief
+   *    Checks whether the length of the track has been read yet.
+   */
+  bool hasLength() const { return lengthInSeconds >= 0; }
+
+  uint32 id = 0; // ID of the track in the TrackStore, 0 if it isn't in it
   File file;
   std::string trackTitle; // Title of the track
   std::string trackLength; // Length of the track
+  double lengthInSeconds = -1; // Length of the track in seconds, negative until it has been read
+  int64 fileSize = -1; // Size of the file when its length was read
+  int64 modificationTime = 0; // Modification time (in milliseconds) of the file when its length was read
 
  private:
   /**
   * \brief
-  *    Calculates the length of the track and returns it in minutes:seconds format
+  *    Formats a length in minutes:seconds format
   *
-  * \param trackFile
-  *    The file to be used to get the length of
+  * \param lengthInSecs
+  *    The length in whole seconds
   *
   * \return
   *    Length of the track in minutes:seconds format
   */
-  std::string getTrackLength(File file);
+  static std::string formatLength(int lengthInSecs);
 };
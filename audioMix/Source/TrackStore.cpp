@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    TrackStore.cpp
+    Created: 29 Oct 2026 10:26:05am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "TrackStore.h"
+
+//==============================================================================
+TrackStore::TrackStore() {
+}
+
+TrackStore::~TrackStore() {
+}
+
+/* Add a track to the end of the library, unless it is in it already */
+TrackStore::TrackId TrackStore::add(const File& file) {
+  auto key = keyFor(file);
+
+  if (idsByPath.find(key) != idsByPath.end())
+    return 0;
+
+  TrackInfo track{ file };
+  track.id = ++lastId;
+
+  positions[track.id] = tracks.size();
+  idsByPath[key] = track.id;
+  searchIndex.add(track.id, file.getFileNameWithoutExtension());
+  tracks.push_back(track);
+
+  return track.id;
+}
+
+/* Get the ID of the track for a file */
+TrackStore::TrackId TrackStore::getId(const File& file) const {
+  auto it = idsByPath.find(keyFor(file));
+  return it != idsByPath.end() ? it->second : 0;
+}
+
+/* Get a track by ID */
+TrackInfo* TrackStore::getTrack(TrackId id) {
+  auto it = positions.find(id);
+  return it != positions.end() ? &tracks[it->second] : nullptr;
+}
+
+/* Make room for a number of tracks */
+void TrackStore::reserve(int numTracks) {
+  tracks.reserve((size_t) numTracks);
+}
+
+/* Remove tracks from the library */
+void TrackStore::remove(const std::vector<TrackId>& ids) {
+  auto numRemoved = 0;
+
+  for (auto id : ids) {
+    auto it = positions.find(id);
+
+    if (it == positions.end())
+      continue;
+
+    idsByPath.erase(keyFor(tracks[it->second].file));
+    positions.erase(it);
+    ++numRemoved;
+  }
+
+  if (numRemoved == 0)
+    return;
+
+  searchIndex.remove(ids);
+
+  // one pass to close the gaps, however many tracks were removed
+  tracks.erase(std::remove_if(tracks.begin(), tracks.end(), [this](const TrackInfo& track) {
+    return positions.find(track.id) == positions.end();
+  }), tracks.end());
+
+  for (size_t i = 0; i < tracks.size(); ++i)
+    positions[tracks[i].id] = i;
+}
+
+/* Remove all tracks from the library */
+void TrackStore::clear() {
+  tracks.clear();
+  positions.clear();
+  idsByPath.clear();
+  searchIndex.clear();
+}
@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    TrackStore.h
+    Created: 29 Oct 2026 10:26:05am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+#include "TrackInfo.h"
+#include "SearchIndex.h"
+
+//==============================================================================
+/*
+    The one copy of every library track's information.
+
+    Every track is given an ID when it is added, which is never reused, so
+    search results and the queue can refer to tracks by ID rather than
+    keeping copies of them, and a track that has been removed is simply not
+    found any more. Tracks are kept in library order and can also be looked
+    up by file, so checking for duplicates doesn't walk the whole library.
+    Titles are kept in a SearchIndex as tracks come and go, so searching
+    doesn't walk it either.
+
+    Only used on the message thread. Use it through a
+    SharedResourcePointer<TrackStore>.
+*/
+class TrackStore {
+public:
+  // 0 is never the ID of a track
+  using TrackId = SearchIndex::TrackId;
+
+  /**
+   * \brief
+   *    Constructor.
+   */
+  TrackStore();
+
+  /**
+   * \brief
+   *    Destructor.
+   */
+  ~TrackStore();
+
+  /**
+   * \brief
+   *    Add a track to the end of the library, unless it is in it already.
+   *
+   * \return
+   *    The ID of the new track, or 0 if the file is in the library already
+   */
+  TrackId add(const File& file);
+
+  /**
+   * \brief
+   *    Get the ID of the track for a file.
+   *
+   * \return
+   *    The track's ID, or 0 if the file isn't in the library
+   */
+  TrackId getId(const File& file) const;
+
+  /**
+   * \brief
+   *    Get a track by ID.
+   *
+   * \return
+   *    The track, or nullptr if it has been removed
+   */
+  TrackInfo* getTrack(TrackId id);
+
+  /**
+   * \brief
+   *    Get a track by its position in the library.
+   */
+  TrackInfo& getTrackAt(int index) { return tracks[(size_t) index]; }
+
+  /**
+   * \brief
+   *    Get the number of tracks in the library.
+   */
+  int size() const { return (int) tracks.size(); }
+
+  bool isEmpty() const { return tracks.empty(); }
+
+  /**
+   * \brief
+   *    Make room for a number of tracks, before adding a whole library.
+   */
+  void reserve(int numTracks);
+
+  /**
+   * \brief
+   *    Remove tracks from the library.
+   *
+   * \param ids
+   *    IDs of the tracks to remove (IDs that aren't found are ignored)
+   */
+  void remove(const std::vector<TrackId>& ids);
+
+  /**
+   * \brief
+   *    Remove all tracks from the library.
+   */
+  void clear();
+
+  /**
+   * \brief
+   *    Find the tracks whose title contains a keyword, ignoring case.
+   *
+   * \return
+   *    IDs of the matching tracks, in library order (valid until the library or the keyword changes)
+   */
+  const std::vector<TrackId>& search(const String& keyword) { return searchIndex.search(keyword); }
+
+  std::vector<TrackInfo>::iterator begin() { return tracks.begin(); }
+  std::vector<TrackInfo>::iterator end() { return tracks.end(); }
+
+private:
+  static String keyFor(const File& file) { return file.getFullPathName(); }
+
+  std::vector<TrackInfo> tracks;
+  std::map<TrackId, size_t> positions;    // index into tracks of each ID
+  std::map<String, TrackId> idsByPath;
+  TrackId lastId = 0;
+
+  SearchIndex searchIndex;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackStore)
+};
@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    WaveformCache.cpp
+    Created: 26 Oct 2026 10:02:18am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "WaveformCache.h"
+
+//==============================================================================
+WaveformCache::WaveformCache()
+                           : cacheDirectory(File::getSpecialLocation(File::userApplicationDataDirectory)
+                                              .getChildFile("audioMix").getChildFile("Waveforms"),
+                                            ".wave",
+                                            (int64) 1024 * 1024 * 1024) // 1 GB
+{
+  weakThis = this;
+}
+
+WaveformCache::~WaveformCache() {
+  overviewPool.removeAllJobs(true, 10000);
+}
+
+/* Read the cached coarse levels of a track */
+std::shared_ptr<WaveformPyramid> WaveformCache::loadPyramid(const File& file) {
+  auto cacheFile = cacheDirectory.getFileFor(file);
+
+  if (!cacheFile.existsAsFile())
+    return nullptr;
+
+  // one read for the whole entry, then parse it from memory
+  MemoryBlock data;
+
+  if (!cacheFile.loadFileAsData(data))
+    return nullptr;
+
+  MemoryInputStream in(data, false);
+  char magic[4] = {};
+
+  // reject anything that doesn't match the source file exactly
+  if (in.read(magic, 4) != 4
+        || std::memcmp(magic, "AMWC", 4) != 0
+        || in.readInt() != currentVersion
+        || in.readInt64() != file.getSize()
+        || in.readInt64() != file.getLastModificationTime().toMilliseconds())
+    return nullptr;
+
+  auto pyramid = WaveformPyramid::readFrom(in);
+
+  if (pyramid == nullptr)
+    return nullptr;
+
+  cacheDirectory.markUsed(cacheFile);
+  keepOverview(file, *pyramid);
+
+  return pyramid;
+}
+
+/* Store the coarse levels of a track's pyramid */
+void WaveformCache::storePyramid(const File& file, const WaveformPyramid& pyramid) {
+  if (!pyramid.isComplete() || !file.existsAsFile())
+    return;
+
+  // two decks may store the same track at once; each writes a temporary file of its own
+  auto written = cacheDirectory.writeEntry(cacheDirectory.getFileFor(file), [&file, &pyramid](FileOutputStream& out) {
+    out.write("AMWC", 4);
+    out.writeInt(currentVersion);
+    out.writeInt64(file.getSize());
+    out.writeInt64(file.getLastModificationTime().toMilliseconds());
+
+    return pyramid.createOverview(storedSamplesPerBin)->writeTo(out);
+  });
+
+  if (!written)
+    return;
+
+  cacheDirectory.evictIfNeeded();
+  keepOverview(file, pyramid);
+}
+
+/* Set the maximum total size of the cache directory */
+void WaveformCache::setMaxCacheSize(int64 bytes) {
+  cacheDirectory.setMaxSize(bytes);
+}
+
+/* Get the overview of a track for a library row */
+std::shared_ptr<const WaveformPyramid> WaveformCache::getOverview(const File& file) {
+  auto key = file.getFullPathName();
+
+  {
+    const ScopedLock sl(overviewLock);
+    auto it = overviews.find(key);
+
+    if (it != overviews.end())
+      return it->second;
+
+    // each track is looked up once: one that isn't cached gets its overview when a deck draws it
+    if (!overviewsRequested.insert(key).second)
+      return nullptr;
+  }
+
+  overviewPool.addJob([this, file] { loadPyramid(file); });
+  return nullptr;
+}
+
+void WaveformCache::addListener(Listener* listener) {
+  listeners.add(listener);
+}
+
+void WaveformCache::removeListener(Listener* listener) {
+  listeners.remove(listener);
+}
+
+/* Keep the overview of a complete pyramid in memory, and tell the listeners */
+void WaveformCache::keepOverview(const File& file, const WaveformPyramid& pyramid) {
+  std::shared_ptr<const WaveformPyramid> overview = pyramid.createOverview(overviewSamplesPerBin);
+
+  {
+    const ScopedLock sl(overviewLock);
+    overviews[file.getFullPathName()] = overview;
+    overviewsRequested.insert(file.getFullPathName());
+  }
+
+  // tell the listeners on the message thread (if the cache still exists by then)
+  MessageManager::callAsync([weakThis = weakThis, file] {
+    if (auto* cache = weakThis.get())
+      cache->listeners.call([&file](Listener& l) { l.overviewAvailable(file); });
+  });
+}
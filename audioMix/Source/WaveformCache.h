@@ -0,0 +1,155 @@
+/*
+  ==============================================================================
+
+    WaveformCache.h
+    Created: 26 Oct 2026 10:02:18am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "WaveformPyramid.h"
+#include "CacheDirectory.h"
+#include <map>
+#include <set>
+
+//==============================================================================
+/*
+    A cache directory of the coarse levels of waveform pyramids, so that a
+    track that has been drawn once is drawn zoomed out straight away on every
+    later load (even after a restart). Only the levels of storedSamplesPerBin
+    samples per peak and up are stored, which is a few tens of KB for a
+    typical track rather than the many MB of the whole pyramid; the finer
+    levels are built again when a deck loads the track.
+
+    Each cache file is a short header naming the source file's size and
+    modification time, followed by the coarse pyramid, and is read back with
+    a single read. Entries are keyed by the source file's path, size and
+    modification time, so a changed file is never drawn from a stale entry.
+    The least recently used entries are deleted once the directory grows
+    past its size cap.
+
+    The cache also keeps a small overview (only the coarsest levels) of every
+    track it has read or stored, in memory, for drawing library rows. A row
+    whose overview isn't in memory yet asks for it with getOverview(), which
+    reads the entry in the background and tells the listeners when it is
+    ready.
+
+    Use it through a SharedResourcePointer<WaveformCache>.
+*/
+class WaveformCache {
+public:
+  // samples per peak at the finest level stored on disk
+  static constexpr int storedSamplesPerBin = 4096;
+
+  // samples per peak at the finest level of the overviews kept for library rows
+  static constexpr int overviewSamplesPerBin = 65536;
+
+  /**
+   * \brief
+   *    Receives a callback (on the message thread) whenever a track's overview is available.
+   */
+  class Listener {
+  public:
+    virtual ~Listener() = default;
+
+    /**
+     * \brief
+     *    Called on the message thread when getOverview() has the overview of a track.
+     */
+    virtual void overviewAvailable(const File& file) = 0;
+  };
+
+  /**
+   * \brief
+   *    Constructor. Uses a "Waveforms" folder in the application data directory.
+   */
+  WaveformCache();
+
+  /**
+   * \brief
+   *    Destructor. Waits for any overview being read.
+   */
+  ~WaveformCache();
+
+  /**
+   * \brief
+   *    Read the cached coarse levels of a track. Reads from disk, so keep it off the message thread.
+   *
+   * \param file
+   *    The source audio file
+   *
+   * \return
+   *    A complete pyramid of the levels of storedSamplesPerBin samples per peak and up,
+   *    or nullptr if the file isn't cached or has changed since
+   */
+  std::shared_ptr<WaveformPyramid> loadPyramid(const File& file);
+
+  /**
+   * \brief
+   *    Store the coarse levels of a track's pyramid. Writes to disk, so keep it off the message thread.
+   *
+   * \param file
+   *    The source audio file
+   * \param pyramid
+   *    The track's whole pyramid, which must be complete
+   */
+  void storePyramid(const File& file, const WaveformPyramid& pyramid);
+
+  /**
+   * \brief
+   *    Set the maximum total size of the cache directory.
+   *
+   * \param bytes
+   *    The size cap in bytes
+   */
+  void setMaxCacheSize(int64 bytes);
+
+  /**
+   * \brief
+   *    Get the overview of a track for a library row. Call on the message thread.
+   *
+   * \param file
+   *    The source audio file
+   *
+   * \return
+   *    The overview, or nullptr if it isn't in memory. If the track is cached, it is then
+   *    read in the background and the listeners are told once it is available
+   */
+  std::shared_ptr<const WaveformPyramid> getOverview(const File& file);
+
+  void addListener(Listener* listener);
+  void removeListener(Listener* listener);
+
+private:
+  /**
+   * \brief
+   *    Keep the overview of a complete pyramid in memory, and tell the listeners.
+   */
+  void keepOverview(const File& file, const WaveformPyramid& pyramid);
+
+  // bump when the layout of an entry changes
+  static constexpr int currentVersion = 2;
+
+  CacheDirectory cacheDirectory;
+
+  // overviews by the source file's path, and the paths that have been looked up already
+  CriticalSection overviewLock;
+  std::map<String, std::shared_ptr<const WaveformPyramid>> overviews;
+  std::set<String> overviewsRequested;
+
+  ListenerList<Listener> listeners;
+
+  // copied by the threads that keep overviews, to call back on the message thread. Made once in the
+  // constructor, because the first WeakReference to an object creates its shared pointer without a lock
+  WeakReference<WaveformCache> weakThis;
+
+  // reads overviews one at a time (declared last so that it is destroyed first)
+  ThreadPool overviewPool{ 1 };
+
+  JUCE_DECLARE_WEAK_REFERENCEABLE(WaveformCache)
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformCache)
+};
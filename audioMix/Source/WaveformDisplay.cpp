@@ -11,72 +11,317 @@
 #include <JuceHeader.h>
 #include "WaveformDisplay.h"
 
+namespace {
+  // samples of a decoded track added between checks for a newer load
+  constexpr int decodedBlockSize = 65536;
+
+  // weight of the latest paint in the smoothed paint times
+  constexpr double smoothing = 0.1;
+}
+
 //==============================================================================
-WaveformDisplay::WaveformDisplay(AudioFormatManager& formatManagerToUse,
-                                 AudioThumbnailCache& cacheToUse)
-                               : audioThumb(1000, formatManagerToUse, cacheToUse),
+WaveformDisplay::WaveformDisplay(AudioFormatManager& formatManagerToUse)
+                               : formatManager(formatManagerToUse),
                                  fileLoaded(false),
                                  position(0)
 {
-  audioThumb.addChangeListener(this);
 }
 
 WaveformDisplay::~WaveformDisplay() {
+  // stop any build in progress
+  ++loadGeneration;
+  stopTimer();
 }
 
 /* Drawing of the component */
 void WaveformDisplay::paint(juce::Graphics& g) {
-  g.fillAll(Colour{ 0xFF580C1F }); // background
-  g.setColour(Colour{ 0xFF9AD2CB }); // set outline colour
-  g.drawRect(getLocalBounds(), 1); // draw an outline around the component
+  auto start = Time::getHighResolutionTicks();
 
-  g.setColour(Colour{ 0xFFF2E5D7 }); // set text and waveform colour
+  if (fileLoaded && pyramid != nullptr) {
+    auto visible = getVisibleSamples();
 
-  if (fileLoaded) {
-      // draw the waveform
-      audioThumb.drawChannel(g,
-                             getLocalBounds(), // how much of g to draw
-                             0, // start time 
-                             audioThumb.getTotalLength(),  // end time (end of the track)
-                             0, // channel 0
-                             1.0f); // vertical zoom factor
+    if (layerDirty || visible != layerRange || waveformLayer.getWidth() != getWidth()
+          || waveformLayer.getHeight() != getHeight())
+      renderLayer(visible);
+
+    // only the clipped area of the layer is copied, which is just the playhead's strip while playing
+    g.drawImageAt(waveformLayer, 0, 0);
 
     // playhead rectangle outline
     g.setColour(Colours::red);
-    g.drawRect(position * getWidth(), 0, getWidth() / 28, getHeight(), 2);
+    g.drawRect(getPlayheadBounds(visible), 2);
   }
 
   else {
+    g.fillAll(Colour{ 0xFF580C1F }); // background
+    g.setColour(Colour{ 0xFF9AD2CB }); // set outline colour
+    g.drawRect(getLocalBounds(), 1); // draw an outline around the component
+
     g.setFont(15.0f); // font size
     g.setColour(Colours::white);
     g.drawText("Waveform not loaded", getLocalBounds(), Justification::centred, true);   // draw some placeholder text
   }
+
+  auto micros = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1.0e6;
+  paintStats.paintMicros += (micros - paintStats.paintMicros) * smoothing;
+  ++paintStats.paints;
+}
+
+/* Redraws the waveform layer at the new size */
+void WaveformDisplay::resized() {
+  layerDirty = true;
+}
+
+/* Zooms in or out around the playhead */
+void WaveformDisplay::mouseWheelMove(const MouseEvent& event, const MouseWheelDetails& wheel) {
+  if (pyramid == nullptr || getWidth() <= 0)
+    return;
+
+  // no closer than one peak of the finest level per pixel
+  auto maxZoom = jmax(1.0, pyramid->getLengthInSamples() / ((double) WaveformPyramid::baseSamplesPerBin * getWidth()));
+
+  zoom = jlimit(1.0, maxZoom, zoom * std::pow(2.0, wheel.deltaY * 4.0));
+  layerDirty = true;
+  repaint();
+
+  // zoomed in past the cached levels: only now is the track decoded for the fine ones
+  if (onlyCoarseLevels && pyramid->getLengthInSamples() / (zoom * getWidth()) < WaveformCache::storedSamplesPerBin) {
+    onlyCoarseLevels = false;
+
+    SafePointer<WaveformDisplay> safeThis(this);
+    auto generation = loadGeneration.load();
+    auto audioURL = loadedURL;
+
+    buildPool.addJob([this, safeThis, generation, audioURL] { buildPyramid(safeThis, audioURL, generation, true); });
+  }
 }
 
-/* For receiving the callback */
-void WaveformDisplay::changeListenerCallback(ChangeBroadcaster* source) {
+/* Zooms back out to the whole track */
+void WaveformDisplay::mouseDoubleClick(const MouseEvent& event) {
+  zoom = 1.0;
+  layerDirty = true;
   repaint();
 }
 
 /* Allows the WaveformDisplay to be told to load a file */
 void WaveformDisplay::loadURL(URL audioURL) {
-  audioThumb.clear();
-  fileLoaded = audioThumb.setSource(new URLInputSource(audioURL));
+  // a newer load stops the build of the previous track
+  auto generation = ++loadGeneration;
+  buildPool.removeAllJobs(false, 0);
+
+  pyramid = nullptr;
+  loadedURL = audioURL;
+  onlyCoarseLevels = false;
+  fileLoaded = false;
+  zoom = 1.0;
+  layerDirty = true;
+  repaint();
 
-  if (fileLoaded) {
-    DBG("WaveformDisplay::loadURL " << audioURL.toString(true) << " loaded");
-    repaint(); // waveform drawn only after calling repaint
+  SafePointer<WaveformDisplay> safeThis(this);
+
+  buildPool.addJob([this, safeThis, generation, audioURL] {
+    if (loadGeneration != generation)
+      return;
+
+    auto file = audioURL.isLocalFile() ? audioURL.getLocalFile() : File();
+
+    // a track drawn before has its coarse levels cached, so it is drawn zoomed out without any decoding
+    if (auto cached = file != File() ? waveformCache->loadPyramid(file) : nullptr) {
+      handOver(safeThis, generation, cached, true);
+      return;
+    }
+
+    buildPyramid(safeThis, audioURL, generation, false);
+  });
+}
+
+/* Build the whole pyramid of a track on the build thread */
+void WaveformDisplay::buildPyramid(SafePointer<WaveformDisplay> safeThis, URL audioURL, int generation, bool replacesCached) {
+  if (loadGeneration != generation)
+    return;
+
+  auto shouldContinue = [this, generation] { return loadGeneration == generation; };
+  auto file = audioURL.isLocalFile() ? audioURL.getLocalFile() : File();
+
+  // tracks that are already decoded are drawn from memory instead of being read again
+  auto decoded = file != File() ? trackCache->getTrack(file) : nullptr;
+  std::unique_ptr<AudioFormatReader> reader;
+  std::shared_ptr<WaveformPyramid> newPyramid;
+
+  if (decoded != nullptr) {
+    newPyramid = std::make_shared<WaveformPyramid>(decoded->getNumChannels(),
+                                                   trackCache->getSampleRate(file),
+                                                   decoded->getNumSamples());
   }
   else {
-    DBG("WaveformDisplay::loadURL not loaded");
+    reader.reset(formatManager.createReaderFor(audioURL.createInputStream(false)));
+
+    if (reader != nullptr)
+      newPyramid = std::make_shared<WaveformPyramid>((int) reader->numChannels, reader->sampleRate,
+                                                     reader->lengthInSamples);
   }
+
+  // a new track is drawn as it is built; the cached levels stay on screen until it is complete
+  if (!replacesCached)
+    handOver(safeThis, generation, newPyramid, false);
+
+  if (newPyramid == nullptr)
+    return;
+
+  if (decoded != nullptr) {
+    for (int pos = 0; pos < decoded->getNumSamples(); pos += decodedBlockSize) {
+      if (!shouldContinue())
+        return;
+
+      newPyramid->addBlock(*decoded, pos, jmin(decodedBlockSize, decoded->getNumSamples() - pos));
+    }
+
+    newPyramid->finish();
+  }
+  else if (!newPyramid->addReader(*reader, shouldContinue)) {
+    return;
+  }
+
+  if (replacesCached)
+    handOver(safeThis, generation, newPyramid, false);
+  else if (file != File())
+    waveformCache->storePyramid(file, *newPyramid);
+}
+
+/* Put a pyramid on screen from the build thread */
+void WaveformDisplay::handOver(SafePointer<WaveformDisplay> safeThis, int generation,
+                               std::shared_ptr<WaveformPyramid> newPyramid, bool onlyCoarseLevels)
+{
+  MessageManager::callAsync([safeThis, generation, newPyramid, onlyCoarseLevels] {
+    auto* display = safeThis.getComponent();
+
+    if (display == nullptr || display->loadGeneration != generation)
+      return;
+
+    display->pyramid = newPyramid;
+    display->onlyCoarseLevels = onlyCoarseLevels;
+    display->fileLoaded = newPyramid != nullptr;
+    display->layerDirty = true;
+
+    if (display->fileLoaded) {
+      DBG("WaveformDisplay::loadURL " << display->loadedURL.toString(true) << " loaded");
+      display->startTimerHz(10);
+    }
+    else {
+      DBG("WaveformDisplay::loadURL not loaded");
+    }
+
+    display->repaint();
+  });
 }
 
 /* Set the relative position of the playhead */
 void WaveformDisplay::setPositionRelative(double pos) {
-  // update whenever the positiion is changed 
-  if (pos != position && pos > 0) {
+  // update whenever the positiion is changed
+  if (pos == position || pos <= 0)
+    return;
+
+  if (!fileLoaded || pyramid == nullptr) {
     position = pos;
+    return;
+  }
+
+  auto oldVisible = getVisibleSamples();
+  auto oldBounds = getPlayheadBounds(oldVisible);
+
+  position = pos;
+
+  auto visible = getVisibleSamples();
+
+  // while the same part of the track is on screen, only the playhead has to be redrawn
+  if (visible == oldVisible) {
+    auto bounds = getPlayheadBounds(visible);
+
+    if (bounds != oldBounds) {
+      repaint(oldBounds);
+      repaint(bounds);
+    }
+  }
+  else {
     repaint();
   }
 }
+
+/* Repaints while the pyramid is being built */
+void WaveformDisplay::timerCallback() {
+  if (pyramid == nullptr || pyramid->isComplete())
+    stopTimer();
+
+  layerDirty = true;
+  repaint();
+}
+
+/* Get the range of samples on screen at the current zoom */
+juce::Range<double> WaveformDisplay::getVisibleSamples() const {
+  auto length = (double) pyramid->getLengthInSamples();
+  auto numVisible = length / zoom;
+
+  // around the playhead, moving a quarter of the screen at a time so that the layer
+  // is only redrawn every so often, and never past either end of the track
+  auto step = numVisible * 0.25;
+  auto start = std::round((position * length - numVisible * 0.5) / step) * step;
+
+  start = jlimit(0.0, length - numVisible, start);
+
+  return { start, start + numVisible };
+}
+
+/* Get the area the playhead covers when the given range is on screen */
+Rectangle<int> WaveformDisplay::getPlayheadBounds(juce::Range<double> visible) const {
+  auto playhead = visible.getLength() > 0 ? (position * pyramid->getLengthInSamples() - visible.getStart()) / visible.getLength()
+                                          : 0.0;
+
+  return { roundToInt(playhead * getWidth()), 0, getWidth() / 28, getHeight() };
+}
+
+/* Draw the waveform of a range of the track into the layer */
+void WaveformDisplay::renderLayer(juce::Range<double> visible) {
+  auto start = Time::getHighResolutionTicks();
+  auto width = getWidth();
+  auto height = getHeight();
+
+  if (waveformLayer.getWidth() != width || waveformLayer.getHeight() != height)
+    waveformLayer = Image(Image::RGB, jmax(1, width), jmax(1, height), false);
+
+  Graphics g(waveformLayer);
+
+  g.fillAll(Colour{ 0xFF580C1F }); // background
+  g.setColour(Colour{ 0xFF9AD2CB }); // set outline colour
+  g.drawRect(getLocalBounds(), 1); // draw an outline around the component
+
+  const Colour waveformColour{ 0xFFF2E5D7 };
+  auto centre = height * 0.5f;
+
+  peaks.resize((size_t) jmax(0, width));
+  pyramid->getPeaks(0, visible.getStart(), visible.getEnd(), peaks.data(), width);
+
+  // draw the waveform column by column, coloured by its bands: red for the lows (kicks and
+  // bass), green for the mids and blue for the highs. The peaks go first and the RMS level
+  // over them in a lighter shade
+  for (int x = 0; x < width; ++x) {
+    auto& peak = peaks[(size_t) x];
+    auto strongest = jmax(peak.low, peak.mid, peak.high);
+
+    auto colour = strongest > 0 ? Colour::fromFloatRGBA(peak.low / strongest, peak.mid / strongest, peak.high / strongest, 1.0f)
+                                    .interpolatedWith(waveformColour, 0.25f)
+                                : waveformColour;
+
+    g.setColour(colour);
+    g.drawVerticalLine(x, centre - peak.max * centre, centre - peak.min * centre + 1.0f);
+
+    g.setColour(colour.brighter(0.6f));
+    g.drawVerticalLine(x, centre - peak.rms * centre, centre + peak.rms * centre + 1.0f);
+  }
+
+  layerRange = visible;
+  layerDirty = false;
+
+  auto micros = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1.0e6;
+  paintStats.layerMicros += (micros - paintStats.layerMicros) * smoothing;
+  ++paintStats.layerRenders;
+}
@@ -11,23 +11,48 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "DecodedTrackCache.h"
+#include "WaveformCache.h"
+#include "WaveformPyramid.h"
 
 //==============================================================================
 /*
+    Draws a track's waveform from a WaveformPyramid, each column coloured by
+    how much low, mid and high frequency energy it has. The pyramid is built
+    in the background when a track is loaded and drawn as far as it has got.
+    A track that has been drawn before is drawn from the coarse levels kept
+    in the WaveformCache without decoding it, and its whole pyramid is only
+    built once it is zoomed in past them; any other has its coarse levels
+    stored in the cache once it is built. The mouse wheel zooms in around the playhead and a
+    double-click zooms back out to the whole track.
+
+    The waveform is drawn once into an image layer, which is only redrawn
+    when the track, size, zoom or visible range changes. A moving playhead
+    only repaints the strip it left and the strip it moved to.
 */
 class WaveformDisplay : public juce::Component,
-                        public ChangeListener
+                        private Timer
 {
 public:
   /**
-   * \brief 
+   * \brief
+   *    Time spent painting, for the performance view. Message thread only.
+   */
+  struct PaintStats {
+    double paintMicros = 0;     // smoothed time per paint
+    double layerMicros = 0;     // smoothed time per redraw of the waveform layer
+    int64 paints = 0;
+    int64 layerRenders = 0;
+  };
+
+  /**
+   * \brief
    *     Constructor.
    */
-  WaveformDisplay(AudioFormatManager& formatManagerToUse,
-                  AudioThumbnailCache& cacheToUse);
+  WaveformDisplay(AudioFormatManager& formatManagerToUse);
 
   /**
-   * \brief 
+   * \brief
    *     Destructor.
    */
   ~WaveformDisplay();
@@ -42,13 +67,22 @@ public:
   void paint(juce::Graphics&) override;
 
   /**
-   * \brief 
-   *     For receiving the callback.
-   * 
-   * \param source
-   *     The ChangeBroadcaster that triggered the callback
+   * \brief
+   *    Redraws the waveform layer at the new size.
+   */
+  void resized() override;
+
+  /**
+   * \brief
+   *    Zooms in or out around the playhead.
+   */
+  void mouseWheelMove(const MouseEvent& event, const MouseWheelDetails& wheel) override;
+
+  /**
+   * \brief
+   *    Zooms back out to the whole track.
    */
-  void changeListenerCallback(ChangeBroadcaster* source) override;
+  void mouseDoubleClick(const MouseEvent& event) override;
 
   /**
    * \brief
@@ -60,16 +94,97 @@ public:
   void loadURL(URL audioURL);
 
   /**
-   * \brief 
+   * \brief
    *     Set the relative position of the playhead.
-   * 
+   *
    * \param pos
    *     The updated position to be set to
    */
   void setPositionRelative(double pos);
 
+  /**
+   * \brief
+   *    Get the time spent painting so far.
+   */
+  const PaintStats& getPaintStats() const { return paintStats; }
+
 private:
-  AudioThumbnail audioThumb;
+  /**
+   * \brief
+   *    Repaints while the pyramid is being built.
+   */
+  void timerCallback() override;
+
+  /**
+   * \brief
+   *    Build the whole pyramid of a track on the build thread.
+   *
+   * \param safeThis
+   *    The display, created on the message thread
+   * \param audioURL
+   *    The track
+   * \param generation
+   *    The load the pyramid belongs to
+   * \param replacesCached
+   *    True if the cached coarse levels are on screen, so the pyramid is handed over once it is
+   *    complete; otherwise it is drawn as it is built and stored in the cache at the end
+   */
+  void buildPyramid(SafePointer<WaveformDisplay> safeThis, URL audioURL, int generation, bool replacesCached);
+
+  /**
+   * \brief
+   *    Put a pyramid on screen from the build thread, unless a newer track has been loaded since.
+   *
+   * \param onlyCoarseLevels
+   *    True for the cached levels, whose pyramid is built if the display is zoomed in past them
+   */
+  static void handOver(SafePointer<WaveformDisplay> safeThis, int generation,
+                       std::shared_ptr<WaveformPyramid> newPyramid, bool onlyCoarseLevels);
+
+  /**
+   * \brief
+   *    Get the range of samples on screen at the current zoom.
+   */
+  juce::Range<double> getVisibleSamples() const;
+
+  /**
+   * \brief
+   *    Get the area the playhead covers when the given range is on screen.
+   */
+  Rectangle<int> getPlayheadBounds(juce::Range<double> visible) const;
+
+  /**
+   * \brief
+   *    Draw the waveform of a range of the track into the layer.
+   */
+  void renderLayer(juce::Range<double> visible);
+
+  AudioFormatManager& formatManager;
+
+  // tracks that are already decoded are drawn from memory instead of being read again
+  SharedResourcePointer<DecodedTrackCache> trackCache;
+
+  // pyramids of tracks drawn before, so that they are never decoded just to be drawn again
+  SharedResourcePointer<WaveformCache> waveformCache;
+
+  std::shared_ptr<WaveformPyramid> pyramid;
+
+  // the track on screen, and whether only its cached coarse levels are there so far
+  URL loadedURL;
+  bool onlyCoarseLevels = false;
+
+  // the waveform without the playhead, and the range of the track it shows
+  Image waveformLayer;
+  juce::Range<double> layerRange;
+  bool layerDirty = true;
+
+  // reused by renderLayer() so that drawing doesn't allocate
+  std::vector<WaveformPyramid::Range> peaks;
+
+  PaintStats paintStats;
+
+  // bumped by every load, so that the build of a track that was replaced stops
+  std::atomic<int> loadGeneration{ 0 };
 
   // determines if a file has been loaded
   bool fileLoaded;
@@ -77,5 +192,11 @@ private:
   // stores the position of the playhead
   double position;
 
+  // 1 shows the whole track
+  double zoom = 1.0;
+
+  // declared last so that it is destroyed first
+  ThreadPool buildPool{ 1 };
+
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformDisplay)
 };
@@ -0,0 +1,459 @@
+/*
+  ==============================================================================
+
+    WaveformPyramid.cpp
+    Created: 25 Oct 2026 9:26:03am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#include "WaveformPyramid.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <xmmintrin.h>
+#elif JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+#endif
+
+namespace {
+  constexpr int readBlockSize = 65536;
+
+  /* Sum of the squares of a float array of any length */
+  float sumOfSquares(const float* data, int num) noexcept {
+    int i = 0;
+
+   #if JUCE_USE_SSE_INTRINSICS
+    auto acc = _mm_setzero_ps();
+
+    for (; i + 4 <= num; i += 4) {
+      auto v = _mm_loadu_ps(data + i);
+      acc = _mm_add_ps(acc, _mm_mul_ps(v, v));
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc);
+    auto sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+   #elif JUCE_USE_ARM_NEON
+    auto acc = vdupq_n_f32(0.0f);
+
+    for (; i + 4 <= num; i += 4) {
+      auto v = vld1q_f32(data + i);
+      acc = vmlaq_f32(acc, v, v);
+    }
+
+    auto pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    auto sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+   #else
+    auto sum = 0.0f;
+   #endif
+
+    for (; i < num; ++i)
+      sum += data[i] * data[i];
+
+    return sum;
+  }
+
+  /* Squeeze a sample value between -1 and 1 into 8 bits */
+  int8 quantiseSample(float value) {
+    return (int8) jlimit(-127, 127, roundToInt(value * 127.0f));
+  }
+
+  /* Squeeze an RMS level between 0 and 1 into 8 bits */
+  uint8 quantiseLevel(float value) {
+    return (uint8) jlimit(0, 255, roundToInt(value * 255.0f));
+  }
+
+  /* Squeeze a band level into 8 bits, on a square-root scale so that quiet bands keep some detail */
+  uint8 quantiseBand(double meanSquare) {
+    return quantiseLevel((float) std::sqrt(std::sqrt(meanSquare)));
+  }
+
+  /* Get the coefficients of a biquad, normalised by JUCE */
+  template <typename Biquad>
+  void setCoefficients(Biquad& filter, const IIRCoefficients& coefficients) {
+    filter.b0 = coefficients.coefficients[0];
+    filter.b1 = coefficients.coefficients[1];
+    filter.b2 = coefficients.coefficients[2];
+    filter.a1 = coefficients.coefficients[3];
+    filter.a2 = coefficients.coefficients[4];
+  }
+
+  /* Get a band's RMS level back from its stored value */
+  float dequantiseBand(float stored) {
+    auto root = stored / 255.0f;
+    return root * root;
+  }
+}
+
+//==============================================================================
+WaveformPyramid::WaveformPyramid(int _numChannels, double _sampleRate, int64 _lengthInSamples,
+                                 int _baseShift)
+                               : numChannels(jmax(1, _numChannels)),
+                                 sampleRate(_sampleRate),
+                                 lengthInSamples(jmax((int64) 0, _lengthInSamples)),
+                                 baseShift(jlimit(0, 30, _baseShift))
+{
+  // halve the number of peaks per level until one peak covers the whole track
+  for (int level = 0;; ++level) {
+    auto samplesPerBin = getSamplesPerBin(level);
+    auto numBins = jmax((int64) 1, (lengthInSamples + samplesPerBin - 1) / samplesPerBin);
+
+    levels.emplace_back((size_t) (numBins * numChannels));
+    bandLevels.emplace_back((size_t) numBins);
+
+    if (numBins == 1)
+      break;
+  }
+
+  binsDone.reset(new std::atomic<int>[levels.size()]);
+
+  for (size_t level = 0; level < levels.size(); ++level)
+    binsDone[level] = 0;
+
+  accumulators.resize(levels.size() * (size_t) numChannels);
+  childrenMerged.resize(levels.size(), 0);
+  bandAccumulators.resize(levels.size());
+
+  if (sampleRate > 0) {
+    setCoefficients(lowPass, IIRCoefficients::makeLowPass(sampleRate, lowBandHz));
+    setCoefficients(highPass, IIRCoefficients::makeHighPass(sampleRate, jmin(highBandHz, sampleRate * 0.45)));
+  }
+}
+
+WaveformPyramid::~WaveformPyramid() {
+}
+
+/* Add the next samples of the track */
+void WaveformPyramid::addBlock(const AudioBuffer<float>& buffer, int startSample, int numSamples) {
+  jassert(buffer.getNumChannels() >= numChannels);
+
+  numSamples = (int) jmin((int64) numSamples, lengthInSamples - samplesAdded);
+
+  if (numSamples <= 0)
+    return;
+
+  splitBands(buffer, startSample, numSamples);
+
+  for (int done = 0; done < numSamples;) {
+    // up to the end of the current peak at level 0
+    auto num = (int) jmin((int64) (numSamples - done), getSamplesPerBin(0) - samplesInBin);
+
+    for (int chan = 0; chan < numChannels; ++chan) {
+      auto* samples = buffer.getReadPointer(jmin(chan, buffer.getNumChannels() - 1), startSample + done);
+      auto& acc = accumulators[(size_t) chan];
+      auto range = FloatVectorOperations::findMinAndMax(samples, num);
+
+      acc.min = jmin(acc.min, range.getStart());
+      acc.max = jmax(acc.max, range.getEnd());
+      acc.sumSquares += sumOfSquares(samples, num);
+      acc.numSamples += num;
+    }
+
+    auto& bands = bandAccumulators[0];
+    bands.low += sumOfSquares(bandBuffer.getReadPointer(0, done), num);
+    bands.mix += sumOfSquares(bandBuffer.getReadPointer(1, done), num);
+    bands.high += sumOfSquares(bandBuffer.getReadPointer(2, done), num);
+    bands.numSamples += num;
+
+    samplesInBin += num;
+    samplesAdded += num;
+    done += num;
+
+    if (samplesInBin == getSamplesPerBin(0)) {
+      completeBin(0);
+      samplesInBin = 0;
+    }
+  }
+}
+
+/* Finish the peaks that the end of the track falls in */
+void WaveformPyramid::finish() {
+  if (complete.load())
+    return;
+
+  // the last peak of each level may cover less than a full bin
+  if (samplesInBin > 0) {
+    completeBin(0);
+    samplesInBin = 0;
+  }
+
+  for (int level = 1; level < getNumLevels(); ++level)
+    if (childrenMerged[(size_t) level] > 0)
+      completeBin(level);
+
+  complete = true;
+}
+
+/* Add every sample of a reader and finish, in one pass */
+bool WaveformPyramid::addReader(AudioFormatReader& reader, const std::function<bool()>& shouldContinue) {
+  AudioBuffer<float> block(jmax(numChannels, (int) reader.numChannels), readBlockSize);
+  auto length = jmin(reader.lengthInSamples, lengthInSamples);
+
+  for (int64 pos = 0; pos < length; pos += readBlockSize) {
+    if (!shouldContinue())
+      return false;
+
+    auto num = (int) jmin((int64) readBlockSize, length - pos);
+    reader.read(&block, 0, num, pos, true, true);
+    addBlock(block, 0, num);
+  }
+
+  finish();
+  return true;
+}
+
+/* Checks whether every peak has been built */
+bool WaveformPyramid::isComplete() const {
+  return complete.load();
+}
+
+/* Get the peaks of one channel for each pixel across a range of the track */
+void WaveformPyramid::getPeaks(int channel, double startSample, double endSample, Range* dest, int numPixels) const {
+  if (numPixels <= 0)
+    return;
+
+  channel = jlimit(0, numChannels - 1, channel);
+
+  // the coarsest level that still has at least one peak per pixel, so that each pixel
+  // reads no more than a few peaks
+  auto samplesPerPixel = (endSample - startSample) / numPixels;
+  auto level = 0;
+
+  while (level + 1 < getNumLevels() && getSamplesPerBin(level + 1) <= samplesPerPixel)
+    ++level;
+
+  auto& peaks = levels[(size_t) level];
+  auto& bands = bandLevels[(size_t) level];
+  auto samplesPerBin = (double) getSamplesPerBin(level);
+  auto available = (int64) binsDone[(size_t) level].load(std::memory_order_acquire);
+
+  for (int px = 0; px < numPixels; ++px) {
+    auto firstBin = (int64) std::floor((startSample + px * samplesPerPixel) / samplesPerBin);
+    auto endBin = jmax(firstBin + 1, (int64) std::ceil((startSample + (px + 1) * samplesPerPixel) / samplesPerBin));
+
+    firstBin = jmax((int64) 0, firstBin);
+    endBin = jmin(available, endBin);
+
+    Range range;
+
+    if (firstBin < endBin) {
+      auto min = 127, max = -127;
+      float sumSquares = 0, low = 0, mid = 0, high = 0;
+
+      for (auto bin = firstBin; bin < endBin; ++bin) {
+        auto& peak = peaks[(size_t) (bin * numChannels + channel)];
+        min = jmin(min, (int) peak.min);
+        max = jmax(max, (int) peak.max);
+        sumSquares += (float) peak.rms * (float) peak.rms;
+
+        // the loudest bin of each band, so that a single kick still shows at any zoom
+        auto& band = bands[(size_t) bin];
+        low = jmax(low, (float) band.low);
+        mid = jmax(mid, (float) band.mid);
+        high = jmax(high, (float) band.high);
+      }
+
+      range.min = min / 127.0f;
+      range.max = max / 127.0f;
+      range.rms = std::sqrt(sumSquares / (float) (endBin - firstBin)) / 255.0f;
+      range.low = dequantiseBand(low);
+      range.mid = dequantiseBand(mid);
+      range.high = dequantiseBand(high);
+    }
+
+    dest[px] = range;
+  }
+}
+
+/* Make a copy holding only the coarse levels */
+std::unique_ptr<WaveformPyramid> WaveformPyramid::createOverview(int minSamplesPerBin) const {
+  auto firstLevel = 0;
+
+  while (firstLevel + 1 < getNumLevels() && getSamplesPerBin(firstLevel) < minSamplesPerBin)
+    ++firstLevel;
+
+  auto overview = std::make_unique<WaveformPyramid>(numChannels, sampleRate, lengthInSamples, baseShift + firstLevel);
+
+  for (int level = 0; level < overview->getNumLevels(); ++level) {
+    overview->levels[(size_t) level] = levels[(size_t) (firstLevel + level)];
+    overview->bandLevels[(size_t) level] = bandLevels[(size_t) (firstLevel + level)];
+    overview->binsDone[(size_t) level] = binsDone[(size_t) (firstLevel + level)].load(std::memory_order_acquire);
+  }
+
+  overview->complete = isComplete();
+  return overview;
+}
+
+/* Write a complete pyramid to a stream */
+bool WaveformPyramid::writeTo(OutputStream& out) const {
+  if (!isComplete())
+    return false;
+
+  out.write("AMWP", 4);
+  out.writeInt(formatVersion);
+  out.writeInt(numChannels);
+  out.writeInt(baseShift);
+  out.writeDouble(sampleRate);
+  out.writeInt64(lengthInSamples);
+
+  // the number of peaks in each level follows from the length, so only the peaks are written
+  for (size_t level = 0; level < levels.size(); ++level)
+    if (!out.write(levels[level].data(), levels[level].size() * sizeof(Peak))
+          || !out.write(bandLevels[level].data(), bandLevels[level].size() * sizeof(Bands)))
+      return false;
+
+  return true;
+}
+
+/* Read a pyramid written by writeTo() */
+std::shared_ptr<WaveformPyramid> WaveformPyramid::readFrom(InputStream& in) {
+  char magic[4] = {};
+
+  if (in.read(magic, 4) != 4 || std::memcmp(magic, "AMWP", 4) != 0 || in.readInt() != formatVersion)
+    return nullptr;
+
+  auto numChannels = in.readInt();
+  auto baseShift = in.readInt();
+  auto sampleRate = in.readDouble();
+  auto lengthInSamples = in.readInt64();
+
+  if (numChannels <= 0 || numChannels > 64 || baseShift < 0 || baseShift > 30 || lengthInSamples < 0)
+    return nullptr;
+
+  // a pyramid of this size is needed before any of it can be read, so reject absurd headers first
+  auto remaining = in.getNumBytesRemaining();
+
+  if (remaining >= 0 && lengthInSamples / ((int64) 1 << baseShift) * numChannels * (int64) sizeof(Peak) > remaining)
+    return nullptr;
+
+  auto pyramid = std::make_shared<WaveformPyramid>(numChannels, sampleRate, lengthInSamples, baseShift);
+
+  for (int level = 0; level < pyramid->getNumLevels(); ++level) {
+    auto& peaks = pyramid->levels[(size_t) level];
+    auto& bands = pyramid->bandLevels[(size_t) level];
+    auto numBytes = (int) (peaks.size() * sizeof(Peak));
+    auto numBandBytes = (int) (bands.size() * sizeof(Bands));
+
+    if (in.read(peaks.data(), numBytes) != numBytes || in.read(bands.data(), numBandBytes) != numBandBytes)
+      return nullptr;
+
+    pyramid->binsDone[(size_t) level] = pyramid->getNumBins(level);
+  }
+
+  pyramid->samplesAdded = lengthInSamples;
+  pyramid->complete = true;
+  return pyramid;
+}
+
+/* Get the memory taken by the peaks */
+size_t WaveformPyramid::getMemoryUsed() const {
+  size_t bytes = 0;
+
+  for (auto& level : levels)
+    bytes += level.size() * sizeof(Peak);
+
+  for (auto& level : bandLevels)
+    bytes += level.size() * sizeof(Bands);
+
+  return bytes;
+}
+
+/* Mix a block's channels and filter the mix into the low and high bands */
+void WaveformPyramid::splitBands(const AudioBuffer<float>& buffer, int startSample, int numSamples) {
+  if (bandBuffer.getNumSamples() < numSamples)
+    bandBuffer.setSize(3, numSamples, false, false, true);
+
+  auto* low = bandBuffer.getWritePointer(0);
+  auto* mix = bandBuffer.getWritePointer(1);
+  auto* high = bandBuffer.getWritePointer(2);
+  auto numInputs = jmin(numChannels, buffer.getNumChannels());
+
+  FloatVectorOperations::copy(mix, buffer.getReadPointer(0, startSample), numSamples);
+
+  for (int chan = 1; chan < numInputs; ++chan)
+    FloatVectorOperations::add(mix, buffer.getReadPointer(chan, startSample), numSamples);
+
+  if (numInputs > 1)
+    FloatVectorOperations::multiply(mix, 1.0f / (float) numInputs, numSamples);
+
+  // both crossovers in one loop: each filter waits on its own previous output, so running
+  // them side by side keeps the CPU busy where one at a time would leave it waiting
+  auto lp = lowPass, hp = highPass;
+
+  for (int i = 0; i < numSamples; ++i) {
+    auto in = mix[i];
+
+    auto lowOut = lp.b0 * in + lp.z1;
+    lp.z1 = lp.b1 * in - lp.a1 * lowOut + lp.z2;
+    lp.z2 = lp.b2 * in - lp.a2 * lowOut;
+
+    auto highOut = hp.b0 * in + hp.z1;
+    hp.z1 = hp.b1 * in - hp.a1 * highOut + hp.z2;
+    hp.z2 = hp.b2 * in - hp.a2 * highOut;
+
+    low[i] = lowOut;
+    high[i] = highOut;
+  }
+
+  // keep denormals out of the filters' state, as juce::IIRFilter does
+  JUCE_SNAP_TO_ZERO(lp.z1);  JUCE_SNAP_TO_ZERO(lp.z2);
+  JUCE_SNAP_TO_ZERO(hp.z1);  JUCE_SNAP_TO_ZERO(hp.z2);
+
+  lowPass = lp;
+  highPass = hp;
+}
+
+/* Store the next peak of a level from its accumulators and pass it up to the level above */
+void WaveformPyramid::completeBin(int level) {
+  auto bin = binsDone[(size_t) level].load(std::memory_order_relaxed);
+  auto hasParent = level + 1 < getNumLevels();
+  auto& peaks = levels[(size_t) level];
+
+  for (int chan = 0; chan < numChannels; ++chan) {
+    auto& acc = accumulators[(size_t) (level * numChannels + chan)];
+
+    if (acc.numSamples > 0 && (size_t) (bin * numChannels + chan) < peaks.size()) {
+      auto& peak = peaks[(size_t) (bin * numChannels + chan)];
+      peak.min = quantiseSample(acc.min);
+      peak.max = quantiseSample(acc.max);
+      peak.rms = quantiseLevel((float) std::sqrt(acc.sumSquares / (double) acc.numSamples));
+    }
+
+    if (hasParent) {
+      auto& parent = accumulators[(size_t) ((level + 1) * numChannels + chan)];
+      parent.min = jmin(parent.min, acc.min);
+      parent.max = jmax(parent.max, acc.max);
+      parent.sumSquares += acc.sumSquares;
+      parent.numSamples += acc.numSamples;
+    }
+
+    acc = {};
+  }
+
+  auto& bandAcc = bandAccumulators[(size_t) level];
+
+  if (bandAcc.numSamples > 0 && bin < getNumBins(level)) {
+    auto& bands = bandLevels[(size_t) level][(size_t) bin];
+    bands.low = quantiseBand(bandAcc.low / (double) bandAcc.numSamples);
+    bands.mid = quantiseBand(jmax(0.0, bandAcc.mix - bandAcc.low - bandAcc.high) / (double) bandAcc.numSamples);
+    bands.high = quantiseBand(bandAcc.high / (double) bandAcc.numSamples);
+  }
+
+  if (hasParent) {
+    auto& parent = bandAccumulators[(size_t) (level + 1)];
+    parent.low += bandAcc.low;
+    parent.mix += bandAcc.mix;
+    parent.high += bandAcc.high;
+    parent.numSamples += bandAcc.numSamples;
+  }
+
+  bandAcc = {};
+
+  // readers only look at peaks below the published count
+  binsDone[(size_t) level].store(jmin(bin + 1, getNumBins(level)), std::memory_order_release);
+  childrenMerged[(size_t) level] = 0;
+
+  if (hasParent && ++childrenMerged[(size_t) (level + 1)] == 2)
+    completeBin(level + 1);
+}
@@ -0,0 +1,265 @@
+/*
+  ==============================================================================
+
+    WaveformPyramid.h
+    Created: 25 Oct 2026 9:26:03am
+    Author:  pangj
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Min/max/RMS peaks of a track at every power-of-two zoom level, so that a
+    waveform can be drawn at any zoom in time proportional to its width.
+
+    Level 0 holds one peak per baseSamplesPerBin samples and each level above
+    it halves the number of peaks, up to a single peak for the whole track.
+    Peaks are stored in 8 bits per value (3 bytes per channel), and the whole
+    pyramid takes about twice as much memory as level 0. createOverview()
+    keeps only the coarse levels, which is enough for small displays and
+    small enough to keep for a whole library.
+
+    Next to each peak, every level also keeps the RMS level of the low, mid
+    and high frequency bands of all channels mixed together, in 8 bits each,
+    so that a waveform can be coloured by its content at no cost when it is
+    drawn. The low and high bands come from a low-pass at lowBandHz and a
+    high-pass at highBandHz, run side by side in the same pass; the mid band
+    is the energy of the mix that is in neither.
+
+    The pyramid is built in one streaming pass through addBlock(). It can be
+    drawn from another thread while it is being built: getPeaks() only reads
+    the peaks that are finished.
+*/
+class WaveformPyramid {
+public:
+  // samples per peak at the finest level
+  static constexpr int baseSamplesPerBin = 16;
+
+  // crossover frequencies between the low, mid and high bands
+  static constexpr double lowBandHz = 200.0;
+  static constexpr double highBandHz = 2000.0;
+
+  /**
+   * \brief
+   *    A stored peak of one channel.
+   */
+  struct Peak {
+    int8 min = 0;
+    int8 max = 0;
+    uint8 rms = 0;
+  };
+
+  /**
+   * \brief
+   *    The stored RMS level of each band, for all channels.
+   */
+  struct Bands {
+    uint8 low = 0;
+    uint8 mid = 0;
+    uint8 high = 0;
+  };
+
+  /**
+   * \brief
+   *    The peak of one channel over a range of samples, between -1 and 1, and the
+   *    RMS level of each band of all channels.
+   */
+  struct Range {
+    float min = 0;
+    float max = 0;
+    float rms = 0;
+    float low = 0;
+    float mid = 0;
+    float high = 0;
+  };
+
+  /**
+   * \brief
+   *    Constructor. Makes room for every level of a track.
+   *
+   * \param _numChannels
+   *    Number of channels in the track
+   * \param _sampleRate
+   *    Sample rate of the track
+   * \param _lengthInSamples
+   *    Length of the track (audio past the end is ignored)
+   * \param _baseShift
+   *    log2 of the number of samples per peak at level 0
+   */
+  WaveformPyramid(int _numChannels, double _sampleRate, int64 _lengthInSamples,
+                  int _baseShift = 4);
+
+  /**
+   * \brief
+   *    Destructor.
+   */
+  ~WaveformPyramid();
+
+  /**
+   * \brief
+   *    Add the next samples of the track. Call from one thread, in order.
+   *
+   * \param buffer
+   *    Buffer holding the samples (with at least as many channels as the track)
+   * \param startSample
+   *    First sample in the buffer to add
+   * \param numSamples
+   *    Number of samples to add
+   */
+  void addBlock(const AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+  /**
+   * \brief
+   *    Finish the peaks that the end of the track falls in. Call after the last block.
+   */
+  void finish();
+
+  /**
+   * \brief
+   *    Add every sample of a reader and finish, in one pass.
+   *
+   * \param reader
+   *    The track to read, from its first sample
+   * \param shouldContinue
+   *    Called between blocks; returning false stops the build
+   *
+   * \return
+   *    false if the build was stopped
+   */
+  bool addReader(AudioFormatReader& reader, const std::function<bool()>& shouldContinue);
+
+  /**
+   * \brief
+   *    Checks whether every peak has been built.
+   */
+  bool isComplete() const;
+
+  /**
+   * \brief
+   *    Get the peaks of one channel for each pixel across a range of the track.
+   *    Takes time proportional to numPixels, at any zoom.
+   *
+   * \param channel
+   *    The channel to read
+   * \param startSample
+   *    Sample at the left edge of the first pixel
+   * \param endSample
+   *    Sample at the right edge of the last pixel
+   * \param dest
+   *    Receives numPixels peaks (zero where nothing has been built yet)
+   * \param numPixels
+   *    Number of pixels across the range
+   */
+  void getPeaks(int channel, double startSample, double endSample, Range* dest, int numPixels) const;
+
+  /**
+   * \brief
+   *    Make a copy holding only the levels with at least minSamplesPerBin samples per peak.
+   */
+  std::unique_ptr<WaveformPyramid> createOverview(int minSamplesPerBin = 4096) const;
+
+  /**
+   * \brief
+   *    Write a complete pyramid to a stream, to be read back with readFrom().
+   *
+   * \return
+   *    false if the pyramid isn't complete or the stream failed
+   */
+  bool writeTo(OutputStream& out) const;
+
+  /**
+   * \brief
+   *    Read a pyramid written by writeTo().
+   *
+   * \return
+   *    The pyramid, or nullptr if the stream doesn't hold a whole one
+   */
+  static std::shared_ptr<WaveformPyramid> readFrom(InputStream& in);
+
+  int getNumChannels() const { return numChannels; }
+  double getSampleRate() const { return sampleRate; }
+  int64 getLengthInSamples() const { return lengthInSamples; }
+  double getLengthInSeconds() const { return sampleRate > 0 ? lengthInSamples / sampleRate : 0.0; }
+
+  int getNumLevels() const { return (int) levels.size(); }
+  int64 getSamplesPerBin(int level) const { return (int64) 1 << (baseShift + level); }
+  int getNumBins(int level) const { return (int) (levels[(size_t) level].size() / (size_t) numChannels); }
+
+  /**
+   * \brief
+   *    Get the memory taken by the peaks, in bytes.
+   */
+  size_t getMemoryUsed() const;
+
+private:
+  struct Accumulator {
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::lowest();
+    double sumSquares = 0;
+    int64 numSamples = 0;
+  };
+
+  struct Biquad {
+    float b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    float z1 = 0, z2 = 0;
+  };
+
+  // energies of the low band, the whole mix and the high band (the mid band is worked out
+  // from the sums, as the filters' phase shifts make it meaningless over a few samples)
+  struct BandAccumulator {
+    double low = 0;
+    double mix = 0;
+    double high = 0;
+    int64 numSamples = 0;
+  };
+
+  /**
+   * \brief
+   *    Mix a block's channels and filter the mix into the low and high bands, in bandBuffer.
+   */
+  void splitBands(const AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+  /**
+   * \brief
+   *    Store the next peak of a level from its accumulators and pass it up to the level above.
+   */
+  void completeBin(int level);
+
+  const int numChannels;
+  const double sampleRate;
+  const int64 lengthInSamples;
+  const int baseShift;
+
+  // levels[level][bin * numChannels + channel]
+  std::vector<std::vector<Peak>> levels;
+
+  // bandLevels[level][bin]
+  std::vector<std::vector<Bands>> bandLevels;
+
+  // number of finished peaks per level, published to readers
+  std::unique_ptr<std::atomic<int>[]> binsDone;
+
+  // builder only: accumulators[level * numChannels + channel], and the peaks merged into each level
+  std::vector<Accumulator> accumulators;
+  std::vector<int> childrenMerged;
+  std::vector<BandAccumulator> bandAccumulators;
+
+  // builder only: the crossovers, and the low band, mix and high band of the block being added
+  Biquad lowPass;
+  Biquad highPass;
+  AudioBuffer<float> bandBuffer;
+  int64 samplesInBin = 0;
+  int64 samplesAdded = 0;
+
+  std::atomic<bool> complete{ false };
+
+  // bump when the layout written by writeTo() changes
+  static constexpr int formatVersion = 2;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformPyramid)
+};